@@ -0,0 +1,54 @@
+#include "TAI_BevAsyncQuery.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			void BevNodeAsyncQuery::_DoEnter(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				QueryState &s = _GetUserState<QueryState>(state);
+				s.mo_Query = _CreateQuery(state, input);
+				if (!s.mo_Query)
+					return;
+				if (mo_JobPool)
+				{
+					//任务池持有的那一份，执行完释放
+					s.mo_Query->_AddRef();
+					mo_JobPool->Submit(s.mo_Query);
+				}
+				else
+				{
+					s.mo_Query->_DoQuery();
+					s.mo_Query->mi_Done = 1;
+				}
+			}
+			BevRunningStatus BevNodeAsyncQuery::_DoExecute(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				QueryState &s = _GetUserState<QueryState>(state);
+				if (!s.mo_Query)
+					return k_BRS_ERROR_Transition;
+				if (!s.mo_Query->IsDone())
+					return k_BRS_Executing;
+
+				BevRunningStatus result = _OnQueryDone(*s.mo_Query, state, input, output);
+				s.mo_Query->_Release();
+				s.mo_Query = NULL;
+				return result;
+			}
+			void BevNodeAsyncQuery::_DoExit(BevAgentState &state, const BevNodeInputParam &input, BevRunningStatus _ui_ExitID) const
+			{
+				QueryState &s = _GetUserState<QueryState>(state);
+				if (!s.mo_Query)
+					return;
+				//结果还没取走就退出了：还在排队的从任务池里拿掉，正在执行的让它做完自己释放
+				AtomicExchange(&s.mo_Query->mi_Cancelled, 1);
+				if (mo_JobPool && mo_JobPool->Cancel(s.mo_Query))
+					s.mo_Query->_Release();
+				s.mo_Query->_Release();
+				s.mo_Query = NULL;
+			}
+		}
+	}
+}
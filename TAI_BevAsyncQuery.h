@@ -0,0 +1,120 @@
+#ifndef __TAI_BEVASYNCQUERY_H__
+#define __TAI_BEVASYNCQUERY_H__
+
+#include "TAI_BevTree.h"
+#include "TCore_JobPool.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			//一次异步查询（射线、寻路之类），在任务池的工作线程里执行
+			//子类把需要的参数在创建时拷进来，结果也写在自己的成员里；_DoQuery里不能读input和agent的状态
+			//引用计数管理：节点和任务池各持有一份，节点放弃时查询可能还在执行，由最后一个释放的删掉
+			class BevAsyncQuery : public IJob
+			{
+				friend class BevNodeAsyncQuery;
+
+			public:
+				BevAsyncQuery()
+					: mi_RefCount(1), mi_Done(0), mi_Cancelled(0)
+				{
+				}
+				virtual ~BevAsyncQuery()
+				{
+				}
+
+				bool IsDone() const
+				{
+					return mi_Done != 0;
+				}
+				//节点已经不要结果了，耗时长的查询可以在_DoQuery里检查它提前返回
+				bool IsCancelled() const
+				{
+					return mi_Cancelled != 0;
+				}
+
+			protected:
+				virtual void _DoQuery() = 0;
+
+			private:
+				BevAsyncQuery(const BevAsyncQuery &);
+				BevAsyncQuery &operator=(const BevAsyncQuery &);
+
+				virtual void Execute()
+				{
+					if (!IsCancelled())
+						_DoQuery();
+					//结果要在置完成标记之前写好
+					AtomicExchange(&mi_Done, 1);
+					_Release();
+				}
+				void _AddRef()
+				{
+					AtomicIncrement(&mi_RefCount);
+				}
+				void _Release()
+				{
+					if (AtomicDecrement(&mi_RefCount) == 0)
+						delete this;
+				}
+
+			private:
+				volatile s32 mi_RefCount;
+				volatile s32 mi_Done;
+				volatile s32 mi_Cancelled;
+			};
+
+			//异步查询的行为节点：_DoEnter时创建查询交给任务池，结果出来之前一直返回k_BRS_Executing，
+			//出来以后在tick的线程里调用_OnQueryDone，它的返回值就是节点的结果
+			//被转移打断（或者出错退出）时还在排队的查询直接取消，已经在执行的等它做完后丢掉结果
+			//没有设置任务池时查询在_DoEnter里同步执行；BevAgentState::Reset不会调用_DoExit，要先Transition再Reset
+			class BevNodeAsyncQuery : public BevNodeTerminal
+			{
+			public:
+				BevNodeAsyncQuery(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNodeTerminal(_o_ParentNode, _o_NodePrecondition), mo_JobPool(NULL)
+				{
+				}
+
+				//要在树开始执行之前设置
+				BevNodeAsyncQuery &SetJobPool(JobPool *_o_JobPool)
+				{
+					mo_JobPool = _o_JobPool;
+					return (*this);
+				}
+				JobPool *oGetJobPool() const
+				{
+					return mo_JobPool;
+				}
+
+			protected:
+				//用input里的数据new一个查询，返回NULL表示不用查了，节点直接以k_BRS_ERROR_Transition结束
+				virtual BevAsyncQuery *_CreateQuery(BevAgentState &state, const BevNodeInputParam &input) const = 0;
+				//查询做完了，读结果写output
+				virtual BevRunningStatus _OnQueryDone(BevAsyncQuery &_o_Query, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const = 0;
+
+			private:
+				struct QueryState
+				{
+					BevAsyncQuery *mo_Query;
+				};
+
+				virtual void _DoEnter(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoExecute(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+				virtual void _DoExit(BevAgentState &state, const BevNodeInputParam &input, BevRunningStatus _ui_ExitID) const;
+				virtual u32 _GetUserStateSize() const
+				{
+					return sizeof(QueryState);
+				}
+
+			private:
+				JobPool *mo_JobPool;
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "TAI_BevBlackboard.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			//-------------------------------------------------------------------------------------
+			// BevBlackboardLayout
+			//-------------------------------------------------------------------------------------
+			BevBlackboardLayout::BevBlackboardLayout()
+				: mui_Alignment(1), mb_Frozen(false)
+			{
+			}
+
+			u32 BevBlackboardLayout::_AddKey(u32 _ui_Key, const char *_z_Name, u32 _e_Type, u32 _ui_Size, u32 _ui_Alignment, const void *_p_Default)
+			{
+				std::map<u32, u32>::const_iterator it = mao_Index.find(_ui_Key);
+				if (it != mao_Index.end())
+				{
+					Entry &entry = mao_Entries[it->second];
+					//名字hash撞了，或者同一个key在两处当成了不同的类型
+					if (entry.me_Type != _e_Type || entry.mui_Size != _ui_Size)
+					{
+						D_Output("BevBlackboardLayout: key %s is declared with another type (as %s)\n", _z_Name, entry.mz_Name.c_str());
+						D_CHECK(0);
+						return k_BLimited_InvalidBlackboardOffset;
+					}
+					if (_p_Default)
+					{
+						if (mb_Frozen)
+						{
+							D_Output("BevBlackboardLayout: can't change the default of %s, blackboards are already created\n", _z_Name);
+							D_CHECK(0);
+						}
+						else
+							memcpy(&mab_Defaults[entry.mui_Offset], _p_Default, _ui_Size);
+					}
+					return it->second;
+				}
+				if (mb_Frozen)
+				{
+					D_Output("BevBlackboardLayout: can't add key %s, blackboards are already created\n", _z_Name);
+					D_CHECK(0);
+					return k_BLimited_InvalidBlackboardOffset;
+				}
+
+				Entry entry;
+				entry.mui_Key = _ui_Key;
+				entry.mui_Offset = ((u32)mab_Defaults.size() + _ui_Alignment - 1) & ~(_ui_Alignment - 1);
+				entry.mui_Size = _ui_Size;
+				entry.me_Type = _e_Type;
+				entry.mz_Name = _z_Name ? _z_Name : "";
+				mab_Defaults.resize(entry.mui_Offset + _ui_Size, 0);
+				if (_p_Default)
+					memcpy(&mab_Defaults[entry.mui_Offset], _p_Default, _ui_Size);
+				if (_ui_Alignment > mui_Alignment)
+					mui_Alignment = _ui_Alignment;
+				u32 index = (u32)mao_Entries.size();
+				mao_Index[_ui_Key] = index;
+				mao_Entries.push_back(entry);
+				return index;
+			}
+
+			u32 BevBlackboardLayout::_FindIndex(u32 _ui_Key, u32 _e_Type, u32 _ui_Size) const
+			{
+				std::map<u32, u32>::const_iterator it = mao_Index.find(_ui_Key);
+				if (it == mao_Index.end())
+					return k_BLimited_InvalidBlackboardOffset;
+				const Entry &entry = mao_Entries[it->second];
+				if (entry.me_Type != _e_Type || entry.mui_Size != _ui_Size)
+					return k_BLimited_InvalidBlackboardOffset;
+				return it->second;
+			}
+
+			void BevBlackboardLayout::PrintLayout() const
+			{
+				D_Output("BevBlackboardLayout: %u keys, %u bytes\n", GetKeyCount(), GetSize());
+				for (u32 i = 0; i < mao_Entries.size(); ++i)
+				{
+					const Entry &entry = mao_Entries[i];
+					D_Output("  %4u %3u bytes type %u key 0x%08x %s\n", entry.mui_Offset, entry.mui_Size, entry.me_Type, entry.mui_Key, entry.mz_Name.c_str());
+				}
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevBlackboard
+			//-------------------------------------------------------------------------------------
+			BevBlackboard::BevBlackboard(const BevBlackboardLayout &_o_Layout)
+				: mo_Layout(&_o_Layout), mui_Size(_o_Layout.GetSize()), mui_KeyCount(_o_Layout.GetKeyCount()), mab_Data(NULL), mb_OwnData(true), maui_Changed(NULL), mo_Agent(NULL)
+			{
+				//new出来的内存按最大的基本类型对齐，一块空的也分配，GetData不会是NULL
+				u32 size = _o_Layout.GetMemorySize();
+				mab_Data = new u8[size > 0 ? size : 1];
+				_Init();
+			}
+			BevBlackboard::BevBlackboard(const BevBlackboardLayout &_o_Layout, void *_p_Memory)
+				: mo_Layout(&_o_Layout), mui_Size(_o_Layout.GetSize()), mui_KeyCount(_o_Layout.GetKeyCount()), mab_Data(static_cast<u8 *>(_p_Memory)), mb_OwnData(false), maui_Changed(NULL), mo_Agent(NULL)
+			{
+				D_CHECK(mab_Data && ((size_t)mab_Data & (_o_Layout.GetAlignment() - 1)) == 0);
+				_Init();
+			}
+			BevBlackboard::BevBlackboard(BevBlackboard &_o_Shared, u32 *_ui_Changed)
+				: mo_Layout(_o_Shared.mo_Layout), mui_Size(_o_Shared.mui_Size), mui_KeyCount(_o_Shared.mui_KeyCount), mab_Data(_o_Shared.mab_Data), mb_OwnData(false), maui_Changed(_ui_Changed), mo_Agent(NULL)
+			{
+				ClearChanges();
+			}
+			BevBlackboard::~BevBlackboard()
+			{
+				if (mo_Agent)
+					mo_Agent->SetBlackboard(NULL);
+				if (mb_OwnData)
+					delete[] mab_Data;
+				mab_Data = NULL;
+			}
+			void BevBlackboard::_Init()
+			{
+				mo_Layout->Freeze();
+				maui_Changed = reinterpret_cast<u32 *>(mab_Data + mo_Layout->GetMemorySize()) - mo_Layout->GetChangeWordCount();
+				ClearChanges();
+				Reset();
+			}
+			void BevBlackboard::Reset()
+			{
+				if (mui_Size > 0)
+					memcpy(mab_Data, mo_Layout->GetDefaults(), mui_Size);
+				for (u32 i = 0; i < mui_KeyCount; ++i)
+					maui_Changed[i >> 5] |= 1u << (i & 31);
+				if (mo_Agent)
+					mo_Agent->MarkDirtyMask(0xffffffff);
+			}
+			bool BevBlackboard::HasChanges() const
+			{
+				u32 count = mo_Layout->GetChangeWordCount();
+				for (u32 i = 0; i < count; ++i)
+				{
+					if (maui_Changed[i])
+						return true;
+				}
+				return false;
+			}
+			void BevBlackboard::_MergeChanges(const u32 *_ui_Changed)
+			{
+				u32 count = mo_Layout->GetChangeWordCount();
+				for (u32 i = 0; i < count; ++i)
+					maui_Changed[i] |= _ui_Changed[i];
+			}
+			void BevBlackboard::ClearChanges()
+			{
+				memset(maui_Changed, 0, mo_Layout->GetChangeWordCount() * sizeof(u32));
+			}
+		}
+	}
+}
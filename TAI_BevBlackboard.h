@@ -0,0 +1,474 @@
+#ifndef __TAI_BEVBLACKBOARD_H__
+#define __TAI_BEVBLACKBOARD_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include "TAI_BevTree.h"
+#include "TAI_StringID.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+#define k_BLimited_InvalidBlackboardOffset 0xffffffff
+
+			//黑板上值的类型，BevBlackboardLayout用它检查同一个key在不同地方的用法是否一致
+			enum E_BevBlackboardType
+			{
+				//其他POD类型，只检查大小
+				k_BBT_Raw = 0,
+				k_BBT_Bool,
+				k_BBT_S32,
+				k_BBT_U32,
+				k_BBT_F32,
+				k_BBT_F64,
+				k_BBT_Pointer,
+			};
+
+			template <typename T>
+			struct BevBlackboardTypeOf
+			{
+				enum { Value = k_BBT_Raw };
+			};
+			template <>
+			struct BevBlackboardTypeOf<bool>
+			{
+				enum { Value = k_BBT_Bool };
+			};
+			template <>
+			struct BevBlackboardTypeOf<s32>
+			{
+				enum { Value = k_BBT_S32 };
+			};
+			template <>
+			struct BevBlackboardTypeOf<u32>
+			{
+				enum { Value = k_BBT_U32 };
+			};
+			template <>
+			struct BevBlackboardTypeOf<f32>
+			{
+				enum { Value = k_BBT_F32 };
+			};
+			template <>
+			struct BevBlackboardTypeOf<f64>
+			{
+				enum { Value = k_BBT_F64 };
+			};
+			template <typename T>
+			struct BevBlackboardTypeOf<T *>
+			{
+				enum { Value = k_BBT_Pointer };
+			};
+
+			//T的对齐
+			template <typename T>
+			struct BevBlackboardAlignOf
+			{
+				struct Probe
+				{
+					char c;
+					T t;
+				};
+				enum { Value = sizeof(Probe) - sizeof(T) };
+			};
+
+			class BevBlackboardLayout;
+
+			//节点和条件里用到的黑板key，按名字的hash（StringID::Hash）区分，hash也是它在脏标记里的key（BevGetWatchBit）
+			//BindBlackboard时换成黑板里的偏移和序号，之后每次读写只是一次按偏移的访问
+			//一棵树只能绑定一个布局，多棵树可以共用同一个布局
+			template <typename T>
+			class BevBlackboardKey
+			{
+			public:
+				explicit BevBlackboardKey(const char *_z_Name)
+					: mui_Key(StringID::Hash(_z_Name)), mz_Name(_z_Name), mui_Offset(k_BLimited_InvalidBlackboardOffset), mui_Index(k_BLimited_InvalidBlackboardOffset)
+				{
+				}
+
+				u32 GetKey() const
+				{
+					return mui_Key;
+				}
+				const char *GetName() const
+				{
+					return mz_Name;
+				}
+				u32 GetOffset() const
+				{
+					return mui_Offset;
+				}
+				//在布局里是第几个key，黑板的写入记录按它记
+				u32 GetIndex() const
+				{
+					return mui_Index;
+				}
+				bool IsBound() const
+				{
+					return mui_Offset != k_BLimited_InvalidBlackboardOffset;
+				}
+
+				//布局里还没有这个key时加上，在节点的_BindBlackboard和条件的BindBlackboard里调用
+				void Bind(BevBlackboardLayout &_o_Layout) const;
+
+			private:
+				u32 mui_Key;
+				//名字只在出错时打印，要比key活得久（一般是字符串常量）
+				const char *mz_Name;
+				mutable u32 mui_Offset;
+				mutable u32 mui_Index;
+			};
+
+			//黑板的布局：每个key的类型、大小和在黑板里的偏移，以及初始值
+			//建树时由各节点的BindBlackboard填进来，也可以事先用AddKey声明并给出初始值
+			//第一个BevBlackboard创建之后布局就固定了，不能再加key
+			class BevBlackboardLayout
+			{
+			public:
+				BevBlackboardLayout();
+
+				//加一个key，已经有了的话检查类型是否一致，返回偏移，出错返回k_BLimited_InvalidBlackboardOffset
+				template <typename T>
+				u32 AddKey(const char *_z_Name)
+				{
+					return GetKeyOffset(_AddKey(StringID::Hash(_z_Name), _z_Name, BevBlackboardTypeOf<T>::Value, sizeof(T), BevBlackboardAlignOf<T>::Value, NULL));
+				}
+				//同上，同时设置初始值
+				template <typename T>
+				u32 AddKey(const char *_z_Name, const T &_o_Default)
+				{
+					return GetKeyOffset(_AddKey(StringID::Hash(_z_Name), _z_Name, BevBlackboardTypeOf<T>::Value, sizeof(T), BevBlackboardAlignOf<T>::Value, &_o_Default));
+				}
+				//同上，返回的是key的序号
+				template <typename T>
+				u32 RegisterKey(const BevBlackboardKey<T> &_o_Key)
+				{
+					return _AddKey(_o_Key.GetKey(), _o_Key.GetName(), BevBlackboardTypeOf<T>::Value, sizeof(T), BevBlackboardAlignOf<T>::Value, NULL);
+				}
+
+				//按名字查key的序号，类型不对或者没有这个key返回k_BLimited_InvalidBlackboardOffset；要走一次查找，不要每帧用
+				template <typename T>
+				u32 FindIndex(const char *_z_Name) const
+				{
+					return _FindIndex(StringID::Hash(_z_Name), BevBlackboardTypeOf<T>::Value, sizeof(T));
+				}
+				template <typename T>
+				u32 FindOffset(const char *_z_Name) const
+				{
+					return GetKeyOffset(FindIndex<T>(_z_Name));
+				}
+
+				u32 GetKeyCount() const
+				{
+					return (u32)mao_Entries.size();
+				}
+				//第_ui_Index个key的偏移和hash，序号无效时偏移是k_BLimited_InvalidBlackboardOffset
+				u32 GetKeyOffset(u32 _ui_Index) const
+				{
+					return _ui_Index < mao_Entries.size() ? mao_Entries[_ui_Index].mui_Offset : k_BLimited_InvalidBlackboardOffset;
+				}
+				u32 GetKeyHash(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Entries.size());
+					return mao_Entries[_ui_Index].mui_Key;
+				}
+				//所有值加起来的大小和对齐
+				u32 GetSize() const
+				{
+					return (u32)mab_Defaults.size();
+				}
+				//写入记录每个key一位，放在值的后面
+				u32 GetChangeWordCount() const
+				{
+					return (GetKeyCount() + 31) / 32;
+				}
+				//一块黑板要的内存：值加上写入记录
+				u32 GetMemorySize() const
+				{
+					return ((GetSize() + sizeof(u32) - 1) & ~(sizeof(u32) - 1)) + GetChangeWordCount() * sizeof(u32);
+				}
+				u32 GetAlignment() const
+				{
+					return mui_Alignment;
+				}
+				//所有key的初始值，按偏移排好
+				const u8 *GetDefaults() const
+				{
+					return mab_Defaults.empty() ? NULL : &mab_Defaults[0];
+				}
+
+				//创建了黑板以后布局就不能再改
+				void Freeze() const
+				{
+					mb_Frozen = true;
+				}
+				bool IsFrozen() const
+				{
+					return mb_Frozen;
+				}
+
+				void PrintLayout() const;
+
+			private:
+				BevBlackboardLayout(const BevBlackboardLayout &);
+				BevBlackboardLayout &operator=(const BevBlackboardLayout &);
+
+				u32 _AddKey(u32 _ui_Key, const char *_z_Name, u32 _e_Type, u32 _ui_Size, u32 _ui_Alignment, const void *_p_Default);
+				u32 _FindIndex(u32 _ui_Key, u32 _e_Type, u32 _ui_Size) const;
+
+			private:
+				struct Entry
+				{
+					u32 mui_Key;
+					u32 mui_Offset;
+					u32 mui_Size;
+					u32 me_Type;
+					std::string mz_Name;
+				};
+				std::vector<Entry> mao_Entries;
+				//key -> mao_Entries里的下标，只在建树时查
+				std::map<u32, u32> mao_Index;
+				std::vector<u8> mab_Defaults;
+				u32 mui_Alignment;
+				mutable bool mb_Frozen;
+			};
+
+			template <typename T>
+			void BevBlackboardKey<T>::Bind(BevBlackboardLayout &_o_Layout) const
+			{
+				u32 index = _o_Layout.RegisterKey(*this);
+				u32 offset = _o_Layout.GetKeyOffset(index);
+				//同一棵树绑到了两个偏移不一样的布局上，先绑的那个布局的黑板会读错位置
+				if (IsBound() && (offset != mui_Offset || index != mui_Index))
+				{
+					D_Output("BevBlackboardKey: %s is already bound at offset %u of another layout\n", mz_Name, mui_Offset);
+					D_CHECK(0);
+				}
+				mui_Offset = offset;
+				mui_Index = index;
+			}
+
+			//一个agent的黑板，所有值放在一块连续的内存里，布局由BevBlackboardLayout决定
+			//用BevAgentState::SetBlackboard挂到agent上以后，节点和条件通过state.oGetBlackboard()读写
+			//每次写（Set、GetRef、Assign）都记在每个key一位的写入记录里，同时把agent上这个key标脏，
+			//订阅了这个key的前提条件和节点会重新评估；写入记录在agent每次根节点评估结束时清掉
+			//根节点评估期间（前提条件、_DoEvaluate里）不要写黑板，写了也会在评估结束时被清掉
+			class BevBlackboard
+			{
+				friend class BevAgentState;
+				friend class BevNodeParallel;
+
+			public:
+				//自己分配内存
+				BevBlackboard(const BevBlackboardLayout &_o_Layout);
+				//使用外部内存（大小至少为_o_Layout.GetMemorySize()，按GetAlignment()对齐），不负责释放
+				BevBlackboard(const BevBlackboardLayout &_o_Layout, void *_p_Memory);
+				~BevBlackboard();
+
+				//所有值恢复成布局里的初始值，全部算作写过
+				void Reset();
+
+				//key要已经绑定到这个黑板的布局上
+				template <typename T>
+				const T &Get(const BevBlackboardKey<T> &_o_Key) const
+				{
+					D_CHECK(_o_Key.IsBound() && _o_Key.GetOffset() + sizeof(T) <= mui_Size);
+					return *reinterpret_cast<const T *>(mab_Data + _o_Key.GetOffset());
+				}
+				//取出来就算写过了，只读的话用Get
+				template <typename T>
+				T &GetRef(const BevBlackboardKey<T> &_o_Key)
+				{
+					D_CHECK(_o_Key.IsBound() && _o_Key.GetOffset() + sizeof(T) <= mui_Size);
+					_MarkChanged(_o_Key.GetIndex(), _o_Key.GetKey());
+					return *reinterpret_cast<T *>(mab_Data + _o_Key.GetOffset());
+				}
+				template <typename T>
+				void Set(const BevBlackboardKey<T> &_o_Key, const T &_o_Value)
+				{
+					GetRef(_o_Key) = _o_Value;
+				}
+
+				//按名字读写，每次都要查一遍布局，给调试和工具用；没有这个key或者类型不对返回false
+				template <typename T>
+				bool Find(const char *_z_Name, T &_o_Value) const
+				{
+					u32 offset = mo_Layout->FindOffset<T>(_z_Name);
+					if (offset == k_BLimited_InvalidBlackboardOffset)
+						return false;
+					_o_Value = *reinterpret_cast<const T *>(mab_Data + offset);
+					return true;
+				}
+				template <typename T>
+				bool Assign(const char *_z_Name, const T &_o_Value)
+				{
+					u32 index = mo_Layout->FindIndex<T>(_z_Name);
+					if (index == k_BLimited_InvalidBlackboardOffset)
+						return false;
+					_MarkChanged(index, mo_Layout->GetKeyHash(index));
+					*reinterpret_cast<T *>(mab_Data + mo_Layout->GetKeyOffset(index)) = _o_Value;
+					return true;
+				}
+
+				//上一次根节点评估结束以后有没有写过
+				template <typename T>
+				bool IsChanged(const BevBlackboardKey<T> &_o_Key) const
+				{
+					return IsChanged(_o_Key.GetIndex());
+				}
+				bool IsChanged(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mui_KeyCount);
+					return (maui_Changed[_ui_Index >> 5] & (1u << (_ui_Index & 31))) != 0;
+				}
+				bool HasChanges() const;
+				//每个key一位，按序号排，一共oGetLayout().GetChangeWordCount()个u32
+				const u32 *GetChangedBits() const
+				{
+					return maui_Changed;
+				}
+				void ClearChanges();
+
+				//挂在哪个agent上，写的时候标它的脏
+				BevAgentState *oGetAgent() const
+				{
+					return mo_Agent;
+				}
+
+				const BevBlackboardLayout &oGetLayout() const
+				{
+					return *mo_Layout;
+				}
+				u8 *GetData()
+				{
+					return mab_Data;
+				}
+				const u8 *GetData() const
+				{
+					return mab_Data;
+				}
+				u32 GetSize() const
+				{
+					return mui_Size;
+				}
+
+			private:
+				BevBlackboard(const BevBlackboard &);
+				BevBlackboard &operator=(const BevBlackboard &);
+				//并发的并行节点用的分身：值和_o_Shared共用，写入记录放在_ui_Changed里（GetChangeWordCount()个u32）
+				BevBlackboard(BevBlackboard &_o_Shared, u32 *_ui_Changed);
+				//把分身的写入记录并进来
+				void _MergeChanges(const u32 *_ui_Changed);
+
+				void _Init();
+				void _MarkChanged(u32 _ui_Index, u32 _ui_Key)
+				{
+					maui_Changed[_ui_Index >> 5] |= 1u << (_ui_Index & 31);
+					if (mo_Agent)
+						mo_Agent->MarkDirty(_ui_Key);
+				}
+
+			private:
+				const BevBlackboardLayout *mo_Layout;
+				u32 mui_Size;
+				u32 mui_KeyCount;
+				u8 *mab_Data;
+				bool mb_OwnData;
+				//写入记录，在mab_Data里值的后面
+				u32 *maui_Changed;
+				//由BevAgentState::SetBlackboard设置
+				BevAgentState *mo_Agent;
+			};
+
+			//---------------------------------------------------------------------------------------------------------------------------------
+
+			//只读黑板的条件，从agent上挂的黑板求值，不用input；agent没挂黑板时不能用
+			//只依赖黑板的话用WatchKey(key.GetKey())订阅用到的key，这些key没写过时选择节点可以沿用上次的结果
+			class BevBlackboardPrecondition : public BevNodePrecondition
+			{
+			public:
+				virtual bool BlackboardCondition(const BevBlackboard &_o_Blackboard) const = 0;
+
+				//没有agent就拿不到黑板
+				virtual bool ExternalCondition(const BevNodeInputParam &input) const
+				{
+					D_Output("BevBlackboardPrecondition: needs an agent to read the blackboard, use Check\n");
+					D_CHECK(0);
+					return false;
+				}
+
+			protected:
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					return BlackboardCondition(state.oGetBlackboard());
+				}
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					for (u32 i = 0; i < _ui_Count; ++i)
+						_ab_Results[i] = BlackboardCondition(_o_Agents[_ui_Indices[i]]->oGetBlackboard()) ? 1 : 0;
+				}
+			};
+
+			enum E_BevCompareOp
+			{
+				k_BCO_Equal = 0,
+				k_BCO_NotEqual,
+				k_BCO_Less,
+				k_BCO_LessEqual,
+				k_BCO_Greater,
+				k_BCO_GreaterEqual,
+			};
+
+			//黑板上的值和常量比较，比如 health < 30；订阅了比较的key
+			template <typename T>
+			class BevBlackboardCompare : public BevBlackboardPrecondition
+			{
+			public:
+				BevBlackboardCompare(const char *_z_Name, E_BevCompareOp _e_Op, const T &_o_Value)
+					: mo_Key(_z_Name), me_Op(_e_Op), mo_Value(_o_Value)
+				{
+					WatchKey(mo_Key.GetKey());
+				}
+				virtual bool BlackboardCondition(const BevBlackboard &_o_Blackboard) const
+				{
+					const T &value = _o_Blackboard.Get(mo_Key);
+					switch (me_Op)
+					{
+					case k_BCO_Equal:
+						return value == mo_Value;
+					case k_BCO_NotEqual:
+						return !(value == mo_Value);
+					case k_BCO_Less:
+						return value < mo_Value;
+					case k_BCO_LessEqual:
+						return !(mo_Value < value);
+					case k_BCO_Greater:
+						return mo_Value < value;
+					case k_BCO_GreaterEqual:
+						return !(value < mo_Value);
+					}
+					return false;
+				}
+				virtual void BindBlackboard(BevBlackboardLayout &_o_Layout) const
+				{
+					mo_Key.Bind(_o_Layout);
+				}
+				const BevBlackboardKey<T> &oGetKey() const
+				{
+					return mo_Key;
+				}
+
+			private:
+				BevBlackboardKey<T> mo_Key;
+				E_BevCompareOp me_Op;
+				T mo_Value;
+			};
+		}
+	}
+}
+
+#endif
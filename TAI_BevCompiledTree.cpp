@@ -0,0 +1,995 @@
+#include "TAI_BevCompiledTree.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			BevCompiledTree::BevCompiledTree()
+				: mo_Root(NULL), mao_NodeData(NULL), mui_NodeCount(0), mui_GroupStartSize(0), mui_TreeStateSize(0), mui_ConditionCacheOffset(0), mui_ConditionCacheCount(0), mab_InitialState(NULL)
+			{
+			}
+
+			void BevCompiledTree::Clear()
+			{
+				mo_Root = NULL;
+				mao_Nodes.clear();
+				mao_NodeData = NULL;
+				mui_NodeCount = 0;
+				mao_Objects.clear();
+				mao_Preconditions.clear();
+				mao_Programs.clear();
+				mui_GroupStartSize = 0;
+				mui_TreeStateSize = 0;
+				mui_ConditionCacheOffset = 0;
+				mui_ConditionCacheCount = 0;
+				mab_InitialState = NULL;
+			}
+
+			bool BevCompiledTree::Compile(const BevNode &_o_Root)
+			{
+				Clear();
+				if (_o_Root.GetTreeStateSize() == 0)
+				{
+					D_Output("BuildStateLayout must be called before compiling the tree\n");
+					return false;
+				}
+				mo_Root = &_o_Root;
+
+				//按层序展开，每个节点的孩子连续分配，孩子范围直接就是节点数组的下标
+				std::vector<const BevNode *> order;
+				order.push_back(&_o_Root);
+				for (u32 i = 0; i < order.size(); ++i)
+				{
+					for (int c = 0; c < order[i]->GetChildNodeCount(); ++c)
+						order.push_back(order[i]->oGetChildNode(c));
+				}
+				mao_Nodes.resize(order.size());
+				u32 firstChild = 1;
+				for (u32 i = 0; i < order.size(); ++i)
+				{
+					_FillNode(i, order[i]);
+					mao_Nodes[i].mui_FirstChild = firstChild;
+					firstChild += mao_Nodes[i].mui_ChildCount;
+					if (mao_Nodes[i].mui_ChildCount > 0)
+						mui_GroupStartSize += mao_Nodes[i].mui_ChildCount + 2;
+				}
+				mao_NodeData = &mao_Nodes[0];
+				mui_NodeCount = (u32)mao_Nodes.size();
+				mui_TreeStateSize = _o_Root.GetTreeStateSize();
+				mui_ConditionCacheOffset = _o_Root.GetConditionCacheOffset();
+				mui_ConditionCacheCount = _o_Root.GetConditionCacheCount();
+				return true;
+			}
+
+			void BevCompiledTree::_FillNode(u32 _ui_Index, const BevNode *_o_Node)
+			{
+				BevCompiledNode &record = mao_Nodes[_ui_Index];
+				record.me_NodeType = (u8)_o_Node->GetNodeType();
+				record.me_FinishCondition = k_PFC_OR;
+				record.mui_PreconditionIndex = k_BLimited_InvalidPreconditionIndex;
+				record.mui_FirstChild = 0;
+				record.mui_ChildCount = _o_Node->GetChildNodeCount();
+				record.mi_LoopCount = BevNodeLoop::kInfiniteLoop;
+				record.mui_StateOffset = _o_Node->GetStateOffset();
+				record.mui_WatchMask = _o_Node->GetWatchMask();
+				record.mb_Watchable = _o_Node->IsWatchable();
+				record.mui_AbortFlags = (u8)_o_Node->GetAbortFlags();
+				//只有有优先级的选择节点看中断标记
+				record.mb_HasAbortChildren = record.me_NodeType == k_BNT_PrioritySelector && _o_Node->HasAbortChildren();
+				record.mui_ObjectIndex = k_BLimited_InvalidObjectIndex;
+
+				const BevNodePrecondition *precondition = _o_Node->oGetNodePrecondition();
+				if (precondition)
+				{
+					D_CHECK(mao_Preconditions.size() < k_BLimited_InvalidPreconditionIndex);
+					record.mui_PreconditionIndex = (u16)mao_Preconditions.size();
+					mao_Preconditions.push_back(precondition);
+					//单个叶子条件直接调用就行，编译了反而多一层
+					mao_Programs.push_back(BevPreconditionProgram());
+					if (precondition->GetPreconditionType() != k_BPT_Leaf && precondition->GetPreconditionType() != k_BPT_FUNC)
+						mao_Programs.back().Compile(*precondition);
+				}
+				if (record.me_NodeType == k_BNT_Parallel)
+				{
+					const BevNodeParallel *parallel = static_cast<const BevNodeParallel *>(_o_Node);
+					record.me_FinishCondition = (u8)parallel->GetFinishCondition();
+					//并发执行的并行节点交回给节点自己（当作自定义节点），孩子仍然走原来的树
+					if (parallel->oGetJobPool())
+						record.me_NodeType = k_BNT_Custom;
+				}
+				else if (record.me_NodeType == k_BNT_Loop)
+					record.mi_LoopCount = static_cast<const BevNodeLoop *>(_o_Node)->GetLoopCount();
+				if (record.me_NodeType == k_BNT_Terminal || record.me_NodeType == k_BNT_Custom)
+				{
+					record.mui_ObjectIndex = (u32)mao_Objects.size();
+					mao_Objects.push_back(_o_Node);
+				}
+			}
+
+			//-------------------------------------------------------------------------------------
+			// 分发：按类型switch到各自的函数，只有行为节点和自定义节点才走虚函数
+			//-------------------------------------------------------------------------------------
+			D_Inline bool BevCompiledTree::_Evaluate(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				const BevCompiledNode &node = mao_NodeData[_ui_Index];
+				if (node.mui_PreconditionIndex != k_BLimited_InvalidPreconditionIndex && !_CheckPrecondition(node, state, input))
+					return false;
+				return _EvaluateBody(_ui_Index, state, input);
+			}
+			D_Inline bool BevCompiledTree::_EvaluateBody(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				const BevCompiledNode &node = mao_NodeData[_ui_Index];
+				switch (node.me_NodeType)
+				{
+				case k_BNT_PrioritySelector:
+					return _EvaluateSelector(node, state, input);
+				case k_BNT_NonePrioritySelector:
+					return _EvaluateNonePrioritySelector(node, state, input);
+				case k_BNT_Sequence:
+					return _EvaluateSequence(node, state, input);
+				case k_BNT_Parallel:
+					return _EvaluateParallel(node, state, input);
+				case k_BNT_Loop:
+					return _EvaluateLoop(node, state, input);
+				default:
+					//行为节点和自定义节点，前提条件已经查过了
+					return _oGetObject(node)->_DoEvaluate(state, input);
+				}
+			}
+			D_Inline void BevCompiledTree::_Transition(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				const BevCompiledNode &node = mao_NodeData[_ui_Index];
+				switch (node.me_NodeType)
+				{
+				case k_BNT_PrioritySelector:
+				case k_BNT_NonePrioritySelector:
+					_TransitionSelector(node, state, input);
+					break;
+				case k_BNT_Sequence:
+					_TransitionSequence(node, state, input);
+					break;
+				case k_BNT_Parallel:
+					_TransitionParallel(node, state, input);
+					break;
+				case k_BNT_Loop:
+					_TransitionLoop(node, state, input);
+					break;
+				default:
+					_oGetObject(node)->Transition(state, input);
+					break;
+				}
+			}
+			D_Inline BevRunningStatus BevCompiledTree::_Tick(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				const BevCompiledNode &node = mao_NodeData[_ui_Index];
+				switch (node.me_NodeType)
+				{
+				case k_BNT_PrioritySelector:
+				case k_BNT_NonePrioritySelector:
+					return _TickSelector(node, state, input, output);
+				case k_BNT_Sequence:
+					return _TickSequence(node, state, input, output);
+				case k_BNT_Parallel:
+					return _TickParallel(node, state, input, output);
+				case k_BNT_Loop:
+					return _TickLoop(node, state, input, output);
+				default:
+					return _oGetObject(node)->Tick(state, input, output);
+				}
+			}
+
+			bool BevCompiledTree::Evaluate(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				D_CHECK(mui_NodeCount > 0);
+				state.BeginEvaluate();
+				bool bResult = _Evaluate(0, state, input);
+				state.EndEvaluate(bResult);
+				state.Trace(k_BTE_Evaluate, mo_Root, bResult);
+				return bResult;
+			}
+			void BevCompiledTree::Transition(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				D_CHECK(mui_NodeCount > 0);
+				_Transition(0, state, input);
+			}
+			BevRunningStatus BevCompiledTree::Tick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				D_CHECK(mui_NodeCount > 0);
+				return _Tick(0, state, input, output);
+			}
+
+			//-------------------------------------------------------------------------------------
+			// Selector
+			//-------------------------------------------------------------------------------------
+			bool BevCompiledTree::_EvaluateSelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, state);
+				if (_o_Node.mb_HasAbortChildren && _IsObserving(s, _o_Node) && _EvaluateSelectorObserved(_o_Node, state, input))
+					return true;
+				s.mui_CurrentSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				u32 knownFail = s.mui_KnownFailCount;
+				u32 knownStamp = s.mui_KnownFailStamp;
+				s.mui_KnownFailStamp = state.GetEvaluateStamp();
+				s.mui_ObserveStamp = s.mui_KnownFailStamp;
+				for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+				{
+					u32 child = _GetChild(_o_Node, i);
+					if (i < knownFail && _IsUnchanged(child, state, knownStamp))
+						continue;
+					if (_Evaluate(child, state, input))
+					{
+						s.mui_CurrentSelectIndex = (u16)i;
+						s.mui_KnownFailCount = (u16)i;
+						s.mui_ObserveCount = (u16)i;
+						return true;
+					}
+				}
+				s.mui_KnownFailCount = (u16)_o_Node.mui_ChildCount;
+				s.mui_ObserveCount = (u16)_o_Node.mui_ChildCount;
+				return false;
+			}
+			bool BevCompiledTree::_EvaluateSelectorObserved(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, state);
+				u32 running = s.mui_LastSelectIndex;
+				u32 observeCount = s.mui_ObserveCount;
+				u32 observeStamp = s.mui_ObserveStamp;
+				s.mui_ObserveStamp = state.GetEvaluateStamp();
+				for (u32 i = 0; i < running; ++i)
+				{
+					u32 child = _GetChild(_o_Node, i);
+					if (!(mao_NodeData[child].mui_AbortFlags & k_BAF_LowerPriority) || (i < observeCount && _IsUnchanged(child, state, observeStamp)))
+						continue;
+					if (_Evaluate(child, state, input))
+					{
+						s.mui_CurrentSelectIndex = (u16)i;
+						s.mui_ObserveCount = (u16)i;
+						if (s.mui_KnownFailCount > i)
+							s.mui_KnownFailCount = (u16)i;
+						return true;
+					}
+				}
+				u32 child = _GetChild(_o_Node, running);
+				if ((mao_NodeData[child].mui_AbortFlags & k_BAF_Self) ? _Evaluate(child, state, input) : _EvaluateBody(child, state, input))
+				{
+					s.mui_CurrentSelectIndex = (u16)running;
+					s.mui_ObserveCount = (u16)running;
+					return true;
+				}
+				return false;
+			}
+			bool BevCompiledTree::_EvaluateNonePrioritySelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, state);
+				if (s.mui_CurrentSelectIndex < _o_Node.mui_ChildCount &&
+					_Evaluate(_GetChild(_o_Node, s.mui_CurrentSelectIndex), state, input))
+					return true;
+				return _EvaluateSelector(_o_Node, state, input);
+			}
+			void BevCompiledTree::_TransitionSelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, state);
+				if (s.mui_LastSelectIndex < _o_Node.mui_ChildCount)
+				{
+					_Transition(_GetChild(_o_Node, s.mui_LastSelectIndex), state, input);
+					if (s.mui_KnownFailCount > s.mui_LastSelectIndex)
+						s.mui_KnownFailCount = s.mui_LastSelectIndex;
+					if (s.mui_ObserveCount > s.mui_LastSelectIndex)
+						s.mui_ObserveCount = s.mui_LastSelectIndex;
+				}
+				s.mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
+			}
+			BevRunningStatus BevCompiledTree::_TickSelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, state);
+				BevRunningStatus bIsFinish = k_BRS_Finish;
+				if (s.mui_CurrentSelectIndex < _o_Node.mui_ChildCount && s.mui_LastSelectIndex != s.mui_CurrentSelectIndex)
+				{
+					if (s.mui_LastSelectIndex < _o_Node.mui_ChildCount)
+					{
+						_Transition(_GetChild(_o_Node, s.mui_LastSelectIndex), state, input);
+						if (s.mui_KnownFailCount > s.mui_LastSelectIndex)
+							s.mui_KnownFailCount = s.mui_LastSelectIndex;
+						if (s.mui_ObserveCount > s.mui_LastSelectIndex)
+							s.mui_ObserveCount = s.mui_LastSelectIndex;
+					}
+					s.mui_LastSelectIndex = s.mui_CurrentSelectIndex;
+				}
+				if (s.mui_LastSelectIndex < _o_Node.mui_ChildCount)
+				{
+					bIsFinish = _Tick(_GetChild(_o_Node, s.mui_LastSelectIndex), state, input, output);
+					if (bIsFinish)
+						s.mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				}
+				return bIsFinish;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// Sequence
+			//-------------------------------------------------------------------------------------
+			bool BevCompiledTree::_EvaluateSequence(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevSequenceState &s = _GetState<BevSequenceState>(_o_Node, state);
+				u32 testNode = s.mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex ? 0 : s.mui_CurrentNodeIndex;
+				return testNode < _o_Node.mui_ChildCount && _Evaluate(_GetChild(_o_Node, testNode), state, input);
+			}
+			void BevCompiledTree::_TransitionSequence(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevSequenceState &s = _GetState<BevSequenceState>(_o_Node, state);
+				if (s.mui_CurrentNodeIndex < _o_Node.mui_ChildCount)
+					_Transition(_GetChild(_o_Node, s.mui_CurrentNodeIndex), state, input);
+				s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+			}
+			BevRunningStatus BevCompiledTree::_TickSequence(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				BevSequenceState &s = _GetState<BevSequenceState>(_o_Node, state);
+				if (s.mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex)
+					s.mui_CurrentNodeIndex = 0;
+
+				BevRunningStatus bIsFinish = _Tick(_GetChild(_o_Node, s.mui_CurrentNodeIndex), state, input, output);
+				if (bIsFinish == k_BRS_Finish)
+				{
+					++s.mui_CurrentNodeIndex;
+					if (s.mui_CurrentNodeIndex == _o_Node.mui_ChildCount)
+						s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+					else
+						bIsFinish = k_BRS_Executing;
+				}
+				if (bIsFinish < 0)
+					s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+				return bIsFinish;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// Parallel
+			//-------------------------------------------------------------------------------------
+			bool BevCompiledTree::_EvaluateParallel(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				s8 *abChildNodeStatus = &_GetState<s8>(_o_Node, state);
+				for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+				{
+					if (abChildNodeStatus[i] == k_BRS_Executing && !_Evaluate(_GetChild(_o_Node, i), state, input))
+						return false;
+				}
+				return true;
+			}
+			void BevCompiledTree::_TransitionParallel(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				s8 *abChildNodeStatus = &_GetState<s8>(_o_Node, state);
+				for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+					abChildNodeStatus[i] = k_BRS_Executing;
+				for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+					_Transition(_GetChild(_o_Node, i), state, input);
+			}
+			BevRunningStatus BevCompiledTree::_TickParallel(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				s8 *abChildNodeStatus = &_GetState<s8>(_o_Node, state);
+				u32 finishedChildCount = 0;
+				for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+				{
+					if (abChildNodeStatus[i] == k_BRS_Executing)
+						abChildNodeStatus[i] = (s8)_Tick(_GetChild(_o_Node, i), state, input, output);
+					if (abChildNodeStatus[i] != k_BRS_Executing)
+					{
+						//OR：任意一个孩子结束就结束
+						if (_o_Node.me_FinishCondition == k_PFC_OR)
+						{
+							finishedChildCount = _o_Node.mui_ChildCount;
+							break;
+						}
+						finishedChildCount++;
+					}
+				}
+				if (finishedChildCount == _o_Node.mui_ChildCount)
+				{
+					for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+						abChildNodeStatus[i] = k_BRS_Executing;
+					return k_BRS_Finish;
+				}
+				return k_BRS_Executing;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// Loop
+			//-------------------------------------------------------------------------------------
+			bool BevCompiledTree::_EvaluateLoop(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevLoopState &s = _GetState<BevLoopState>(_o_Node, state);
+				if (_o_Node.mi_LoopCount != BevNodeLoop::kInfiniteLoop && s.mi_CurrentCount >= _o_Node.mi_LoopCount)
+					return false;
+				return _o_Node.mui_ChildCount > 0 && _Evaluate(_GetChild(_o_Node, 0), state, input);
+			}
+			void BevCompiledTree::_TransitionLoop(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				if (_o_Node.mui_ChildCount > 0)
+					_Transition(_GetChild(_o_Node, 0), state, input);
+				_GetState<BevLoopState>(_o_Node, state).mi_CurrentCount = 0;
+			}
+			BevRunningStatus BevCompiledTree::_TickLoop(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				BevLoopState &s = _GetState<BevLoopState>(_o_Node, state);
+				BevRunningStatus bIsFinish = k_BRS_Finish;
+				if (_o_Node.mui_ChildCount > 0)
+				{
+					bIsFinish = _Tick(_GetChild(_o_Node, 0), state, input, output);
+					if (bIsFinish == k_BRS_Finish)
+					{
+						if (_o_Node.mi_LoopCount != BevNodeLoop::kInfiniteLoop)
+						{
+							s.mi_CurrentCount++;
+							if (s.mi_CurrentCount < _o_Node.mi_LoopCount)
+								bIsFinish = k_BRS_Executing;
+						}
+						else
+						{
+							bIsFinish = k_BRS_Executing;
+						}
+					}
+				}
+				if (bIsFinish)
+					s.mi_CurrentCount = 0;
+				return bIsFinish;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// 批量执行
+			//-------------------------------------------------------------------------------------
+			void BevBatchScratch::Reserve(u32 _ui_AgentCount)
+			{
+				if (mao_Indices.size() >= _ui_AgentCount)
+					return;
+				mab_Pass.resize(_ui_AgentCount);
+				mab_Result.resize(_ui_AgentCount);
+				mao_Indices.resize(_ui_AgentCount);
+				mao_Temp.resize(_ui_AgentCount);
+				mao_Keys.resize(_ui_AgentCount);
+				mab_Flags.resize(_ui_AgentCount);
+				mab_Missed.resize(_ui_AgentCount);
+			}
+
+			u32 BevCompiledTree::_PartitionBatch(BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count)
+			{
+				const u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+				u32 *temp = &ctx.mo_Scratch->mao_Temp[0];
+				u32 kept = 0;
+				u32 rejected = 0;
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					if (flags[k])
+						_ui_Ids[kept++] = _ui_Ids[k];
+					else
+						temp[rejected++] = _ui_Ids[k];
+				}
+				memcpy(_ui_Ids + kept, temp, rejected * sizeof(u32));
+				return kept;
+			}
+
+			void BevCompiledTree::_GroupBatch(BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count, u32 _ui_KeyCount, u32 *_ui_GroupStart)
+			{
+				D_CHECK(_ui_KeyCount <= k_BLimited_MaxChildNodeCnt + 1);
+				const u16 *keys = &ctx.mo_Scratch->mao_Keys[0];
+				u32 *temp = &ctx.mo_Scratch->mao_Temp[0];
+				//_ui_GroupStart[k]先当第k组的写入位置用，写完正好是第k组的结尾，再整体往后挪一格
+				memset(_ui_GroupStart, 0, (_ui_KeyCount + 1) * sizeof(u32));
+				for (u32 k = 0; k < _ui_Count; ++k)
+					_ui_GroupStart[keys[k] + 1]++;
+				for (u32 c = 1; c < _ui_KeyCount; ++c)
+					_ui_GroupStart[c] += _ui_GroupStart[c - 1];
+				for (u32 k = 0; k < _ui_Count; ++k)
+					temp[_ui_GroupStart[keys[k]]++] = _ui_Ids[k];
+				for (u32 c = _ui_KeyCount; c > 0; --c)
+					_ui_GroupStart[c] = _ui_GroupStart[c - 1];
+				_ui_GroupStart[0] = 0;
+				memcpy(_ui_Ids, temp, _ui_Count * sizeof(u32));
+			}
+
+			void BevCompiledTree::_CheckPreconditionBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, const u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+				const BevPreconditionProgram &program = mao_Programs[_o_Node.mui_PreconditionIndex];
+				if (!program.IsEmpty())
+				{
+					program.RunBatch(ctx.mo_Agents, ctx.mo_Inputs, _ui_Ids, _ui_Count, flags);
+					return;
+				}
+
+				const BevNodePrecondition *precondition = mao_Preconditions[_o_Node.mui_PreconditionIndex];
+				u32 slot = precondition->mui_CacheSlot;
+				if (slot == k_BLimited_InvalidCacheSlot)
+				{
+					precondition->_DoCheckBatch(ctx.mo_Agents, ctx.mo_Inputs, _ui_Ids, _ui_Count, flags);
+					return;
+				}
+
+				//没命中的先记成2，下标收集到临时数组里
+				u32 *missed = &ctx.mo_Scratch->mao_Temp[0];
+				u32 missCount = 0;
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					bool bResult;
+					if (ctx.mo_Agents[_ui_Ids[k]]->GetCachedCondition(slot, bResult))
+						flags[k] = bResult ? 1 : 0;
+					else
+					{
+						flags[k] = 2;
+						missed[missCount++] = _ui_Ids[k];
+					}
+				}
+				if (missCount == 0)
+					return;
+
+				u8 *results = &ctx.mo_Scratch->mab_Missed[0];
+				precondition->_DoCheckBatch(ctx.mo_Agents, ctx.mo_Inputs, missed, missCount, results);
+				for (u32 k = 0, m = 0; k < _ui_Count; ++k)
+				{
+					if (flags[k] != 2)
+						continue;
+					flags[k] = results[m++];
+					ctx.mo_Agents[_ui_Ids[k]]->SetCachedCondition(slot, flags[k] != 0);
+				}
+			}
+
+			void BevCompiledTree::TickBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, BevNodeOutputParam *_o_Outputs, u32 _ui_Count,
+											BevBatchScratch &_o_Scratch, BevRunningStatus *_ae_Results) const
+			{
+				D_CHECK(mui_NodeCount > 0);
+				//分段执行，一段agent的状态块能留在缓存里，不然每个节点都要把所有agent扫一遍
+				for (u32 start = 0; start < _ui_Count; start += k_BLimited_BatchSize)
+				{
+					u32 count = _ui_Count - start < k_BLimited_BatchSize ? _ui_Count - start : k_BLimited_BatchSize;
+					_TickBatchRange(_o_Agents + start, _o_Inputs + start, _o_Outputs + start, count, _o_Scratch, _ae_Results ? _ae_Results + start : NULL);
+				}
+			}
+
+			void BevCompiledTree::_TickBatchRange(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, BevNodeOutputParam *_o_Outputs, u32 _ui_Count,
+												  BevBatchScratch &_o_Scratch, BevRunningStatus *_ae_Results) const
+			{
+				_o_Scratch.Reserve(_ui_Count);
+				if (_o_Scratch.mao_GroupStart.size() < mui_GroupStartSize)
+					_o_Scratch.mao_GroupStart.resize(mui_GroupStartSize);
+				D_CHECK(_o_Scratch.mui_GroupStartTop == 0);
+
+				BatchContext ctx;
+				ctx.mo_Agents = _o_Agents;
+				ctx.mo_Inputs = _o_Inputs;
+				ctx.mo_Outputs = _o_Outputs;
+				ctx.mo_Scratch = &_o_Scratch;
+
+				u32 *ids = &_o_Scratch.mao_Indices[0];
+				for (u32 i = 0; i < _ui_Count; ++i)
+				{
+					D_CHECK(_o_Agents[i]->IsRoot(mo_Root));
+					_o_Agents[i]->BeginEvaluate();
+					ids[i] = i;
+				}
+				_EvaluateBatch(0, ctx, ids, _ui_Count);
+				const u8 *pass = &_o_Scratch.mab_Pass[0];
+				for (u32 i = 0; i < _ui_Count; ++i)
+				{
+					_o_Agents[i]->EndEvaluate(pass[i] != 0);
+					_o_Agents[i]->Trace(k_BTE_Evaluate, mo_Root, pass[i]);
+				}
+
+				//通过评估的挪到前面，只对它们Tick
+				u8 *flags = &_o_Scratch.mab_Flags[0];
+				for (u32 k = 0; k < _ui_Count; ++k)
+					flags[k] = pass[ids[k]];
+				u32 passed = _PartitionBatch(ctx, ids, _ui_Count);
+				if (passed > 0)
+					_TickBatch(0, ctx, ids, passed);
+
+				if (_ae_Results)
+				{
+					const s8 *result = &_o_Scratch.mab_Result[0];
+					for (u32 k = 0; k < _ui_Count; ++k)
+						_ae_Results[ids[k]] = k < passed ? (BevRunningStatus)result[ids[k]] : k_BRS_Finish;
+				}
+			}
+
+			void BevCompiledTree::_EvaluateBatch(u32 _ui_Index, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				const BevCompiledNode &node = mao_NodeData[_ui_Index];
+				u8 *pass = &ctx.mo_Scratch->mab_Pass[0];
+				if (node.mui_PreconditionIndex != k_BLimited_InvalidPreconditionIndex)
+				{
+					_CheckPreconditionBatch(node, ctx, _ui_Ids, _ui_Count);
+					u32 passed = _PartitionBatch(ctx, _ui_Ids, _ui_Count);
+					for (u32 k = passed; k < _ui_Count; ++k)
+						pass[_ui_Ids[k]] = false;
+					_ui_Count = passed;
+					if (_ui_Count == 0)
+						return;
+				}
+
+				switch (node.me_NodeType)
+				{
+				case k_BNT_PrioritySelector:
+					_EvaluateSelectorBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_NonePrioritySelector:
+					_EvaluateNonePrioritySelectorBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_Sequence:
+					_EvaluateSequenceBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_Parallel:
+					_EvaluateParallelBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_Loop:
+					_EvaluateLoopBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				default:
+				{
+					//行为节点和自定义节点整段交给节点，重载了_DoEvaluateBatch的可以一次算完
+					u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+					_oGetObject(node)->_DoEvaluateBatch(ctx.mo_Agents, ctx.mo_Inputs, _ui_Ids, _ui_Count, flags);
+					for (u32 k = 0; k < _ui_Count; ++k)
+						pass[_ui_Ids[k]] = flags[k];
+					break;
+				}
+				}
+			}
+
+			void BevCompiledTree::_TickBatch(u32 _ui_Index, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				const BevCompiledNode &node = mao_NodeData[_ui_Index];
+				switch (node.me_NodeType)
+				{
+				case k_BNT_PrioritySelector:
+				case k_BNT_NonePrioritySelector:
+					_TickSelectorBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_Sequence:
+					_TickSequenceBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_Parallel:
+					_TickParallelBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				case k_BNT_Loop:
+					_TickLoopBatch(node, ctx, _ui_Ids, _ui_Count);
+					break;
+				default:
+				{
+					s8 *result = &ctx.mo_Scratch->mab_Result[0];
+					for (u32 k = 0; k < _ui_Count; ++k)
+					{
+						u32 id = _ui_Ids[k];
+						result[id] = (s8)_oGetObject(node)->Tick(*ctx.mo_Agents[id], ctx.mo_Inputs[id], ctx.mo_Outputs[id]);
+					}
+					break;
+				}
+				}
+			}
+
+			void BevCompiledTree::_EvaluateSelectorBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				u8 *pass = &ctx.mo_Scratch->mab_Pass[0];
+				u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+				if (_o_Node.mb_HasAbortChildren)
+				{
+					//有孩子正在运行的agent逐个只查带中断标记的孩子，被中断的和没在运行的留在前面一起重新选
+					for (u32 k = 0; k < _ui_Count; ++k)
+					{
+						u32 id = _ui_Ids[k];
+						BevAgentState &agent = *ctx.mo_Agents[id];
+						flags[k] = !(_IsObserving(_GetState<BevSelectorState>(_o_Node, agent), _o_Node) && _EvaluateSelectorObserved(_o_Node, agent, ctx.mo_Inputs[id]));
+					}
+					u32 rescan = _PartitionBatch(ctx, _ui_Ids, _ui_Count);
+					for (u32 k = rescan; k < _ui_Count; ++k)
+						pass[_ui_Ids[k]] = true;
+					_ui_Count = rescan;
+				}
+				for (u32 k = 0; k < _ui_Count; ++k)
+					_GetState<BevSelectorState>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]).mui_CurrentSelectIndex = k_BLimited_InvalidChildNodeIndex;
+
+				//还没选中的agent留在前面，继续试下一个孩子
+				u32 pending = _ui_Count;
+				for (u32 i = 0; i < _o_Node.mui_ChildCount && pending > 0; ++i)
+				{
+					u32 child = _GetChild(_o_Node, i);
+					//已知不通过、依赖的key也没变的agent挪到后面，不用评估
+					u32 evaluated = pending;
+					if (mao_NodeData[child].mb_Watchable)
+					{
+						for (u32 k = 0; k < pending; ++k)
+						{
+							BevAgentState &agent = *ctx.mo_Agents[_ui_Ids[k]];
+							BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, agent);
+							flags[k] = !(i < s.mui_KnownFailCount && _IsUnchanged(child, agent, s.mui_KnownFailStamp));
+						}
+						evaluated = _PartitionBatch(ctx, _ui_Ids, pending);
+					}
+					if (evaluated > 0)
+						_EvaluateBatch(child, ctx, _ui_Ids, evaluated);
+					for (u32 k = 0; k < pending; ++k)
+						flags[k] = k >= evaluated || !pass[_ui_Ids[k]];
+					u32 failed = _PartitionBatch(ctx, _ui_Ids, pending);
+					for (u32 k = failed; k < pending; ++k)
+					{
+						BevAgentState &agent = *ctx.mo_Agents[_ui_Ids[k]];
+						BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, agent);
+						s.mui_CurrentSelectIndex = (u16)i;
+						s.mui_KnownFailCount = (u16)i;
+						s.mui_KnownFailStamp = agent.GetEvaluateStamp();
+						s.mui_ObserveCount = (u16)i;
+						s.mui_ObserveStamp = s.mui_KnownFailStamp;
+					}
+					pending = failed;
+				}
+				for (u32 k = 0; k < pending; ++k)
+				{
+					BevAgentState &agent = *ctx.mo_Agents[_ui_Ids[k]];
+					BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, agent);
+					s.mui_KnownFailCount = (u16)_o_Node.mui_ChildCount;
+					s.mui_KnownFailStamp = agent.GetEvaluateStamp();
+					s.mui_ObserveCount = (u16)_o_Node.mui_ChildCount;
+					s.mui_ObserveStamp = s.mui_KnownFailStamp;
+					pass[_ui_Ids[k]] = false;
+				}
+			}
+			void BevCompiledTree::_EvaluateNonePrioritySelectorBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				const u8 *pass = &ctx.mo_Scratch->mab_Pass[0];
+				u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+				u16 *keys = &ctx.mo_Scratch->mao_Keys[0];
+
+				//有当前选择的先按选择分组，各自试一下当前的孩子
+				for (u32 k = 0; k < _ui_Count; ++k)
+					flags[k] = _GetState<BevSelectorState>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]).mui_CurrentSelectIndex < _o_Node.mui_ChildCount;
+				u32 withCurrent = _PartitionBatch(ctx, _ui_Ids, _ui_Count);
+				if (withCurrent > 0)
+				{
+					for (u32 k = 0; k < withCurrent; ++k)
+						keys[k] = _GetState<BevSelectorState>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]).mui_CurrentSelectIndex;
+					u32 *groupStart = _PushGroupStart(ctx, _o_Node.mui_ChildCount + 1);
+					_GroupBatch(ctx, _ui_Ids, withCurrent, _o_Node.mui_ChildCount, groupStart);
+					for (u32 c = 0; c < _o_Node.mui_ChildCount; ++c)
+					{
+						if (groupStart[c + 1] > groupStart[c])
+							_EvaluateBatch(_GetChild(_o_Node, c), ctx, _ui_Ids + groupStart[c], groupStart[c + 1] - groupStart[c]);
+					}
+					_PopGroupStart(ctx, _o_Node.mui_ChildCount + 1);
+					//失败的挪到后面，和没有当前选择的连在一起，重新按优先级选
+					for (u32 k = 0; k < withCurrent; ++k)
+						flags[k] = pass[_ui_Ids[k]];
+					u32 passed = _PartitionBatch(ctx, _ui_Ids, withCurrent);
+					_ui_Ids += passed;
+					_ui_Count -= passed;
+				}
+				if (_ui_Count > 0)
+					_EvaluateSelectorBatch(_o_Node, ctx, _ui_Ids, _ui_Count);
+			}
+			void BevCompiledTree::_TickSelectorBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				s8 *result = &ctx.mo_Scratch->mab_Result[0];
+				u16 *keys = &ctx.mo_Scratch->mao_Keys[0];
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					u32 id = _ui_Ids[k];
+					BevSelectorState &s = _GetState<BevSelectorState>(_o_Node, *ctx.mo_Agents[id]);
+					if (s.mui_CurrentSelectIndex < _o_Node.mui_ChildCount && s.mui_LastSelectIndex != s.mui_CurrentSelectIndex)
+					{
+						if (s.mui_LastSelectIndex < _o_Node.mui_ChildCount)
+						{
+							_Transition(_GetChild(_o_Node, s.mui_LastSelectIndex), *ctx.mo_Agents[id], ctx.mo_Inputs[id]);
+							if (s.mui_KnownFailCount > s.mui_LastSelectIndex)
+								s.mui_KnownFailCount = s.mui_LastSelectIndex;
+							if (s.mui_ObserveCount > s.mui_LastSelectIndex)
+								s.mui_ObserveCount = s.mui_LastSelectIndex;
+						}
+						s.mui_LastSelectIndex = s.mui_CurrentSelectIndex;
+					}
+					keys[k] = s.mui_LastSelectIndex < _o_Node.mui_ChildCount ? s.mui_LastSelectIndex : (u16)_o_Node.mui_ChildCount;
+				}
+
+				//按正在运行的孩子分组，最后一组是没有运行中孩子的
+				u32 *groupStart = _PushGroupStart(ctx, _o_Node.mui_ChildCount + 2);
+				_GroupBatch(ctx, _ui_Ids, _ui_Count, _o_Node.mui_ChildCount + 1, groupStart);
+				for (u32 c = 0; c < _o_Node.mui_ChildCount; ++c)
+				{
+					if (groupStart[c + 1] > groupStart[c])
+						_TickBatch(_GetChild(_o_Node, c), ctx, _ui_Ids + groupStart[c], groupStart[c + 1] - groupStart[c]);
+				}
+				u32 running = groupStart[_o_Node.mui_ChildCount];
+				_PopGroupStart(ctx, _o_Node.mui_ChildCount + 2);
+				for (u32 k = 0; k < running; ++k)
+				{
+					u32 id = _ui_Ids[k];
+					if (result[id] != k_BRS_Executing)
+						_GetState<BevSelectorState>(_o_Node, *ctx.mo_Agents[id]).mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				}
+				for (u32 k = running; k < _ui_Count; ++k)
+					result[_ui_Ids[k]] = k_BRS_Finish;
+			}
+
+			void BevCompiledTree::_EvaluateSequenceBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				u8 *pass = &ctx.mo_Scratch->mab_Pass[0];
+				u16 *keys = &ctx.mo_Scratch->mao_Keys[0];
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					const BevSequenceState &s = _GetState<BevSequenceState>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]);
+					u32 testNode = s.mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex ? 0 : s.mui_CurrentNodeIndex;
+					keys[k] = (u16)(testNode < _o_Node.mui_ChildCount ? testNode : _o_Node.mui_ChildCount);
+				}
+				u32 *groupStart = _PushGroupStart(ctx, _o_Node.mui_ChildCount + 2);
+				_GroupBatch(ctx, _ui_Ids, _ui_Count, _o_Node.mui_ChildCount + 1, groupStart);
+				for (u32 c = 0; c < _o_Node.mui_ChildCount; ++c)
+				{
+					if (groupStart[c + 1] > groupStart[c])
+						_EvaluateBatch(_GetChild(_o_Node, c), ctx, _ui_Ids + groupStart[c], groupStart[c + 1] - groupStart[c]);
+				}
+				for (u32 k = groupStart[_o_Node.mui_ChildCount]; k < _ui_Count; ++k)
+					pass[_ui_Ids[k]] = false;
+				_PopGroupStart(ctx, _o_Node.mui_ChildCount + 2);
+			}
+			void BevCompiledTree::_TickSequenceBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				s8 *result = &ctx.mo_Scratch->mab_Result[0];
+				u16 *keys = &ctx.mo_Scratch->mao_Keys[0];
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					BevSequenceState &s = _GetState<BevSequenceState>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]);
+					if (s.mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex)
+						s.mui_CurrentNodeIndex = 0;
+					D_CHECK(s.mui_CurrentNodeIndex < _o_Node.mui_ChildCount);
+					keys[k] = s.mui_CurrentNodeIndex;
+				}
+				u32 *groupStart = _PushGroupStart(ctx, _o_Node.mui_ChildCount + 1);
+				_GroupBatch(ctx, _ui_Ids, _ui_Count, _o_Node.mui_ChildCount, groupStart);
+				for (u32 c = 0; c < _o_Node.mui_ChildCount; ++c)
+				{
+					if (groupStart[c + 1] > groupStart[c])
+						_TickBatch(_GetChild(_o_Node, c), ctx, _ui_Ids + groupStart[c], groupStart[c + 1] - groupStart[c]);
+				}
+				_PopGroupStart(ctx, _o_Node.mui_ChildCount + 1);
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					u32 id = _ui_Ids[k];
+					BevSequenceState &s = _GetState<BevSequenceState>(_o_Node, *ctx.mo_Agents[id]);
+					s8 bIsFinish = result[id];
+					if (bIsFinish == k_BRS_Finish)
+					{
+						++s.mui_CurrentNodeIndex;
+						if (s.mui_CurrentNodeIndex == _o_Node.mui_ChildCount)
+							s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+						else
+							bIsFinish = k_BRS_Executing;
+					}
+					if (bIsFinish < 0)
+						s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+					result[id] = bIsFinish;
+				}
+			}
+
+			void BevCompiledTree::_EvaluateParallelBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				u8 *pass = &ctx.mo_Scratch->mab_Pass[0];
+				u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+
+				//任何一个运行中的孩子评估失败，这个agent就失败，挪到后面
+				u32 alive = _ui_Count;
+				for (u32 i = 0; i < _o_Node.mui_ChildCount && alive > 0; ++i)
+				{
+					for (u32 k = 0; k < alive; ++k)
+						flags[k] = (&_GetState<s8>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]))[i] == k_BRS_Executing;
+					u32 running = _PartitionBatch(ctx, _ui_Ids, alive);
+					if (running == 0)
+						continue;
+					_EvaluateBatch(_GetChild(_o_Node, i), ctx, _ui_Ids, running);
+					for (u32 k = 0; k < alive; ++k)
+						flags[k] = k >= running || pass[_ui_Ids[k]];
+					alive = _PartitionBatch(ctx, _ui_Ids, alive);
+				}
+				for (u32 k = 0; k < _ui_Count; ++k)
+					pass[_ui_Ids[k]] = k < alive;
+			}
+			void BevCompiledTree::_TickParallelBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				s8 *result = &ctx.mo_Scratch->mab_Result[0];
+				u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+
+				//OR：有孩子结束的agent挪到后面，不再tick后面的孩子
+				u32 alive = _ui_Count;
+				for (u32 i = 0; i < _o_Node.mui_ChildCount && alive > 0; ++i)
+				{
+					for (u32 k = 0; k < alive; ++k)
+						flags[k] = (&_GetState<s8>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]))[i] == k_BRS_Executing;
+					u32 running = _PartitionBatch(ctx, _ui_Ids, alive);
+					if (running > 0)
+					{
+						_TickBatch(_GetChild(_o_Node, i), ctx, _ui_Ids, running);
+						for (u32 k = 0; k < running; ++k)
+							(&_GetState<s8>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]))[i] = result[_ui_Ids[k]];
+					}
+					if (_o_Node.me_FinishCondition == k_PFC_OR)
+					{
+						for (u32 k = 0; k < alive; ++k)
+							flags[k] = (&_GetState<s8>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]))[i] == k_BRS_Executing;
+						alive = _PartitionBatch(ctx, _ui_Ids, alive);
+					}
+				}
+
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					u32 id = _ui_Ids[k];
+					s8 *abChildNodeStatus = &_GetState<s8>(_o_Node, *ctx.mo_Agents[id]);
+					bool bFinished;
+					if (_o_Node.me_FinishCondition == k_PFC_OR)
+					{
+						bFinished = k >= alive || _o_Node.mui_ChildCount == 0;
+					}
+					else
+					{
+						//AND：所有孩子都结束了才结束
+						bFinished = true;
+						for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+						{
+							if (abChildNodeStatus[i] == k_BRS_Executing)
+							{
+								bFinished = false;
+								break;
+							}
+						}
+					}
+					if (bFinished)
+					{
+						for (u32 i = 0; i < _o_Node.mui_ChildCount; ++i)
+							abChildNodeStatus[i] = k_BRS_Executing;
+						result[id] = k_BRS_Finish;
+					}
+					else
+					{
+						result[id] = k_BRS_Executing;
+					}
+				}
+			}
+
+			void BevCompiledTree::_EvaluateLoopBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				u8 *pass = &ctx.mo_Scratch->mab_Pass[0];
+				u8 *flags = &ctx.mo_Scratch->mab_Flags[0];
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					flags[k] = _o_Node.mui_ChildCount > 0 && (_o_Node.mi_LoopCount == BevNodeLoop::kInfiniteLoop ||
+															   _GetState<BevLoopState>(_o_Node, *ctx.mo_Agents[_ui_Ids[k]]).mi_CurrentCount < _o_Node.mi_LoopCount);
+				}
+				u32 alive = _PartitionBatch(ctx, _ui_Ids, _ui_Count);
+				for (u32 k = alive; k < _ui_Count; ++k)
+					pass[_ui_Ids[k]] = false;
+				if (alive > 0)
+					_EvaluateBatch(_GetChild(_o_Node, 0), ctx, _ui_Ids, alive);
+			}
+			void BevCompiledTree::_TickLoopBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const
+			{
+				s8 *result = &ctx.mo_Scratch->mab_Result[0];
+				if (_o_Node.mui_ChildCount > 0)
+					_TickBatch(_GetChild(_o_Node, 0), ctx, _ui_Ids, _ui_Count);
+				for (u32 k = 0; k < _ui_Count; ++k)
+				{
+					u32 id = _ui_Ids[k];
+					BevLoopState &s = _GetState<BevLoopState>(_o_Node, *ctx.mo_Agents[id]);
+					s8 bIsFinish = _o_Node.mui_ChildCount > 0 ? result[id] : (s8)k_BRS_Finish;
+					if (bIsFinish == k_BRS_Finish)
+					{
+						if (_o_Node.mi_LoopCount != BevNodeLoop::kInfiniteLoop)
+						{
+							s.mi_CurrentCount++;
+							if (s.mi_CurrentCount < _o_Node.mi_LoopCount)
+								bIsFinish = k_BRS_Executing;
+						}
+						else
+						{
+							bIsFinish = k_BRS_Executing;
+						}
+					}
+					if (bIsFinish)
+						s.mi_CurrentCount = 0;
+					result[id] = bIsFinish;
+				}
+			}
+		}
+	}
+}
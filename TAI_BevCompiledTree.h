@@ -0,0 +1,262 @@
+#ifndef __TAI_BEVCOMPILEDTREE_H__
+#define __TAI_BEVCOMPILEDTREE_H__
+
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevPreconditionProgram.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+#define k_BLimited_InvalidPreconditionIndex 0xffff
+#define k_BLimited_InvalidObjectIndex 0xffffffff
+//TickBatch每次一起处理的agent数量
+#ifndef k_BLimited_BatchSize
+#define k_BLimited_BatchSize 64
+#endif
+
+			//编译后的节点记录，放在一个连续数组里，同一个节点的孩子在数组里是相邻的
+			//里面只有下标没有指针，BevTreeImage可以把整个数组原样存下来，映射进来直接执行
+			struct BevCompiledNode
+			{
+				//E_BevNodeType
+				u8 me_NodeType;
+				//并行节点的完成条件
+				u8 me_FinishCondition;
+				//前提条件在前提条件表中的索引
+				u16 mui_PreconditionIndex;
+				//孩子在节点数组中的范围[mui_FirstChild, mui_FirstChild + mui_ChildCount)
+				u32 mui_FirstChild;
+				u32 mui_ChildCount;
+				//循环节点的次数
+				s32 mi_LoopCount;
+				//在agent状态块中的偏移，和BevNode::BuildStateLayout分配的一致
+				u32 mui_StateOffset;
+				//子树依赖的key的掩码，mb_Watchable为false时每次都要评估
+				u32 mui_WatchMask;
+				//行为节点和自定义控制节点仍然通过原始节点调用，这是它在节点对象表里的下标
+				u32 mui_ObjectIndex;
+				bool mb_Watchable;
+				//E_BevAbortFlag，父亲是有优先级的选择节点时才有用
+				u8 mui_AbortFlags;
+				//有优先级的选择节点下有孩子带中断标记
+				bool mb_HasAbortChildren;
+			};
+
+			//批量tick用的临时内存，按agent数量分配，跨帧复用避免反复分配；多个线程同时跑批量tick时每个线程一份
+			class BevBatchScratch
+			{
+				friend class BevCompiledTree;
+
+			public:
+				BevBatchScratch()
+					: mui_GroupStartTop(0)
+				{
+				}
+				void Reserve(u32 _ui_AgentCount);
+
+			private:
+				//按agent下标存放的评估结果和tick结果
+				std::vector<u8> mab_Pass;
+				std::vector<s8> mab_Result;
+				//agent下标列表，分组和过滤都在它上面原地进行
+				std::vector<u32> mao_Indices;
+				//分组/过滤时的临时数组，只在一个节点内部使用，递归到孩子之前就用完了
+				std::vector<u32> mao_Temp;
+				std::vector<u16> mao_Keys;
+				std::vector<u8> mab_Flags;
+				//前提条件缓存没命中的agent的求值结果
+				std::vector<u8> mab_Missed;
+				//分组的起点要一直用到孩子执行完，按节点嵌套的顺序当栈用，大小在编译时算好
+				std::vector<u32> mao_GroupStart;
+				u32 mui_GroupStartTop;
+			};
+
+			//把BevNodeFactory建好的树编译成连续数组（按层序，孩子相邻），内置控制节点用switch解释执行，不走虚函数
+			//和原来的树使用同一个BevAgentState，两种执行方式可以混用；原来的树要比编译结果活得久
+			//也可以由BevTreeImage直接指向映射进来的节点数组，这时没有原来的树，oGetRoot为NULL
+			class BevCompiledTree
+			{
+				friend class BevTreeImage;
+
+			public:
+				BevCompiledTree();
+
+				//根节点需要先调用过BuildStateLayout
+				bool Compile(const BevNode &_o_Root);
+				void Clear();
+
+				bool Evaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+				void Transition(BevAgentState &state, const BevNodeInputParam &input) const;
+				BevRunningStatus Tick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				//批量更新，相当于对每个agent做 if (Evaluate) Tick
+				//停在同一个节点上的agent分成一组，前提条件和行为节点对一整段agent连续执行
+				//同一批里的agent要互相独立：执行期间input只读，output每个agent一份（或者只做和顺序无关的累加）
+				//没通过Evaluate的agent不会Tick，结果记为k_BRS_Finish；_ae_Results可以为NULL
+				void TickBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, BevNodeOutputParam *_o_Outputs, u32 _ui_Count,
+							   BevBatchScratch &_o_Scratch, BevRunningStatus *_ae_Results = NULL) const;
+
+				u32 GetNodeCount() const
+				{
+					return mui_NodeCount;
+				}
+				const BevCompiledNode &GetNode(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mui_NodeCount);
+					return mao_NodeData[_ui_Index];
+				}
+				const BevNode *oGetRoot() const
+				{
+					return mo_Root;
+				}
+
+				//agent状态块的布局，BevAgentState(const BevCompiledTree &)按它分配
+				u32 GetTreeStateSize() const
+				{
+					return mui_TreeStateSize;
+				}
+				u32 GetConditionCacheOffset() const
+				{
+					return mui_ConditionCacheOffset;
+				}
+				u32 GetConditionCacheCount() const
+				{
+					return mui_ConditionCacheCount;
+				}
+				//状态块的初始内容，不为NULL时Reset直接拷贝，不用再从根节点逐个初始化
+				const u8 *GetInitialState() const
+				{
+					return mab_InitialState;
+				}
+
+			private:
+				void _FillNode(u32 _ui_Index, const BevNode *_o_Node);
+
+				bool _Evaluate(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input) const;
+				//不查前提条件，对应BevNode::EvaluateBody
+				bool _EvaluateBody(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input) const;
+				void _Transition(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input) const;
+				BevRunningStatus _Tick(u32 _ui_Index, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				bool _EvaluateSelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				//有孩子正在运行、上次的选择也已经tick过
+				static bool _IsObserving(const BevSelectorState &s, const BevCompiledNode &_o_Node)
+				{
+					return s.mui_LastSelectIndex < _o_Node.mui_ChildCount && s.mui_CurrentSelectIndex == s.mui_LastSelectIndex;
+				}
+				//有孩子正在运行时只检查带中断标记的孩子，返回false时要按优先级重新选
+				bool _EvaluateSelectorObserved(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				//选择节点里已知不通过的孩子，从_ui_Stamp那次评估之后依赖的key都没变过
+				bool _IsUnchanged(u32 _ui_Index, const BevAgentState &state, u32 _ui_Stamp) const
+				{
+					const BevCompiledNode &node = mao_NodeData[_ui_Index];
+					return node.mb_Watchable && !state.IsDirtySince(node.mui_WatchMask, _ui_Stamp);
+				}
+				bool _EvaluateNonePrioritySelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				void _TransitionSelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				BevRunningStatus _TickSelector(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				bool _EvaluateSequence(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				void _TransitionSequence(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				BevRunningStatus _TickSequence(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				bool _EvaluateParallel(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				void _TransitionParallel(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				BevRunningStatus _TickParallel(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				bool _EvaluateLoop(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				void _TransitionLoop(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const;
+				BevRunningStatus _TickLoop(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				//批量执行时一起往下传的数据
+				struct BatchContext
+				{
+					BevAgentState *const *mo_Agents;
+					const BevNodeInputParam *mo_Inputs;
+					BevNodeOutputParam *mo_Outputs;
+					BevBatchScratch *mo_Scratch;
+				};
+				void _TickBatchRange(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, BevNodeOutputParam *_o_Outputs, u32 _ui_Count,
+									 BevBatchScratch &_o_Scratch, BevRunningStatus *_ae_Results) const;
+				//对_ui_Ids里的agent执行，结果按agent下标写到mab_Pass/mab_Result里；_ui_Ids的顺序会被打乱，但集合不变
+				void _EvaluateBatch(u32 _ui_Index, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _TickBatch(u32 _ui_Index, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+
+				void _EvaluateSelectorBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _EvaluateNonePrioritySelectorBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _EvaluateSequenceBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _EvaluateParallelBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _EvaluateLoopBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+
+				void _TickSelectorBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _TickSequenceBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _TickParallelBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+				void _TickLoopBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count) const;
+
+				//按mab_Flags把_ui_Ids里标记为1的稳定地挪到前面，返回它们的个数
+				static u32 _PartitionBatch(BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count);
+				//求节点的前提条件，组合条件走编译好的程序
+				bool _CheckPrecondition(const BevCompiledNode &_o_Node, BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					const BevPreconditionProgram &program = mao_Programs[_o_Node.mui_PreconditionIndex];
+					if (program.IsEmpty())
+						return mao_Preconditions[_o_Node.mui_PreconditionIndex]->Check(state, input);
+					return program.Run(state, input);
+				}
+				//批量求前提条件，结果写到mab_Flags；缓存里有的直接用，没有的凑成一批再算
+				void _CheckPreconditionBatch(const BevCompiledNode &_o_Node, BatchContext &ctx, const u32 *_ui_Ids, u32 _ui_Count) const;
+				//按mao_Keys把_ui_Ids分组（计数排序），第k组是[_ui_GroupStart[k], _ui_GroupStart[k + 1])
+				static void _GroupBatch(BatchContext &ctx, u32 *_ui_Ids, u32 _ui_Count, u32 _ui_KeyCount, u32 *_ui_GroupStart);
+				static u32 *_PushGroupStart(BatchContext &ctx, u32 _ui_Size)
+				{
+					BevBatchScratch &scratch = *ctx.mo_Scratch;
+					D_CHECK(scratch.mui_GroupStartTop + _ui_Size <= scratch.mao_GroupStart.size());
+					u32 *groupStart = &scratch.mao_GroupStart[scratch.mui_GroupStartTop];
+					scratch.mui_GroupStartTop += _ui_Size;
+					return groupStart;
+				}
+				static void _PopGroupStart(BatchContext &ctx, u32 _ui_Size)
+				{
+					ctx.mo_Scratch->mui_GroupStartTop -= _ui_Size;
+				}
+
+				u32 _GetChild(const BevCompiledNode &_o_Node, u32 _ui_ChildIndex) const
+				{
+					return _o_Node.mui_FirstChild + _ui_ChildIndex;
+				}
+				const BevNode *_oGetObject(const BevCompiledNode &_o_Node) const
+				{
+					return mao_Objects[_o_Node.mui_ObjectIndex];
+				}
+				template <typename T>
+				static T &_GetState(const BevCompiledNode &_o_Node, BevAgentState &state)
+				{
+					return *reinterpret_cast<T *>(state.GetData() + _o_Node.mui_StateOffset);
+				}
+
+			private:
+				const BevNode *mo_Root;
+				//执行时都通过mao_NodeData访问，编译出来的指向mao_Nodes，BevTreeImage的指向映射的内存
+				std::vector<BevCompiledNode> mao_Nodes;
+				const BevCompiledNode *mao_NodeData;
+				u32 mui_NodeCount;
+				std::vector<const BevNode *> mao_Objects;
+				std::vector<const BevNodePrecondition *> mao_Preconditions;
+				//和mao_Preconditions一一对应，只有组合条件才编译，其它的是空程序
+				std::vector<BevPreconditionProgram> mao_Programs;
+				//批量执行时分组起点最多占用的大小，按每个节点孩子数+2的总和算
+				u32 mui_GroupStartSize;
+				u32 mui_TreeStateSize;
+				u32 mui_ConditionCacheOffset;
+				u32 mui_ConditionCacheCount;
+				const u8 *mab_InitialState;
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include "TAI_BevPreconditionProgram.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			BevPreconditionProgram::BevPreconditionProgram()
+				: mo_Root(NULL), mao_ExternalCode(NULL), mui_CodeSize(0), mui_CacheSlot(k_BLimited_InvalidCacheSlot)
+			{
+			}
+
+			void BevPreconditionProgram::Clear()
+			{
+				mo_Root = NULL;
+				mao_Code.clear();
+				mao_ExternalCode = NULL;
+				mui_CodeSize = 0;
+				mui_CacheSlot = k_BLimited_InvalidCacheSlot;
+				mao_Leaves.clear();
+			}
+
+			void BevPreconditionProgram::Attach(const BevPreconditionInstr *_o_Code, u32 _ui_CodeSize, const BevNodePrecondition *const *_o_Leaves, u32 _ui_LeafCount, u32 _ui_CacheSlot)
+			{
+				Clear();
+				mao_ExternalCode = _o_Code;
+				mui_CodeSize = _ui_CodeSize;
+				mui_CacheSlot = _ui_CacheSlot;
+				for (u32 i = 0; i < _ui_LeafCount; ++i)
+				{
+					Leaf leaf;
+					leaf.mo_Precondition = _o_Leaves[i];
+					leaf.mf_Func = NULL;
+					if (_o_Leaves[i]->GetPreconditionType() == k_BPT_FUNC)
+						leaf.mf_Func = static_cast<const BevNodePreconditionFUNC *>(_o_Leaves[i])->GetFunc();
+					mao_Leaves.push_back(leaf);
+				}
+			}
+
+			bool BevPreconditionProgram::Compile(const BevNodePrecondition &_o_Root)
+			{
+				Clear();
+				u32 stackSize = 0;
+				if (!_Emit(&_o_Root, 0, stackSize))
+				{
+					Clear();
+					return false;
+				}
+				mo_Root = &_o_Root;
+				mui_CodeSize = (u32)mao_Code.size();
+				return true;
+			}
+
+			bool BevPreconditionProgram::_Emit(const BevNodePrecondition *_o_Precondition, u32 _ui_Depth, u32 &_ui_StackSize)
+			{
+				//_ui_Depth是执行到这里之前栈里已有的值的个数
+				if (_ui_Depth + 1 > _ui_StackSize)
+					_ui_StackSize = _ui_Depth + 1;
+				if (_ui_StackSize > k_BLimited_PreconditionStackDepth || mao_Code.size() >= 0xffff)
+					return false;
+
+				BevPreconditionInstr instr;
+				instr.mui_Arg = 0;
+				switch (_o_Precondition->GetPreconditionType())
+				{
+				case k_BPT_TRUE:
+					instr.me_Op = k_BPO_True;
+					break;
+				case k_BPT_FALSE:
+					instr.me_Op = k_BPO_False;
+					break;
+				case k_BPT_NOT:
+					if (!_Emit(_o_Precondition->oGetOperand(0), _ui_Depth, _ui_StackSize))
+						return false;
+					instr.me_Op = k_BPO_Not;
+					break;
+				case k_BPT_XOR:
+					if (!_Emit(_o_Precondition->oGetOperand(0), _ui_Depth, _ui_StackSize) ||
+						!_Emit(_o_Precondition->oGetOperand(1), _ui_Depth + 1, _ui_StackSize))
+						return false;
+					instr.me_Op = k_BPO_Xor;
+					break;
+				case k_BPT_AND:
+				case k_BPT_OR:
+				{
+					bool bAnd = _o_Precondition->GetPreconditionType() == k_BPT_AND;
+					if (!_Emit(_o_Precondition->oGetOperand(0), _ui_Depth, _ui_StackSize))
+						return false;
+					u32 begin = (u32)mao_Code.size();
+					instr.me_Op = (u8)(bAnd ? k_BPO_AndBegin : k_BPO_OrBegin);
+					mao_Code.push_back(instr);
+					if (!_Emit(_o_Precondition->oGetOperand(1), _ui_Depth + 1, _ui_StackSize))
+						return false;
+					instr.me_Op = (u8)(bAnd ? k_BPO_AndEnd : k_BPO_OrEnd);
+					mao_Code.push_back(instr);
+					//短路时跳到End的下一条
+					mao_Code[begin].mui_Arg = (u16)mao_Code.size();
+					return mao_Code.size() < 0xffff;
+				}
+				case k_BPT_REF:
+					//引用直接展开成被引用的条件
+					return _Emit(_o_Precondition->oGetOperand(0), _ui_Depth, _ui_StackSize);
+				default:
+					instr.me_Op = k_BPO_Leaf;
+					instr.mui_Arg = (u16)_AddLeaf(_o_Precondition);
+					if (instr.mui_Arg == 0xffff)
+						return false;
+					break;
+				}
+				mao_Code.push_back(instr);
+				return true;
+			}
+
+			u32 BevPreconditionProgram::_AddLeaf(const BevNodePrecondition *_o_Precondition)
+			{
+				//同一个叶子出现多次只占一个下标，缓存本来就是按条件算的
+				for (u32 i = 0; i < mao_Leaves.size(); ++i)
+				{
+					if (mao_Leaves[i].mo_Precondition == _o_Precondition)
+						return i;
+				}
+				if (mao_Leaves.size() >= 0xffff)
+					return 0xffff;
+				Leaf leaf;
+				leaf.mo_Precondition = _o_Precondition;
+				leaf.mf_Func = NULL;
+				if (_o_Precondition->GetPreconditionType() == k_BPT_FUNC)
+					leaf.mf_Func = static_cast<const BevNodePreconditionFUNC *>(_o_Precondition)->GetFunc();
+				mao_Leaves.push_back(leaf);
+				return (u32)mao_Leaves.size() - 1;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// 单个agent
+			//-------------------------------------------------------------------------------------
+			bool BevPreconditionProgram::Run(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				D_CHECK(!IsEmpty());
+				u32 slot = GetCacheSlot();
+				if (slot == k_BLimited_InvalidCacheSlot)
+					return _Execute(state, input);
+				bool bResult;
+				if (state.GetCachedCondition(slot, bResult))
+					return bResult;
+				bResult = _Execute(state, input);
+				state.SetCachedCondition(slot, bResult);
+				return bResult;
+			}
+
+			D_Inline bool BevPreconditionProgram::_CheckLeaf(const Leaf &_o_Leaf, BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				u32 slot = _o_Leaf.mo_Precondition->mui_CacheSlot;
+				bool bResult;
+				if (slot != k_BLimited_InvalidCacheSlot && state.GetCachedCondition(slot, bResult))
+					return bResult;
+				bResult = _o_Leaf.mf_Func ? _o_Leaf.mf_Func(input) : _o_Leaf.mo_Precondition->_DoCheck(state, input);
+				if (slot != k_BLimited_InvalidCacheSlot)
+					state.SetCachedCondition(slot, bResult);
+				return bResult;
+			}
+
+			bool BevPreconditionProgram::_Execute(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				bool abStack[k_BLimited_PreconditionStackDepth];
+				u32 sp = 0;
+				const BevPreconditionInstr *code = GetCode();
+				u32 count = mui_CodeSize;
+				for (u32 pc = 0; pc < count; ++pc)
+				{
+					const BevPreconditionInstr &instr = code[pc];
+					switch (instr.me_Op)
+					{
+					case k_BPO_Leaf:
+						abStack[sp++] = _CheckLeaf(mao_Leaves[instr.mui_Arg], state, input);
+						break;
+					case k_BPO_True:
+						abStack[sp++] = true;
+						break;
+					case k_BPO_False:
+						abStack[sp++] = false;
+						break;
+					case k_BPO_Not:
+						abStack[sp - 1] = !abStack[sp - 1];
+						break;
+					case k_BPO_Xor:
+						--sp;
+						abStack[sp - 1] = abStack[sp - 1] != abStack[sp];
+						break;
+					case k_BPO_AndBegin:
+						//左边为假，结果就是它，跳过右边
+						if (!abStack[sp - 1])
+							pc = instr.mui_Arg - 1;
+						break;
+					case k_BPO_OrBegin:
+						if (abStack[sp - 1])
+							pc = instr.mui_Arg - 1;
+						break;
+					case k_BPO_AndEnd:
+					case k_BPO_OrEnd:
+						//没有短路，结果就是右边
+						--sp;
+						abStack[sp - 1] = abStack[sp];
+						break;
+					}
+				}
+				D_CHECK(sp == 1);
+				return abStack[0];
+			}
+
+			//-------------------------------------------------------------------------------------
+			// 按掩码，每一位是一个agent
+			//-------------------------------------------------------------------------------------
+			void BevPreconditionProgram::RunBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+			{
+				D_CHECK(!IsEmpty());
+				u32 slot = GetCacheSlot();
+				//缓存没命中的凑满一组再执行
+				u32 lanes[k_BLimited_PreconditionLanes];
+				u32 positions[k_BLimited_PreconditionLanes];
+				u32 laneCount = 0;
+				for (u32 i = 0; i < _ui_Count; ++i)
+				{
+					u32 id = _ui_Indices[i];
+					bool bResult;
+					if (slot != k_BLimited_InvalidCacheSlot && _o_Agents[id]->GetCachedCondition(slot, bResult))
+					{
+						_ab_Results[i] = bResult ? 1 : 0;
+						continue;
+					}
+					lanes[laneCount] = id;
+					positions[laneCount] = i;
+					if (++laneCount == k_BLimited_PreconditionLanes)
+					{
+						_RunLanes(_o_Agents, _o_Inputs, lanes, positions, laneCount, _ab_Results);
+						laneCount = 0;
+					}
+				}
+				//最后一个agent可能命中了缓存，剩下没凑满的一组在这里执行
+				if (laneCount > 0)
+					_RunLanes(_o_Agents, _o_Inputs, lanes, positions, laneCount, _ab_Results);
+			}
+
+			void BevPreconditionProgram::_RunLanes(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Lanes, const u32 *_ui_Positions, u32 _ui_LaneCount, u8 *_ab_Results) const
+			{
+				u32 slot = GetCacheSlot();
+				u32 mask = _ExecuteLanes(_o_Agents, _o_Inputs, _ui_Lanes, _ui_LaneCount);
+				for (u32 lane = 0; lane < _ui_LaneCount; ++lane)
+				{
+					bool bResult = (mask >> lane) & 1;
+					_ab_Results[_ui_Positions[lane]] = bResult ? 1 : 0;
+					if (slot != k_BLimited_InvalidCacheSlot)
+						_o_Agents[_ui_Lanes[lane]]->SetCachedCondition(slot, bResult);
+				}
+			}
+
+			u32 BevPreconditionProgram::_CheckLeafLanes(const Leaf &_o_Leaf, BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_LaneMask) const
+			{
+				u32 slot = _o_Leaf.mo_Precondition->mui_CacheSlot;
+				u32 missed[k_BLimited_PreconditionLanes];
+				u32 missedLane[k_BLimited_PreconditionLanes];
+				u32 missCount = 0;
+				u32 result = 0;
+				for (u32 lane = 0; _ui_LaneMask != 0; ++lane, _ui_LaneMask >>= 1)
+				{
+					if (!(_ui_LaneMask & 1))
+						continue;
+					u32 id = _ui_Indices[lane];
+					bool bResult;
+					if (slot != k_BLimited_InvalidCacheSlot && _o_Agents[id]->GetCachedCondition(slot, bResult))
+					{
+						if (bResult)
+							result |= 1u << lane;
+						continue;
+					}
+					missed[missCount] = id;
+					missedLane[missCount] = lane;
+					++missCount;
+				}
+				if (missCount == 0)
+					return result;
+
+				u8 abResults[k_BLimited_PreconditionLanes];
+				if (_o_Leaf.mf_Func)
+				{
+					for (u32 i = 0; i < missCount; ++i)
+						abResults[i] = _o_Leaf.mf_Func(_o_Inputs[missed[i]]) ? 1 : 0;
+				}
+				else
+					_o_Leaf.mo_Precondition->_DoCheckBatch(_o_Agents, _o_Inputs, missed, missCount, abResults);
+				for (u32 i = 0; i < missCount; ++i)
+				{
+					if (slot != k_BLimited_InvalidCacheSlot)
+						_o_Agents[missed[i]]->SetCachedCondition(slot, abResults[i] != 0);
+					if (abResults[i])
+						result |= 1u << missedLane[i];
+				}
+				return result;
+			}
+
+			u32 BevPreconditionProgram::_ExecuteLanes(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count) const
+			{
+				//auiValue是每条通道的值，auiLive记录进入AND/OR右边之前还需要算的通道
+				u32 auiValue[k_BLimited_PreconditionStackDepth];
+				u32 auiLive[k_BLimited_PreconditionStackDepth];
+				u32 sp = 0, lp = 0;
+				u32 live = _ui_Count >= 32 ? 0xffffffff : (1u << _ui_Count) - 1;
+				const BevPreconditionInstr *code = GetCode();
+				u32 count = mui_CodeSize;
+				for (u32 pc = 0; pc < count; ++pc)
+				{
+					const BevPreconditionInstr &instr = code[pc];
+					switch (instr.me_Op)
+					{
+					case k_BPO_Leaf:
+						auiValue[sp++] = live ? _CheckLeafLanes(mao_Leaves[instr.mui_Arg], _o_Agents, _o_Inputs, _ui_Indices, live) : 0;
+						break;
+					case k_BPO_True:
+						auiValue[sp++] = 0xffffffff;
+						break;
+					case k_BPO_False:
+						auiValue[sp++] = 0;
+						break;
+					case k_BPO_Not:
+						auiValue[sp - 1] = ~auiValue[sp - 1];
+						break;
+					case k_BPO_Xor:
+						--sp;
+						auiValue[sp - 1] ^= auiValue[sp];
+						break;
+					case k_BPO_AndBegin:
+						//左边为真的通道才需要算右边，一条都没有就整段跳过
+						if ((live & auiValue[sp - 1]) == 0)
+							pc = instr.mui_Arg - 1;
+						else
+						{
+							auiLive[lp++] = live;
+							live &= auiValue[sp - 1];
+						}
+						break;
+					case k_BPO_OrBegin:
+						if ((live & ~auiValue[sp - 1]) == 0)
+							pc = instr.mui_Arg - 1;
+						else
+						{
+							auiLive[lp++] = live;
+							live &= ~auiValue[sp - 1];
+						}
+						break;
+					case k_BPO_AndEnd:
+						//关掉的通道左边是假，与完还是假，右边的值是什么都无所谓
+						--sp;
+						auiValue[sp - 1] &= auiValue[sp];
+						live = auiLive[--lp];
+						break;
+					case k_BPO_OrEnd:
+						--sp;
+						auiValue[sp - 1] |= auiValue[sp];
+						live = auiLive[--lp];
+						break;
+					}
+				}
+				D_CHECK(sp == 1 && lp == 0);
+				return auiValue[0];
+			}
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef __TAI_BEVPRECONDITIONPROGRAM_H__
+#define __TAI_BEVPRECONDITIONPROGRAM_H__
+
+#include <vector>
+#include "TAI_BevTree.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+
+#define k_BLimited_PreconditionStackDepth 32
+#define k_BLimited_PreconditionLanes 32
+
+			//指令：叶子条件压栈，NOT/XOR直接算栈顶，AND/OR拆成Begin/End两条
+			//单个agent执行时Begin按左操作数短路跳到End之后；按掩码执行时Begin把左操作数已经决定了的通道关掉
+			//这样两种执行方式调用叶子条件的情况和原来的 && || 完全一样
+			enum E_BevPreconditionOp
+			{
+				k_BPO_Leaf = 0,
+				k_BPO_True,
+				k_BPO_False,
+				k_BPO_Not,
+				k_BPO_Xor,
+				k_BPO_AndBegin,
+				k_BPO_AndEnd,
+				k_BPO_OrBegin,
+				k_BPO_OrEnd,
+			};
+
+			struct BevPreconditionInstr
+			{
+				u8 me_Op;
+				//k_BPO_Leaf是叶子下标，Begin是对应End的下一条指令
+				u16 mui_Arg;
+			};
+
+			//把一棵NOT/AND/OR/XOR组合起来的前提条件展开成后缀指令，叶子条件放在一张表里按下标调用
+			//执行结果和缓存的用法都和BevNodePrecondition::Check一致；原来的条件要比程序活得久
+			class BevPreconditionProgram
+			{
+			public:
+				BevPreconditionProgram();
+
+				//嵌套太深或者叶子太多时返回false，这时继续用原来的条件
+				bool Compile(const BevNodePrecondition &_o_Root);
+				//直接执行外部的指令（BevTreeImage映射进来的），指令要比程序活得久；_ui_CacheSlot是整个条件的缓存槽位
+				void Attach(const BevPreconditionInstr *_o_Code, u32 _ui_CodeSize, const BevNodePrecondition *const *_o_Leaves, u32 _ui_LeafCount, u32 _ui_CacheSlot);
+				void Clear();
+				bool IsEmpty() const
+				{
+					return mui_CodeSize == 0;
+				}
+				u32 GetInstrCount() const
+				{
+					return mui_CodeSize;
+				}
+				const BevPreconditionInstr *GetCode() const
+				{
+					return mao_Code.empty() ? mao_ExternalCode : &mao_Code[0];
+				}
+				u32 GetLeafCount() const
+				{
+					return (u32)mao_Leaves.size();
+				}
+				const BevNodePrecondition *oGetLeaf(u32 _ui_Index) const
+				{
+					return mao_Leaves[_ui_Index].mo_Precondition;
+				}
+				u32 GetCacheSlot() const
+				{
+					return mo_Root ? mo_Root->mui_CacheSlot : mui_CacheSlot;
+				}
+
+				bool Run(BevAgentState &state, const BevNodeInputParam &input) const;
+				//批量执行，_ab_Results[i]对应agent _ui_Indices[i]；每k_BLimited_PreconditionLanes个agent一组，按位并行
+				void RunBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const;
+
+			private:
+				struct Leaf
+				{
+					//k_BPT_FUNC的叶子直接调函数指针，其它的走虚函数
+					BevPreconditionFunc mf_Func;
+					const BevNodePrecondition *mo_Precondition;
+				};
+
+				bool _Emit(const BevNodePrecondition *_o_Precondition, u32 _ui_Depth, u32 &_ui_StackSize);
+				u32 _AddLeaf(const BevNodePrecondition *_o_Precondition);
+				bool _Execute(BevAgentState &state, const BevNodeInputParam &input) const;
+				u32 _ExecuteLanes(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count) const;
+				//执行一组缓存没命中的agent，结果写到_ab_Results[_ui_Positions[lane]]并存进缓存
+				void _RunLanes(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Lanes, const u32 *_ui_Positions, u32 _ui_LaneCount, u8 *_ab_Results) const;
+				bool _CheckLeaf(const Leaf &_o_Leaf, BevAgentState &state, const BevNodeInputParam &input) const;
+				u32 _CheckLeafLanes(const Leaf &_o_Leaf, BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_LaneMask) const;
+
+			private:
+				const BevNodePrecondition *mo_Root;
+				std::vector<BevPreconditionInstr> mao_Code;
+				const BevPreconditionInstr *mao_ExternalCode;
+				u32 mui_CodeSize;
+				//Attach时没有原来的条件，缓存槽位记在这里
+				u32 mui_CacheSlot;
+				std::vector<Leaf> mao_Leaves;
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include "TAI_BevProfiler.h"
+
+#if defined(TAI_BEV_PROFILE)
+
+#include <map>
+#include <algorithm>
+#include "TAI_BevTree.h"
+#include "TCore_LibSettings.h"
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#define D_BevThreadLocal __declspec(thread)
+#else
+#define D_BevThreadLocal __thread
+#endif
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			//一个线程的记录：按节点指针开放寻址的统计表，加上调用栈
+			class BevProfileBuffer
+			{
+			public:
+				BevProfileBuffer()
+					: mui_Depth(0), mui_Count(0)
+				{
+					_Resize(256);
+				}
+
+				BevProfileNodeStats &oGetStats(const BevNode *_o_Node)
+				{
+					u32 mask = (u32)mao_Table.size() - 1;
+					for (u32 i = _Hash(_o_Node) & mask;; i = (i + 1) & mask)
+					{
+						BevProfileNodeStats &stats = mao_Table[i];
+						if (stats.mo_Node == _o_Node)
+							return stats;
+						if (stats.mo_Node == NULL)
+						{
+							//超过一半就扩容，保证探测很短
+							if ((mui_Count + 1) * 2 > (u32)mao_Table.size())
+							{
+								_Resize((u32)mao_Table.size() * 2);
+								return oGetStats(_o_Node);
+							}
+							++mui_Count;
+							stats.mo_Node = _o_Node;
+							return stats;
+						}
+					}
+				}
+				void Clear()
+				{
+					mao_Table.clear();
+					_Resize(256);
+				}
+				const std::vector<BevProfileNodeStats> &GetTable() const
+				{
+					return mao_Table;
+				}
+
+				struct Frame
+				{
+					const BevNode *mo_Node;
+					s64 mi_StartTick;
+					s64 mi_ChildTicks;
+				};
+				Frame maf_Stack[k_BLimited_ProfileStackDepth];
+				//超过k_BLimited_ProfileStackDepth的部分也计数，只是不记录
+				u32 mui_Depth;
+
+			private:
+				static u32 _Hash(const BevNode *_o_Node)
+				{
+					return (u32)((size_t)_o_Node >> 4) * 2654435761u;
+				}
+				void _Resize(u32 _ui_Capacity)
+				{
+					std::vector<BevProfileNodeStats> old;
+					old.swap(mao_Table);
+					BevProfileNodeStats empty;
+					memset(&empty, 0, sizeof(empty));
+					mao_Table.assign(_ui_Capacity, empty);
+					mui_Count = 0;
+					for (u32 i = 0; i < old.size(); ++i)
+					{
+						if (old[i].mo_Node)
+							oGetStats(old[i].mo_Node) = old[i];
+					}
+				}
+
+			private:
+				std::vector<BevProfileNodeStats> mao_Table;
+				u32 mui_Count;
+			};
+
+			namespace
+			{
+				//线程缓存的缓冲区，和它属于哪个profiler
+				D_BevThreadLocal BevProfileBuffer *s_pBuffer = NULL;
+				D_BevThreadLocal u32 s_uiBufferGeneration = 0;
+
+				bool _ExclusiveGreater(const BevProfileNodeStats &_o_Left, const BevProfileNodeStats &_o_Right)
+				{
+					return _o_Left.mi_ExclusiveTicks > _o_Right.mi_ExclusiveTicks;
+				}
+			}
+
+			BevProfiler *volatile BevProfiler::ms_Active = NULL;
+			u32 BevProfiler::ms_NextGeneration = 0;
+
+			BevProfiler::BevProfiler(Tick *_o_Tick)
+				: mo_Tick(_o_Tick), mb_OwnTick(false), mui_Generation(++ms_NextGeneration)
+			{
+				if (!mo_Tick)
+				{
+					mo_Tick = CallCreator<Tick>(E_CreatorType_Tick);
+					mb_OwnTick = true;
+				}
+				D_CHECK(mo_Tick);
+			}
+
+			BevProfiler::~BevProfiler()
+			{
+				Stop();
+				for (u32 i = 0; i < mao_Buffers.size(); ++i)
+					delete mao_Buffers[i];
+				if (mb_OwnTick)
+					D_SafeDelete(mo_Tick);
+			}
+
+			void BevProfiler::Start()
+			{
+				ms_Active = this;
+			}
+
+			void BevProfiler::Stop()
+			{
+				if (ms_Active == this)
+					ms_Active = NULL;
+			}
+
+			void BevProfiler::Reset()
+			{
+				for (u32 i = 0; i < mao_Buffers.size(); ++i)
+				{
+					mao_Buffers[i]->Clear();
+					mao_Buffers[i]->mui_Depth = 0;
+				}
+			}
+
+			BevProfileBuffer &BevProfiler::_GetBuffer()
+			{
+				if (s_uiBufferGeneration != mui_Generation)
+				{
+					BevProfileBuffer *pBuffer = new BevProfileBuffer;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+					mo_Lock.Lock();
+					mao_Buffers.push_back(pBuffer);
+					mo_Lock.UnLock();
+#else
+					mao_Buffers.push_back(pBuffer);
+#endif
+					s_pBuffer = pBuffer;
+					s_uiBufferGeneration = mui_Generation;
+				}
+				return *s_pBuffer;
+			}
+
+			void BevProfiler::_Begin(const BevNode *_o_Node, E_BevProfileEvent _e_Event)
+			{
+				BevProfileBuffer &buffer = _GetBuffer();
+				++buffer.oGetStats(_o_Node).maui_CallCount[_e_Event];
+				if (buffer.mui_Depth < k_BLimited_ProfileStackDepth)
+				{
+					BevProfileBuffer::Frame &frame = buffer.maf_Stack[buffer.mui_Depth];
+					frame.mo_Node = _o_Node;
+					frame.mi_ChildTicks = 0;
+					frame.mi_StartTick = mo_Tick->GetTick();
+				}
+				++buffer.mui_Depth;
+			}
+
+			void BevProfiler::_End()
+			{
+				s64 endTick = mo_Tick->GetTick();
+				BevProfileBuffer &buffer = _GetBuffer();
+				//中途Start的，开始时没有记录
+				if (buffer.mui_Depth == 0)
+					return;
+				if (--buffer.mui_Depth >= k_BLimited_ProfileStackDepth)
+					return;
+				const BevProfileBuffer::Frame &frame = buffer.maf_Stack[buffer.mui_Depth];
+				s64 elapsed = endTick - frame.mi_StartTick;
+				BevProfileNodeStats &stats = buffer.oGetStats(frame.mo_Node);
+				stats.mi_InclusiveTicks += elapsed;
+				stats.mi_ExclusiveTicks += elapsed - frame.mi_ChildTicks;
+				if (buffer.mui_Depth > 0)
+					buffer.maf_Stack[buffer.mui_Depth - 1].mi_ChildTicks += elapsed;
+			}
+
+			void BevProfiler::_Condition(const BevNodePrecondition *_o_Precondition, bool _b_Result, bool _b_Cached)
+			{
+				BevProfileBuffer &buffer = _GetBuffer();
+				if (buffer.mui_Depth == 0 || buffer.mui_Depth > k_BLimited_ProfileStackDepth)
+					return;
+				//只算节点自己的前提条件，组合条件里的子条件不算
+				const BevNode *pNode = buffer.maf_Stack[buffer.mui_Depth - 1].mo_Node;
+				if (pNode->oGetNodePrecondition() != _o_Precondition)
+					return;
+				BevProfileNodeStats &stats = buffer.oGetStats(pNode);
+				++stats.mui_ConditionCount;
+				if (_b_Result)
+					++stats.mui_ConditionPassCount;
+				if (_b_Cached)
+					++stats.mui_ConditionCacheHitCount;
+			}
+
+			void BevProfiler::GetReport(std::vector<BevProfileEntry> &_o_Entries, u32 _ui_MaxCount) const
+			{
+				std::map<const BevNode *, BevProfileNodeStats> merged;
+				for (u32 i = 0; i < mao_Buffers.size(); ++i)
+				{
+					const std::vector<BevProfileNodeStats> &table = mao_Buffers[i]->GetTable();
+					for (u32 j = 0; j < table.size(); ++j)
+					{
+						const BevProfileNodeStats &src = table[j];
+						if (!src.mo_Node)
+							continue;
+						std::map<const BevNode *, BevProfileNodeStats>::iterator it = merged.find(src.mo_Node);
+						if (it == merged.end())
+						{
+							merged[src.mo_Node] = src;
+							continue;
+						}
+						BevProfileNodeStats &dst = it->second;
+						for (u32 k = 0; k < k_BPE_Count; ++k)
+							dst.maui_CallCount[k] += src.maui_CallCount[k];
+						dst.mi_InclusiveTicks += src.mi_InclusiveTicks;
+						dst.mi_ExclusiveTicks += src.mi_ExclusiveTicks;
+						dst.mui_ConditionCount += src.mui_ConditionCount;
+						dst.mui_ConditionPassCount += src.mui_ConditionPassCount;
+						dst.mui_ConditionCacheHitCount += src.mui_ConditionCacheHitCount;
+					}
+				}
+
+				std::vector<BevProfileNodeStats> sorted;
+				sorted.reserve(merged.size());
+				for (std::map<const BevNode *, BevProfileNodeStats>::const_iterator it = merged.begin(); it != merged.end(); ++it)
+					sorted.push_back(it->second);
+				std::stable_sort(sorted.begin(), sorted.end(), _ExclusiveGreater);
+				if (_ui_MaxCount > 0 && sorted.size() > _ui_MaxCount)
+					sorted.resize(_ui_MaxCount);
+
+				f64 microsecondsPerTick = 1000000.0 / (f64)mo_Tick->GetTickPerSec();
+				_o_Entries.resize(sorted.size());
+				for (u32 i = 0; i < sorted.size(); ++i)
+				{
+					const BevProfileNodeStats &stats = sorted[i];
+					BevProfileEntry &entry = _o_Entries[i];
+					entry.mo_Node = stats.mo_Node;
+					entry.mz_DebugName = stats.mo_Node->GetDebugName();
+					for (u32 k = 0; k < k_BPE_Count; ++k)
+						entry.maui_CallCount[k] = stats.maui_CallCount[k];
+					entry.mf_InclusiveMicroseconds = stats.mi_InclusiveTicks * microsecondsPerTick;
+					entry.mf_ExclusiveMicroseconds = stats.mi_ExclusiveTicks * microsecondsPerTick;
+					entry.mf_ConditionPassRate = stats.mui_ConditionCount ? (f32)stats.mui_ConditionPassCount / stats.mui_ConditionCount : 0;
+					entry.mf_ConditionCacheHitRate = stats.mui_ConditionCount ? (f32)stats.mui_ConditionCacheHitCount / stats.mui_ConditionCount : 0;
+				}
+			}
+
+			void BevProfiler::PrintReport(u32 _ui_MaxCount) const
+			{
+				std::vector<BevProfileEntry> entries;
+				GetReport(entries, _ui_MaxCount);
+				D_Output("%-24s %10s %10s %10s %12s %12s %6s %6s\n", "node", "evaluate", "transition", "tick", "incl(us)", "excl(us)", "pass", "cache");
+				for (u32 i = 0; i < entries.size(); ++i)
+				{
+					const BevProfileEntry &entry = entries[i];
+					D_Output("%-24s %10u %10u %10u %12.1f %12.1f %5.1f%% %5.1f%%\n", entry.mz_DebugName,
+							 entry.maui_CallCount[k_BPE_Evaluate], entry.maui_CallCount[k_BPE_Transition], entry.maui_CallCount[k_BPE_Tick],
+							 entry.mf_InclusiveMicroseconds, entry.mf_ExclusiveMicroseconds,
+							 entry.mf_ConditionPassRate * 100, entry.mf_ConditionCacheHitRate * 100);
+				}
+			}
+		}
+	}
+}
+
+#endif
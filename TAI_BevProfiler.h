@@ -0,0 +1,150 @@
+#ifndef __TAI_BEVPROFILER_H__
+#define __TAI_BEVPROFILER_H__
+
+//定义了TAI_BEV_PROFILE才会编译进分析代码，没定义时下面的宏都是空的，BevNode里没有任何额外的指令
+#if defined(TAI_BEV_PROFILE)
+#include <vector>
+#include "TCore_Tick.h"
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#include "TCore_Mutex.h"
+#endif
+#endif
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+#if defined(TAI_BEV_PROFILE)
+
+//每个线程记录的嵌套深度，再深的调用不计
+#define k_BLimited_ProfileStackDepth 128
+
+			class BevNode;
+			class BevNodePrecondition;
+			class BevProfileBuffer;
+
+			enum E_BevProfileEvent
+			{
+				k_BPE_Evaluate = 0,
+				k_BPE_Transition,
+				k_BPE_Tick,
+				k_BPE_Count,
+			};
+
+			//一个节点在所有agent、所有线程上累计的数据
+			struct BevProfileNodeStats
+			{
+				const BevNode *mo_Node;
+				u32 maui_CallCount[k_BPE_Count];
+				//包含孩子的耗时，和去掉孩子之后自己的耗时，单位是Tick
+				s64 mi_InclusiveTicks;
+				s64 mi_ExclusiveTicks;
+				//节点自己的前提条件：求值次数、通过次数、命中缓存次数
+				u32 mui_ConditionCount;
+				u32 mui_ConditionPassCount;
+				u32 mui_ConditionCacheHitCount;
+			};
+
+			//报告里的一行
+			struct BevProfileEntry
+			{
+				const BevNode *mo_Node;
+				const char *mz_DebugName;
+				u32 maui_CallCount[k_BPE_Count];
+				f64 mf_InclusiveMicroseconds;
+				f64 mf_ExclusiveMicroseconds;
+				//没有前提条件的节点都是0
+				f32 mf_ConditionPassRate;
+				f32 mf_ConditionCacheHitRate;
+			};
+
+			//记录BevNode::Evaluate/Transition/Tick的次数和耗时，以及节点前提条件的通过率和缓存命中率
+			//每个线程第一次记录时分到自己的一块缓冲区，之后只写自己的，不加锁；报告时按节点合并所有线程
+			//编译后的树（BevCompiledTree）不经过这几个函数，不会被记录
+			//同一时间只有一个profiler在记录；Start/Stop/Reset/GetReport要在没有线程在跑树的时候调用
+			class BevProfiler
+			{
+			public:
+				//_o_Tick为NULL时通过E_CreatorType_Tick创建一个，由profiler负责释放
+				BevProfiler(Tick *_o_Tick = NULL);
+				~BevProfiler();
+
+				void Start();
+				void Stop();
+				bool IsRunning() const
+				{
+					return ms_Active == this;
+				}
+				//清掉所有线程记录的数据
+				void Reset();
+
+				//按节点自己的耗时从高到低排，_ui_MaxCount为0时全部返回
+				void GetReport(std::vector<BevProfileEntry> &_o_Entries, u32 _ui_MaxCount = 0) const;
+				void PrintReport(u32 _ui_MaxCount = 20) const;
+
+				static BevProfiler *oGetActive()
+				{
+					return ms_Active;
+				}
+				//下面几个给宏用
+				void _Begin(const BevNode *_o_Node, E_BevProfileEvent _e_Event);
+				void _End();
+				void _Condition(const BevNodePrecondition *_o_Precondition, bool _b_Result, bool _b_Cached);
+
+			private:
+				BevProfiler(const BevProfiler &);
+				BevProfiler &operator=(const BevProfiler &);
+
+				BevProfileBuffer &_GetBuffer();
+
+			private:
+				Tick *mo_Tick;
+				bool mb_OwnTick;
+				//每个profiler对象不同，线程里缓存的缓冲区对不上就重新分配
+				u32 mui_Generation;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				//只在线程第一次分配缓冲区时加锁
+				Mutex mo_Lock;
+#endif
+				std::vector<BevProfileBuffer *> mao_Buffers;
+
+				static BevProfiler *volatile ms_Active;
+				static u32 ms_NextGeneration;
+			};
+
+			//在作用域里记录一次调用
+			class BevProfileScope
+			{
+			public:
+				BevProfileScope(const BevNode *_o_Node, E_BevProfileEvent _e_Event)
+					: mo_Profiler(BevProfiler::oGetActive())
+				{
+					if (mo_Profiler)
+						mo_Profiler->_Begin(_o_Node, _e_Event);
+				}
+				~BevProfileScope()
+				{
+					if (mo_Profiler)
+						mo_Profiler->_End();
+				}
+
+			private:
+				BevProfiler *mo_Profiler;
+			};
+
+#define D_BevProfileScope(_Node, _Event)						TsiU::AI::BehaviorTree::BevProfileScope _oProfileScope(_Node, _Event)
+#define D_BevProfileCondition(_Precondition, _Result, _Cached)	do { if (TsiU::AI::BehaviorTree::BevProfiler *_pProfiler = TsiU::AI::BehaviorTree::BevProfiler::oGetActive()) _pProfiler->_Condition(_Precondition, _Result, _Cached); } while (0)
+
+#else
+
+#define D_BevProfileScope(_Node, _Event)
+#define D_BevProfileCondition(_Precondition, _Result, _Cached)
+
+#endif
+		}
+	}
+}
+
+#endif
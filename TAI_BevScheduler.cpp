@@ -0,0 +1,441 @@
+#include "TAI_BevScheduler.h"
+#include <algorithm>
+#include "TCore_LibSettings.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			namespace
+			{
+				//几个调度器共用：if (Evaluate) Tick，没通过Evaluate的记为k_BRS_Finish
+				BevRunningStatus _TickAgent(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output, const BevCompiledTree *_o_Tree)
+				{
+					//上次评估没通过，订阅的key也没变过，再评估一次还是不通过
+					if (!state.NeedsEvaluate())
+						return k_BRS_Finish;
+					if (_o_Tree)
+					{
+						if (_o_Tree->Evaluate(state, input))
+							return _o_Tree->Tick(state, input, output);
+						return k_BRS_Finish;
+					}
+					const BevNode &root = state.oGetRoot();
+					if (root.Evaluate(state, input))
+						return root.Tick(state, input, output);
+					return k_BRS_Finish;
+				}
+			}
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+			//工作线程：每帧被唤醒一次，把能拿到的段都做完再睡
+			class BevTickScheduler::Worker : public IThreadRunner
+			{
+			public:
+				Worker(BevTickScheduler *_o_Owner, u32 _ui_Index)
+					: mo_Owner(_o_Owner), mui_Index(_ui_Index), mb_Quit(false)
+				{
+				}
+				virtual u32 Run()
+				{
+					for (;;)
+					{
+						mo_WakeEvent.Wait();
+						if (mb_Quit)
+							break;
+						mo_Owner->_RunWorker(mui_Index);
+					}
+					return 0;
+				}
+				virtual void NotifyQuit()
+				{
+					mb_Quit = true;
+					mo_WakeEvent.Set();
+				}
+				void Wake()
+				{
+					mo_WakeEvent.Set();
+				}
+
+			private:
+				BevTickScheduler *mo_Owner;
+				u32 mui_Index;
+				volatile bool mb_Quit;
+				Event mo_WakeEvent;
+			};
+#endif
+
+			BevTickScheduler::BevTickScheduler(u32 _ui_WorkerCount, u32 _ui_ChunkSize)
+				: mui_WorkerCount(_ui_WorkerCount > 0 ? _ui_WorkerCount : 1), mui_ChunkSize(_ui_ChunkSize > 0 ? _ui_ChunkSize : 1)
+			{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				mi_PendingChunks = 0;
+				for (u32 i = 0; i < mui_WorkerCount; ++i)
+					mao_Queues.push_back(new WorkQueue);
+				for (u32 i = 1; i < mui_WorkerCount; ++i)
+				{
+					Worker *worker = new Worker(this, i);
+					Thread *thread = new Thread(worker, Thread::EThreadPriority_Normal, "BevTickWorker");
+					mao_Workers.push_back(worker);
+					mao_Threads.push_back(thread);
+					thread->Start();
+				}
+#else
+				mui_WorkerCount = 1;
+#endif
+			}
+
+			BevTickScheduler::~BevTickScheduler()
+			{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				for (u32 i = 0; i < mao_Threads.size(); ++i)
+				{
+					mao_Threads[i]->Stop();
+					delete mao_Threads[i];
+					delete mao_Workers[i];
+				}
+				for (u32 i = 0; i < mao_Queues.size(); ++i)
+					delete mao_Queues[i];
+#endif
+			}
+
+			u32 BevTickScheduler::GetDefaultWorkerCount()
+			{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				SYSTEM_INFO info;
+				::GetSystemInfo(&info);
+				return info.dwNumberOfProcessors > 0 ? (u32)info.dwNumberOfProcessors : 1;
+#else
+				return 1;
+#endif
+			}
+
+			u32 BevTickScheduler::AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree)
+			{
+				D_CHECK(!_o_Tree || _o_State.IsRoot(_o_Tree->oGetRoot()));
+				mao_Agents.push_back(Agent(&_o_State, _o_Input, _o_Output, _o_Tree));
+				return (u32)mao_Agents.size() - 1;
+			}
+
+			bool BevTickScheduler::RemoveAgent(const BevAgentState &_o_State)
+			{
+				for (u32 i = 0; i < mao_Agents.size(); ++i)
+				{
+					if (mao_Agents[i].mo_State == &_o_State)
+					{
+						mao_Agents[i] = mao_Agents.back();
+						mao_Agents.pop_back();
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void BevTickScheduler::ClearAgents()
+			{
+				mao_Agents.clear();
+			}
+
+			void BevTickScheduler::_TickChunk(u32 _ui_Chunk)
+			{
+				u32 begin = _ui_Chunk * mui_ChunkSize;
+				u32 end = begin + mui_ChunkSize < mao_Agents.size() ? begin + mui_ChunkSize : (u32)mao_Agents.size();
+				for (u32 i = begin; i < end; ++i)
+				{
+					Agent &agent = mao_Agents[i];
+					agent.me_Result = (s8)_TickAgent(*agent.mo_State, agent.mo_Input, agent.mo_Output, agent.mo_Tree);
+				}
+			}
+
+			void BevTickScheduler::TickAll()
+			{
+				u32 chunkCount = _GetChunkCount();
+				if (chunkCount == 0)
+					return;
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				if (mui_WorkerCount > 1 && chunkCount > 1)
+				{
+					//计数要在入队之前设好：上一帧还没睡下的线程可能马上就拿到新的段
+					AtomicExchange(&mi_PendingChunks, (s32)chunkCount);
+					//相邻的段分给同一个线程，偷的时候才打乱
+					for (u32 w = 0; w < mui_WorkerCount; ++w)
+					{
+						u32 begin = chunkCount * w / mui_WorkerCount;
+						u32 end = chunkCount * (w + 1) / mui_WorkerCount;
+						WorkQueue &queue = *mao_Queues[w];
+						queue.mo_Lock.Lock();
+						for (u32 c = begin; c < end; ++c)
+							queue.mao_Chunks.push_back(c);
+						queue.mo_Lock.UnLock();
+					}
+					for (u32 i = 0; i < mao_Workers.size(); ++i)
+						mao_Workers[i]->Wake();
+
+					_RunWorker(0);
+					mo_DoneEvent.Wait();
+					return;
+				}
+#endif
+				for (u32 c = 0; c < chunkCount; ++c)
+					_TickChunk(c);
+			}
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+			void BevTickScheduler::_RunWorker(u32 _ui_Worker)
+			{
+				u32 chunk;
+				while (_PopChunk(_ui_Worker, chunk) || _StealChunk(_ui_Worker, chunk))
+				{
+					_TickChunk(chunk);
+					if (AtomicDecrement(&mi_PendingChunks) == 0)
+						mo_DoneEvent.Set();
+				}
+			}
+
+			bool BevTickScheduler::_PopChunk(u32 _ui_Worker, u32 &_ui_Chunk)
+			{
+				WorkQueue &queue = *mao_Queues[_ui_Worker];
+				bool bFound = false;
+				queue.mo_Lock.Lock();
+				if (!queue.mao_Chunks.empty())
+				{
+					_ui_Chunk = queue.mao_Chunks.back();
+					queue.mao_Chunks.pop_back();
+					bFound = true;
+				}
+				queue.mo_Lock.UnLock();
+				return bFound;
+			}
+
+			bool BevTickScheduler::_StealChunk(u32 _ui_Worker, u32 &_ui_Chunk)
+			{
+				for (u32 i = 1; i < mui_WorkerCount; ++i)
+				{
+					WorkQueue &queue = *mao_Queues[(_ui_Worker + i) % mui_WorkerCount];
+					bool bFound = false;
+					queue.mo_Lock.Lock();
+					if (!queue.mao_Chunks.empty())
+					{
+						_ui_Chunk = queue.mao_Chunks.front();
+						queue.mao_Chunks.pop_front();
+						bFound = true;
+					}
+					queue.mo_Lock.UnLock();
+					if (bFound)
+						return true;
+				}
+				return false;
+			}
+#endif
+
+			//-------------------------------------------------------------------------------------
+			// BevBudgetScheduler
+			//-------------------------------------------------------------------------------------
+			BevBudgetScheduler::BevBudgetScheduler(Tick *_o_Tick)
+				: mo_Tick(_o_Tick), mb_OwnTick(false), mi_AverageAgentTicks(0)
+			{
+				if (!mo_Tick)
+				{
+					mo_Tick = CallCreator<Tick>(E_CreatorType_Tick);
+					mb_OwnTick = true;
+				}
+				D_CHECK(mo_Tick);
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+			}
+
+			BevBudgetScheduler::~BevBudgetScheduler()
+			{
+				if (mb_OwnTick)
+					D_SafeDelete(mo_Tick);
+			}
+
+			u32 BevBudgetScheduler::AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree, u32 _ui_Priority)
+			{
+				D_CHECK(!_o_Tree || _o_State.IsRoot(_o_Tree->oGetRoot()));
+				mao_Agents.push_back(Agent(&_o_State, _o_Input, _o_Output, _o_Tree, _ui_Priority));
+				return (u32)mao_Agents.size() - 1;
+			}
+
+			bool BevBudgetScheduler::RemoveAgent(const BevAgentState &_o_State)
+			{
+				for (u32 i = 0; i < mao_Agents.size(); ++i)
+				{
+					if (mao_Agents[i].mo_State == &_o_State)
+					{
+						mao_Agents[i] = mao_Agents.back();
+						mao_Agents.pop_back();
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void BevBudgetScheduler::ClearAgents()
+			{
+				mao_Agents.clear();
+			}
+
+			void BevBudgetScheduler::TickFrame(f32 _f_DeltaTime, u32 _ui_BudgetMicroseconds)
+			{
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+				u32 agentCount = (u32)mao_Agents.size();
+				if (agentCount == 0)
+					return;
+
+				mao_Queue.resize(agentCount);
+				for (u32 i = 0; i < agentCount; ++i)
+				{
+					mao_Agents[i].mf_PendingDeltaTime += _f_DeltaTime;
+					mao_Queue[i] = i;
+				}
+				UrgencyLess less;
+				less.mo_Agents = &mao_Agents;
+				std::make_heap(mao_Queue.begin(), mao_Queue.end(), less);
+
+				s64 tickPerSec = mo_Tick->GetTickPerSec();
+				s64 budgetTicks = (s64)_ui_BudgetMicroseconds * tickPerSec / 1000000;
+				s64 startTicks = mo_Tick->GetTick();
+				s64 elapsedTicks = 0;
+				std::vector<u32>::iterator queueEnd = mao_Queue.end();
+				while (queueEnd != mao_Queue.begin())
+				{
+					//估计下一个会超出预算就停，但每帧至少做一个，不然预算太小时谁都轮不到
+					if (mo_Stats.mui_TickedCount > 0 && elapsedTicks + mi_AverageAgentTicks > budgetTicks)
+						break;
+					std::pop_heap(mao_Queue.begin(), queueEnd, less);
+					--queueEnd;
+
+					Agent &agent = mao_Agents[*queueEnd];
+					agent.mo_State->SetDeltaTime(agent.mf_PendingDeltaTime);
+					agent.me_Result = (s8)_TickAgent(*agent.mo_State, agent.mo_Input, agent.mo_Output, agent.mo_Tree);
+					agent.mf_PendingDeltaTime = 0;
+					agent.mui_WaitFrames = 0;
+					++mo_Stats.mui_TickedCount;
+
+					s64 nowTicks = mo_Tick->GetTick() - startTicks;
+					//平均耗时取最近若干个agent的滑动平均，树的开销随状态变化
+					s64 agentTicks = nowTicks - elapsedTicks;
+					mi_AverageAgentTicks = mi_AverageAgentTicks == 0 ? agentTicks : mi_AverageAgentTicks + (agentTicks - mi_AverageAgentTicks) / 8;
+					elapsedTicks = nowTicks;
+				}
+
+				//剩下的都是这一帧没轮到的
+				for (std::vector<u32>::iterator it = mao_Queue.begin(); it != queueEnd; ++it)
+				{
+					Agent &agent = mao_Agents[*it];
+					++agent.mui_WaitFrames;
+					if (agent.mui_WaitFrames > mo_Stats.mui_MaxWaitFrames)
+						mo_Stats.mui_MaxWaitFrames = agent.mui_WaitFrames;
+					++mo_Stats.mui_StarvedCount;
+				}
+				mo_Stats.mui_UsedMicroseconds = tickPerSec > 0 ? (u32)(elapsedTicks * 1000000 / tickPerSec) : 0;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevLodScheduler
+			//-------------------------------------------------------------------------------------
+			BevLodScheduler::BevLodScheduler(BevLodImportanceFunc _f_Importance)
+				: mf_Importance(_f_Importance), mui_Frame(0)
+			{
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+			}
+
+			BevLodScheduler &BevLodScheduler::AddTier(u32 _ui_Period, f32 _f_MinImportance)
+			{
+				D_CHECK(mao_Tiers.empty() || _f_MinImportance <= mao_Tiers.back().mf_MinImportance);
+				D_CHECK(mao_Tiers.size() < k_BLimited_InvalidLodTier);
+				Tier tier;
+				//相位存在u16里
+				tier.mui_Period = _ui_Period == 0 ? 1 : (_ui_Period > 0xffff ? 0xffff : _ui_Period);
+				tier.mf_MinImportance = _f_MinImportance;
+				tier.mui_NextPhase = 0;
+				mao_Tiers.push_back(tier);
+				return (*this);
+			}
+
+			void BevLodScheduler::ClearTiers()
+			{
+				mao_Tiers.clear();
+				//档都没了，下一帧所有agent重新分档
+				for (u32 i = 0; i < mao_Agents.size(); ++i)
+					mao_Agents[i].mui_Tier = k_BLimited_InvalidLodTier;
+			}
+
+			u32 BevLodScheduler::AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree)
+			{
+				D_CHECK(!_o_Tree || _o_State.IsRoot(_o_Tree->oGetRoot()));
+				mao_Agents.push_back(Agent(&_o_State, _o_Input, _o_Output, _o_Tree));
+				return (u32)mao_Agents.size() - 1;
+			}
+
+			bool BevLodScheduler::RemoveAgent(const BevAgentState &_o_State)
+			{
+				for (u32 i = 0; i < mao_Agents.size(); ++i)
+				{
+					if (mao_Agents[i].mo_State == &_o_State)
+					{
+						mao_Agents[i] = mao_Agents.back();
+						mao_Agents.pop_back();
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void BevLodScheduler::ClearAgents()
+			{
+				mao_Agents.clear();
+			}
+
+			u32 BevLodScheduler::_SelectTier(const Agent &_o_Agent) const
+			{
+				if (!mf_Importance)
+					return 0;
+				f32 importance = mf_Importance(*_o_Agent.mo_State, _o_Agent.mo_Input);
+				u32 lastTier = (u32)mao_Tiers.size() - 1;
+				for (u32 t = 0; t < lastTier; ++t)
+				{
+					if (importance >= mao_Tiers[t].mf_MinImportance)
+						return t;
+				}
+				return lastTier;
+			}
+
+			void BevLodScheduler::TickFrame(f32 _f_DeltaTime)
+			{
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+				if (mao_Tiers.empty())
+					AddTier(1, 0);
+
+				for (u32 i = 0; i < mao_Agents.size(); ++i)
+				{
+					Agent &agent = mao_Agents[i];
+					agent.mf_PendingDeltaTime += _f_DeltaTime;
+
+					u32 tier = _SelectTier(agent);
+					//升档马上tick，不用等旧档的相位；降档等旧档到点了再换
+					bool bDue = agent.mui_Tier == k_BLimited_InvalidLodTier || tier < agent.mui_Tier || _IsDue(agent);
+					if (!bDue)
+						continue;
+
+					if (tier != agent.mui_Tier)
+					{
+						Tier &newTier = mao_Tiers[tier];
+						//按进入的先后轮流分配相位，同一档的agent均匀分布在各帧
+						agent.mui_Tier = (u16)tier;
+						agent.mui_Phase = (u16)(newTier.mui_NextPhase++ % newTier.mui_Period);
+						++mo_Stats.mui_TierChangeCount;
+					}
+					agent.mo_State->SetDeltaTime(agent.mf_PendingDeltaTime);
+					agent.me_Result = (s8)_TickAgent(*agent.mo_State, agent.mo_Input, agent.mo_Output, agent.mo_Tree);
+					agent.mf_PendingDeltaTime = 0;
+					++mo_Stats.mui_TickedCount;
+				}
+				++mui_Frame;
+			}
+		}
+	}
+}
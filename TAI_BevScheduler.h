@@ -0,0 +1,328 @@
+#ifndef __TAI_BEVSCHEDULER_H__
+#define __TAI_BEVSCHEDULER_H__
+
+#include <vector>
+#include <deque>
+#include "TAI_BevTree.h"
+#include "TAI_BevCompiledTree.h"
+#include "TCore_Atomic.h"
+#include "TCore_Tick.h"
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#include "TCore_Thread.h"
+#include "TCore_Mutex.h"
+#include "TCore_Event.h"
+#endif
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			//多线程tick调度器：agent按mui_ChunkSize分段，每帧把段平均分到各个工作线程的队列里，
+			//线程先从自己队列的尾部取，做完了再去别的线程队列的头部偷
+			//调用TickAll的线程也算一个工作线程；非Win32平台没有线程支持，退化成单线程顺序执行
+			//
+			//并行执行时的约定：
+			//  树（BevNode和BevCompiledTree）在TickAll期间只读，所有线程共享
+			//  BevAgentState每个agent一份，同一帧里只会被一个线程访问
+			//  input在TickAll期间只读，可以多个agent共用一份，节点里不能修改
+			//  output每个agent一份；多个agent共用一个output时节点不能写它
+			//  前提条件和行为节点只能读input、写自己agent的状态和output，访问其他共享数据需要自己加锁
+			class BevTickScheduler
+			{
+			public:
+				BevTickScheduler(u32 _ui_WorkerCount = 1, u32 _ui_ChunkSize = 64);
+				~BevTickScheduler();
+
+				//_o_Tree为NULL时直接用state所属的树，返回agent的下标
+				u32 AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree = NULL);
+				//用最后一个agent填到删除的位置，没找到返回false
+				bool RemoveAgent(const BevAgentState &_o_State);
+				void ClearAgents();
+
+				u32 GetAgentCount() const
+				{
+					return (u32)mao_Agents.size();
+				}
+				u32 GetWorkerCount() const
+				{
+					return mui_WorkerCount;
+				}
+				//上一次TickAll里这个agent的结果，没通过Evaluate的记为k_BRS_Finish
+				BevRunningStatus GetResult(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					return (BevRunningStatus)mao_Agents[_ui_Index].me_Result;
+				}
+
+				//每帧调用一次，所有agent做一遍 if (Evaluate) Tick，返回时已经全部做完；期间不能增删agent
+				//BevAgentState::NeedsEvaluate为false的agent（闲着，订阅的key没变）直接跳过
+				void TickAll();
+
+				//按CPU核数给出的线程数
+				static u32 GetDefaultWorkerCount();
+
+			private:
+				struct Agent
+				{
+					Agent(BevAgentState *_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree)
+						: mo_State(_o_State), mo_Input(_o_Input), mo_Output(_o_Output), mo_Tree(_o_Tree), me_Result(k_BRS_Finish)
+					{
+					}
+					BevAgentState *mo_State;
+					BevNodeInputParam mo_Input;
+					BevNodeOutputParam mo_Output;
+					const BevCompiledTree *mo_Tree;
+					s8 me_Result;
+				};
+
+				u32 _GetChunkCount() const
+				{
+					return ((u32)mao_Agents.size() + mui_ChunkSize - 1) / mui_ChunkSize;
+				}
+				void _TickChunk(u32 _ui_Chunk);
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				struct WorkQueue
+				{
+					Mutex mo_Lock;
+					std::deque<u32> mao_Chunks;
+				};
+				class Worker;
+
+				void _RunWorker(u32 _ui_Worker);
+				bool _PopChunk(u32 _ui_Worker, u32 &_ui_Chunk);
+				bool _StealChunk(u32 _ui_Worker, u32 &_ui_Chunk);
+#endif
+
+			private:
+				u32 mui_WorkerCount;
+				u32 mui_ChunkSize;
+				std::vector<Agent> mao_Agents;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				//每个线程一个队列，0号是调用TickAll的线程
+				std::vector<WorkQueue *> mao_Queues;
+				//工作线程从1号开始
+				std::vector<Worker *> mao_Workers;
+				std::vector<Thread *> mao_Threads;
+				//还没做完的段数，减到0的线程负责通知TickAll
+				volatile s32 mi_PendingChunks;
+				Event mo_DoneEvent;
+#endif
+			};
+
+			//按时间预算分帧tick的调度器：每帧只tick预算里做得完的agent，其余的留到后面的帧
+			//紧迫度是 (等待的帧数 + 1) * 优先级，同优先级的agent轮流执行，优先级低的等久了也会轮到
+			//没轮到的agent的帧时间累加起来，轮到时通过BevAgentState::GetDeltaTime一次交给树
+			//单线程执行，一般在SceneModule::RunOneFrame里用fDeltaT调用TickFrame
+			class BevBudgetScheduler
+			{
+			public:
+				//上一次TickFrame的统计
+				struct FrameStats
+				{
+					u32 mui_TickedCount;
+					//预算不够、这一帧没有tick到的agent数
+					u32 mui_StarvedCount;
+					//没tick到的agent里等得最久的帧数
+					u32 mui_MaxWaitFrames;
+					u32 mui_UsedMicroseconds;
+				};
+
+				//_o_Tick为NULL时通过E_CreatorType_Tick创建一个，由调度器负责释放
+				BevBudgetScheduler(Tick *_o_Tick = NULL);
+				~BevBudgetScheduler();
+
+				//_o_Tree为NULL时直接用state所属的树，_ui_Priority至少为1，返回agent的下标
+				u32 AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree = NULL, u32 _ui_Priority = 1);
+				//用最后一个agent填到删除的位置，没找到返回false
+				bool RemoveAgent(const BevAgentState &_o_State);
+				void ClearAgents();
+
+				void SetPriority(u32 _ui_Index, u32 _ui_Priority)
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					mao_Agents[_ui_Index].mui_Priority = _ui_Priority > 0 ? _ui_Priority : 1;
+				}
+				u32 GetAgentCount() const
+				{
+					return (u32)mao_Agents.size();
+				}
+				//最近一次tick的结果，没通过Evaluate的记为k_BRS_Finish
+				BevRunningStatus GetResult(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					return (BevRunningStatus)mao_Agents[_ui_Index].me_Result;
+				}
+				//还没交给树的累计时间，和已经连续等了几帧
+				f32 GetPendingDeltaTime(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					return mao_Agents[_ui_Index].mf_PendingDeltaTime;
+				}
+				u32 GetWaitFrames(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					return mao_Agents[_ui_Index].mui_WaitFrames;
+				}
+				const FrameStats &GetFrameStats() const
+				{
+					return mo_Stats;
+				}
+
+				//每帧调用一次，按紧迫度依次tick，估计下一个会超出预算时停下；每帧至少tick一个agent
+				void TickFrame(f32 _f_DeltaTime, u32 _ui_BudgetMicroseconds);
+
+			private:
+				BevBudgetScheduler(const BevBudgetScheduler &);
+				BevBudgetScheduler &operator=(const BevBudgetScheduler &);
+
+				struct Agent
+				{
+					Agent(BevAgentState *_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree, u32 _ui_Priority)
+						: mo_State(_o_State), mo_Input(_o_Input), mo_Output(_o_Output), mo_Tree(_o_Tree), mui_Priority(_ui_Priority > 0 ? _ui_Priority : 1), mui_WaitFrames(0), mf_PendingDeltaTime(0), me_Result(k_BRS_Finish)
+					{
+					}
+					u64 GetUrgency() const
+					{
+						return (u64)(mui_WaitFrames + 1) * mui_Priority;
+					}
+					BevAgentState *mo_State;
+					BevNodeInputParam mo_Input;
+					BevNodeOutputParam mo_Output;
+					const BevCompiledTree *mo_Tree;
+					u32 mui_Priority;
+					u32 mui_WaitFrames;
+					f32 mf_PendingDeltaTime;
+					s8 me_Result;
+				};
+				//堆顶是最紧迫的agent，一样紧迫时下标小的先
+				struct UrgencyLess
+				{
+					const std::vector<Agent> *mo_Agents;
+					bool operator()(u32 _ui_Left, u32 _ui_Right) const
+					{
+						u64 left = (*mo_Agents)[_ui_Left].GetUrgency();
+						u64 right = (*mo_Agents)[_ui_Right].GetUrgency();
+						return left != right ? left < right : _ui_Left > _ui_Right;
+					}
+				};
+
+			private:
+				Tick *mo_Tick;
+				bool mb_OwnTick;
+				std::vector<Agent> mao_Agents;
+				//每帧重建的待执行队列（堆）
+				std::vector<u32> mao_Queue;
+				//单个agent一次tick的平均耗时（Tick的单位），用来判断下一个还放不放得下
+				s64 mi_AverageAgentTicks;
+				FrameStats mo_Stats;
+			};
+
+#define k_BLimited_InvalidLodTier 0xffff
+
+			//agent的重要度，一般按和玩家的距离算，越大越重要
+			typedef f32 (*BevLodImportanceFunc)(const BevAgentState &state, const BevNodeInputParam &input);
+
+			//按LOD分档降频tick的调度器：每档有一个周期，重要度够高的agent每帧tick，远处的每几帧才tick一次
+			//同一档的agent错开相位，每帧tick的数量大致相同
+			//换档的规则：升档（变得更重要）马上tick一次再按新档的相位走；降档等到旧档下一次该tick时再换
+			//跳过的帧时间累加起来通过BevAgentState::GetDeltaTime交给树，正在运行的行为节点不会丢时间也不会被打断
+			class BevLodScheduler
+			{
+			public:
+				struct FrameStats
+				{
+					u32 mui_TickedCount;
+					u32 mui_TierChangeCount;
+				};
+
+				BevLodScheduler(BevLodImportanceFunc _f_Importance = NULL);
+
+				//按重要度从高到低添加：重要度不低于_f_MinImportance的agent每_ui_Period帧tick一次，都够不上的算最后一档
+				//一档都没有或者没有重要度函数时所有agent每帧tick
+				BevLodScheduler &AddTier(u32 _ui_Period, f32 _f_MinImportance);
+				void ClearTiers();
+				void SetImportanceFunc(BevLodImportanceFunc _f_Importance)
+				{
+					mf_Importance = _f_Importance;
+				}
+				u32 GetTierCount() const
+				{
+					return (u32)mao_Tiers.size();
+				}
+
+				//_o_Tree为NULL时直接用state所属的树，返回agent的下标；新加的agent在下一次TickFrame里一定会tick
+				u32 AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree = NULL);
+				//用最后一个agent填到删除的位置，没找到返回false
+				bool RemoveAgent(const BevAgentState &_o_State);
+				void ClearAgents();
+
+				u32 GetAgentCount() const
+				{
+					return (u32)mao_Agents.size();
+				}
+				//最近一次tick的结果，没通过Evaluate的记为k_BRS_Finish
+				BevRunningStatus GetResult(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					return (BevRunningStatus)mao_Agents[_ui_Index].me_Result;
+				}
+				//当前所在的档，还没tick过的是k_BLimited_InvalidLodTier
+				u32 GetTier(u32 _ui_Index) const
+				{
+					D_CHECK(_ui_Index < mao_Agents.size());
+					return mao_Agents[_ui_Index].mui_Tier;
+				}
+				const FrameStats &GetFrameStats() const
+				{
+					return mo_Stats;
+				}
+
+				//每帧调用一次，每个agent都会求一次重要度，到了自己相位的才tick
+				void TickFrame(f32 _f_DeltaTime);
+
+			private:
+				struct Tier
+				{
+					u32 mui_Period;
+					f32 mf_MinImportance;
+					//下一个进入这一档的agent用的相位，轮流分配
+					u32 mui_NextPhase;
+				};
+				struct Agent
+				{
+					Agent(BevAgentState *_o_State, const BevNodeInputParam &_o_Input, const BevNodeOutputParam &_o_Output, const BevCompiledTree *_o_Tree)
+						: mo_State(_o_State), mo_Input(_o_Input), mo_Output(_o_Output), mo_Tree(_o_Tree), mui_Tier(k_BLimited_InvalidLodTier), mui_Phase(0), mf_PendingDeltaTime(0), me_Result(k_BRS_Finish)
+					{
+					}
+					BevAgentState *mo_State;
+					BevNodeInputParam mo_Input;
+					BevNodeOutputParam mo_Output;
+					const BevCompiledTree *mo_Tree;
+					u16 mui_Tier;
+					u16 mui_Phase;
+					f32 mf_PendingDeltaTime;
+					s8 me_Result;
+				};
+
+				u32 _SelectTier(const Agent &_o_Agent) const;
+				bool _IsDue(const Agent &_o_Agent) const
+				{
+					const Tier &tier = mao_Tiers[_o_Agent.mui_Tier];
+					return mui_Frame % tier.mui_Period == _o_Agent.mui_Phase;
+				}
+
+			private:
+				BevLodImportanceFunc mf_Importance;
+				std::vector<Tier> mao_Tiers;
+				std::vector<Agent> mao_Agents;
+				u32 mui_Frame;
+				FrameStats mo_Stats;
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include "TAI_BevTrace.h"
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#include "TCore_Event.h"
+#endif
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+			//后台写盘线程，每隔k_BLimited_TraceFlushInterval写一次
+			class BevTraceRecorder::Writer : public IThreadRunner
+			{
+			public:
+				Writer(BevTraceRecorder *_o_Owner)
+					: mo_Owner(_o_Owner), mb_Quit(false)
+				{
+				}
+				virtual u32 Run()
+				{
+					while (!mb_Quit)
+					{
+						mo_WakeEvent.Wait(k_BLimited_TraceFlushInterval);
+						mo_Owner->Flush();
+					}
+					return 0;
+				}
+				virtual void NotifyQuit()
+				{
+					mb_Quit = true;
+					mo_WakeEvent.Set();
+				}
+
+			private:
+				BevTraceRecorder *mo_Owner;
+				volatile bool mb_Quit;
+				Event mo_WakeEvent;
+			};
+#endif
+
+			BevTraceRecorder::BevTraceRecorder(u32 _ui_Capacity)
+				: mui_Mask(_ui_Capacity - 1), mi_WriteIndex(0), mui_ReadIndex(0), mui_DroppedCount(0), mp_File(NULL)
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				  , mo_Writer(NULL), mo_Thread(NULL)
+#endif
+			{
+				D_CHECK(_ui_Capacity > 0 && (_ui_Capacity & mui_Mask) == 0);
+				mao_Slots.resize(_ui_Capacity);
+				//初始的序号比第一圈要写的都旧，看起来就是还没写
+				for (u32 i = 0; i < _ui_Capacity; ++i)
+				{
+					memset(&mao_Slots[i].mo_Record, 0, sizeof(BevTraceRecord));
+					mao_Slots[i].mi_Sequence = _GetSequence(i - _ui_Capacity);
+				}
+			}
+
+			BevTraceRecorder::~BevTraceRecorder()
+			{
+				Close();
+			}
+
+			bool BevTraceRecorder::Open(const char *_z_FilePath)
+			{
+				Close();
+				FILE *fp = fopen(_z_FilePath, "wb");
+				if (!fp)
+				{
+					D_Output("BevTraceRecorder: can't open %s\n", _z_FilePath);
+					return false;
+				}
+				BevTraceFileHeader header;
+				header.mui_Magic = k_BLimited_TraceMagic;
+				header.mui_Version = k_BLimited_TraceVersion;
+				header.mui_RecordSize = sizeof(BevTraceRecord);
+				header.mui_Reserved = 0;
+				if (fwrite(&header, sizeof(header), 1, fp) != 1)
+				{
+					fclose(fp);
+					return false;
+				}
+				mp_File = fp;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				mo_Writer = new Writer(this);
+				mo_Thread = new Thread(mo_Writer, Thread::EThreadPriority_Low, "BevTraceWriter");
+				mo_Thread->Start();
+#endif
+				return true;
+			}
+
+			void BevTraceRecorder::Close()
+			{
+				if (!mp_File)
+					return;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				mo_Thread->Stop();
+				D_SafeDelete(mo_Thread);
+				D_SafeDelete(mo_Writer);
+#endif
+				_Write();
+				fclose(mp_File);
+				mp_File = NULL;
+			}
+
+			void BevTraceRecorder::Flush()
+			{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				mo_Lock.Lock();
+				if (mp_File)
+					_Write();
+				mo_Lock.UnLock();
+#else
+				if (mp_File)
+					_Write();
+#endif
+			}
+
+			u32 BevTraceRecorder::Drain(std::vector<BevTraceRecord> &_o_Records)
+			{
+				D_CHECK(!mp_File);
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				mo_Lock.Lock();
+				u32 count = _Drain(_o_Records);
+				mo_Lock.UnLock();
+				return count;
+#else
+				return _Drain(_o_Records);
+#endif
+			}
+
+			void BevTraceRecorder::_Write()
+			{
+				mao_Pending.clear();
+				if (_Drain(mao_Pending) > 0)
+					fwrite(&mao_Pending[0], sizeof(BevTraceRecord), mao_Pending.size(), mp_File);
+				fflush(mp_File);
+			}
+
+			u32 BevTraceRecorder::_Drain(std::vector<BevTraceRecord> &_o_Records)
+			{
+				u32 count = 0;
+				u32 writeIndex = (u32)AtomicAdd(&mi_WriteIndex, 0);
+				u32 capacity = mui_Mask + 1;
+				//写的一方已经多绕了一圈，最老的那些被覆盖了
+				if (writeIndex - mui_ReadIndex > capacity)
+				{
+					mui_DroppedCount += writeIndex - mui_ReadIndex - capacity;
+					mui_ReadIndex = writeIndex - capacity;
+				}
+				while (mui_ReadIndex != writeIndex)
+				{
+					Slot &slot = mao_Slots[mui_ReadIndex & mui_Mask];
+					s32 expected = _GetSequence(mui_ReadIndex);
+					s32 sequence = AtomicAdd(&slot.mi_Sequence, 0);
+					if (sequence == expected)
+					{
+						BevTraceRecord record = slot.mo_Record;
+						sequence = AtomicAdd(&slot.mi_Sequence, 0);
+						if (sequence == expected)
+						{
+							_o_Records.push_back(record);
+							++count;
+							++mui_ReadIndex;
+							continue;
+						}
+						//拷贝的时候被下一圈覆盖了
+						sequence = expected + 2;
+					}
+					//还没写完，或者占了位置还没开始写，下次再取
+					if (sequence == 0 || (u32)sequence - (u32)expected >= 0x80000000u)
+						break;
+					//已经被下一圈覆盖
+					++mui_DroppedCount;
+					++mui_ReadIndex;
+				}
+				return count;
+			}
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#ifndef __TAI_BEVTRACE_H__
+#define __TAI_BEVTRACE_H__
+
+#include <stdio.h>
+#include <vector>
+#include "TCore_Atomic.h"
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#include "TCore_Thread.h"
+#include "TCore_Mutex.h"
+#endif
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+//'BEVR'，和BevTreeFile的'BEVT'、BevTreeImage的'BEVI'区分开
+#define k_BLimited_TraceMagic 0x52564542
+#define k_BLimited_TraceVersion 1
+//环形缓冲区默认能放的记录数，要是2的幂
+#define k_BLimited_TraceDefaultCapacity 0x10000
+//后台写盘线程两次写盘之间最多等多久，毫秒
+#define k_BLimited_TraceFlushInterval 100
+
+			enum E_BevTraceEvent
+			{
+				//根节点评估，mi_Value是评估结果
+				k_BTE_Evaluate = 0,
+				//行为节点_DoEnter
+				k_BTE_Enter,
+				//行为节点执行了一次，mi_Value是返回的BevRunningStatus
+				k_BTE_Execute,
+				//行为节点_DoExit，mi_Value是传给_DoExit的BevRunningStatus
+				k_BTE_Exit,
+				//活跃节点变了（SetActiveNode），mui_NodeID是新的活跃节点，没有时是0
+				k_BTE_ActiveNode,
+				k_BTE_Count,
+			};
+
+			//一条记录，文件里也是这个格式
+			struct BevTraceRecord
+			{
+				u32 mui_AgentID;
+				//agent的评估序号（BevAgentState::GetEvaluateStamp），同一帧里的记录相同
+				u32 mui_Frame;
+				//节点ID（BevNode::GetNodeID），换了进程、重新加载了树也不变
+				u32 mui_NodeID;
+				//E_BevTraceEvent
+				u8 me_Event;
+				s8 mi_Value;
+				u8 mab_Reserved[2];
+			};
+
+			//文件头，后面跟着BevTraceRecord[]直到文件结尾
+			struct BevTraceFileHeader
+			{
+				u32 mui_Magic;
+				u32 mui_Version;
+				u32 mui_RecordSize;
+				u32 mui_Reserved;
+			};
+
+			//执行轨迹：agent通过BevAgentState::SetTrace挂上来之后，行为节点的进入/执行/退出、根节点的评估结果
+			//和活跃节点的变化都记成定长的记录，写进一个环形缓冲区
+			//  记录时只有一次原子加和两次原子交换，不加锁、不分配内存，没挂上的agent只多一次判断，可以一直开着
+			//  Open之后把记录不断写进文件，Win32上有后台线程定时写，其它平台要自己每帧调用Flush
+			//  没有Open时用Drain取走记录；只能有一个地方在取
+			//缓冲区满了会覆盖最老的还没取走的记录，丢了多少见GetDroppedCount
+			//同一个agent的记录按发生的顺序排列；并行节点用JobPool在多个线程上跑孩子时，孩子之间的顺序不确定
+			class BevTraceRecorder
+			{
+			public:
+				//_ui_Capacity要是2的幂
+				BevTraceRecorder(u32 _ui_Capacity = k_BLimited_TraceDefaultCapacity);
+				~BevTraceRecorder();
+
+				//打开文件，之后的记录都写进去，文件已经存在时会被覆盖
+				bool Open(const char *_z_FilePath);
+				//把剩下的记录写完再关
+				void Close();
+				bool IsOpen() const
+				{
+					return mp_File != NULL;
+				}
+				//马上把缓冲区里的记录写进文件
+				void Flush();
+
+				//没有Open时取走缓冲区里的记录，追加到_o_Records后面，返回取到的条数
+				u32 Drain(std::vector<BevTraceRecord> &_o_Records);
+
+				//被覆盖掉、没能取走的记录数
+				u32 GetDroppedCount() const
+				{
+					return mui_DroppedCount;
+				}
+
+				void Record(u32 _ui_AgentID, u32 _ui_Frame, u32 _ui_NodeID, E_BevTraceEvent _e_Event, s32 _i_Value)
+				{
+					u32 index = (u32)AtomicIncrement(&mi_WriteIndex) - 1;
+					Slot &slot = mao_Slots[index & mui_Mask];
+					//先标成正在写，取的时候看到前后两次序号不同就知道读到了一半
+					AtomicExchange(&slot.mi_Sequence, 0);
+					slot.mo_Record.mui_AgentID = _ui_AgentID;
+					slot.mo_Record.mui_Frame = _ui_Frame;
+					slot.mo_Record.mui_NodeID = _ui_NodeID;
+					slot.mo_Record.me_Event = (u8)_e_Event;
+					slot.mo_Record.mi_Value = (s8)_i_Value;
+					AtomicExchange(&slot.mi_Sequence, _GetSequence(index));
+				}
+
+			private:
+				BevTraceRecorder(const BevTraceRecorder &);
+				BevTraceRecorder &operator=(const BevTraceRecorder &);
+
+				//写完的槽位的序号是奇数，0表示正在写
+				static s32 _GetSequence(u32 _ui_Index)
+				{
+					return (s32)((_ui_Index << 1) | 1);
+				}
+				u32 _Drain(std::vector<BevTraceRecord> &_o_Records);
+				void _Write();
+
+			private:
+				struct Slot
+				{
+					volatile s32 mi_Sequence;
+					BevTraceRecord mo_Record;
+				};
+				std::vector<Slot> mao_Slots;
+				u32 mui_Mask;
+				volatile s32 mi_WriteIndex;
+				//取记录的一方用的，只在锁里改
+				u32 mui_ReadIndex;
+				u32 mui_DroppedCount;
+				std::vector<BevTraceRecord> mao_Pending;
+				FILE *mp_File;
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+				class Writer;
+				Mutex mo_Lock;
+				Writer *mo_Writer;
+				Thread *mo_Thread;
+#endif
+			};
+		}
+	}
+}
+
+#endif
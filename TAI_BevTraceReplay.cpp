@@ -0,0 +1,159 @@
+#include "TAI_BevTraceReplay.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			namespace
+			{
+				const char *_GetEventName(u8 _e_Event)
+				{
+					static const char *s_Names[k_BTE_Count] = {"evaluate", "enter", "execute", "exit", "active"};
+					return _e_Event < k_BTE_Count ? s_Names[_e_Event] : "unknown";
+				}
+
+				void _PrintRecord(const char *_z_Label, bool _b_Has, const BevTraceRecord &_o_Record)
+				{
+					if (_b_Has)
+						D_Output("  %s: frame %u %s node 0x%08x value %d\n", _z_Label, _o_Record.mui_Frame, _GetEventName(_o_Record.me_Event), _o_Record.mui_NodeID, _o_Record.mi_Value);
+					else
+						D_Output("  %s: (end of trace)\n", _z_Label);
+				}
+			}
+
+			BevTraceReplayer::BevTraceReplayer()
+			{
+				memset(&mo_Mismatch, 0, sizeof(mo_Mismatch));
+			}
+
+			bool BevTraceReplayer::Load(const char *_z_FilePath, u32 _ui_AgentID)
+			{
+				mao_Expected.clear();
+				FILE *fp = fopen(_z_FilePath, "rb");
+				if (!fp)
+				{
+					D_Output("BevTraceReplayer: can't open %s\n", _z_FilePath);
+					return false;
+				}
+				BevTraceFileHeader header;
+				if (fread(&header, sizeof(header), 1, fp) != 1 || header.mui_Magic != k_BLimited_TraceMagic ||
+					header.mui_Version != k_BLimited_TraceVersion || header.mui_RecordSize != sizeof(BevTraceRecord))
+				{
+					D_Output("BevTraceReplayer: %s is not a trace file of this version\n", _z_FilePath);
+					fclose(fp);
+					return false;
+				}
+				//一次读一段，只留这个agent的
+				BevTraceRecord buffer[256];
+				size_t count;
+				while ((count = fread(buffer, sizeof(BevTraceRecord), 256, fp)) > 0)
+				{
+					for (size_t i = 0; i < count; ++i)
+					{
+						if (buffer[i].mui_AgentID == _ui_AgentID)
+							mao_Expected.push_back(buffer[i]);
+					}
+				}
+				fclose(fp);
+				return true;
+			}
+
+			void BevTraceReplayer::SetRecords(const BevTraceRecord *_o_Records, u32 _ui_Count, u32 _ui_AgentID)
+			{
+				mao_Expected.clear();
+				for (u32 i = 0; i < _ui_Count; ++i)
+				{
+					if (_o_Records[i].mui_AgentID == _ui_AgentID)
+						mao_Expected.push_back(_o_Records[i]);
+				}
+			}
+
+			bool BevTraceReplayer::Replay(const BevNode &_o_Root, BevTraceInputSource &_o_Source, BevNodeOutputParam &_o_Output)
+			{
+				return _Replay(&_o_Root, NULL, _o_Source, _o_Output);
+			}
+
+			bool BevTraceReplayer::Replay(const BevCompiledTree &_o_Tree, BevTraceInputSource &_o_Source, BevNodeOutputParam &_o_Output)
+			{
+				return _Replay(_o_Tree.oGetRoot(), &_o_Tree, _o_Source, _o_Output);
+			}
+
+			bool BevTraceReplayer::_Replay(const BevNode *_o_Root, const BevCompiledTree *_o_Tree, BevTraceInputSource &_o_Source, BevNodeOutputParam &_o_Output)
+			{
+				mao_Actual.clear();
+				memset(&mo_Mismatch, 0, sizeof(mo_Mismatch));
+
+				BevTraceRecorder recorder;
+				BevAgentState *pState = _o_Tree ? new BevAgentState(*_o_Tree) : new BevAgentState(*_o_Root);
+				pState->SetTrace(&recorder, 0);
+
+				bool bSame = true;
+				u32 compared = 0;
+				const BevNodeInputParam *pInput;
+				for (u32 frame = 0; bSame && (pInput = _o_Source.oGetInput(frame)) != NULL; ++frame)
+				{
+					if (_o_Tree)
+					{
+						if (_o_Tree->Evaluate(*pState, *pInput))
+							_o_Tree->Tick(*pState, *pInput, _o_Output);
+					}
+					else
+					{
+						if (_o_Root->Evaluate(*pState, *pInput))
+							_o_Root->Tick(*pState, *pInput, _o_Output);
+					}
+					recorder.Drain(mao_Actual);
+					//还没跑完的部分不算，只比两边都有的
+					u32 count = (u32)(mao_Actual.size() < mao_Expected.size() ? mao_Actual.size() : mao_Expected.size());
+					bSame = Diff(mao_Expected.empty() ? NULL : &mao_Expected[0], count, mao_Actual.empty() ? NULL : &mao_Actual[0], count, mo_Mismatch, compared);
+					compared = count;
+				}
+				if (bSame)
+					bSame = Diff(mao_Expected.empty() ? NULL : &mao_Expected[0], (u32)mao_Expected.size(), mao_Actual.empty() ? NULL : &mao_Actual[0], (u32)mao_Actual.size(), mo_Mismatch, compared);
+				if (recorder.GetDroppedCount() > 0)
+					D_Output("BevTraceReplayer: %u records of the replay were dropped, a frame produced more than the buffer holds\n", recorder.GetDroppedCount());
+
+				delete pState;
+				return bSame;
+			}
+
+			bool BevTraceReplayer::Diff(const BevTraceRecord *_o_Expected, u32 _ui_ExpectedCount, const BevTraceRecord *_o_Actual, u32 _ui_ActualCount, BevTraceMismatch &_o_Mismatch, u32 _ui_Start)
+			{
+				u32 count = _ui_ExpectedCount < _ui_ActualCount ? _ui_ExpectedCount : _ui_ActualCount;
+				u32 i = _ui_Start;
+				for (; i < count; ++i)
+				{
+					const BevTraceRecord &expected = _o_Expected[i];
+					const BevTraceRecord &actual = _o_Actual[i];
+					if (expected.me_Event != actual.me_Event || expected.mui_NodeID != actual.mui_NodeID || expected.mi_Value != actual.mi_Value)
+						break;
+				}
+				if (i == _ui_ExpectedCount && i == _ui_ActualCount)
+					return true;
+				memset(&_o_Mismatch, 0, sizeof(_o_Mismatch));
+				_o_Mismatch.mui_Index = i;
+				_o_Mismatch.mb_HasExpected = i < _ui_ExpectedCount;
+				_o_Mismatch.mb_HasActual = i < _ui_ActualCount;
+				if (_o_Mismatch.mb_HasExpected)
+					_o_Mismatch.mo_Expected = _o_Expected[i];
+				if (_o_Mismatch.mb_HasActual)
+					_o_Mismatch.mo_Actual = _o_Actual[i];
+				return false;
+			}
+
+			void BevTraceReplayer::PrintMismatch() const
+			{
+				if (!mo_Mismatch.mb_HasExpected && !mo_Mismatch.mb_HasActual)
+				{
+					D_Output("BevTraceReplayer: %u records, same path\n", (u32)mao_Actual.size());
+					return;
+				}
+				D_Output("BevTraceReplayer: path diverges at record %u\n", mo_Mismatch.mui_Index);
+				_PrintRecord("recorded", mo_Mismatch.mb_HasExpected, mo_Mismatch.mo_Expected);
+				_PrintRecord("replayed", mo_Mismatch.mb_HasActual, mo_Mismatch.mo_Actual);
+			}
+		}
+	}
+}
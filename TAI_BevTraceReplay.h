@@ -0,0 +1,84 @@
+#ifndef __TAI_BEVTRACEREPLAY_H__
+#define __TAI_BEVTRACEREPLAY_H__
+
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevCompiledTree.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			//两段轨迹第一处不一样的地方
+			struct BevTraceMismatch
+			{
+				//在各自轨迹里的下标
+				u32 mui_Index;
+				//其中一段先结束了，对应的记录没有
+				bool mb_HasExpected;
+				bool mb_HasActual;
+				BevTraceRecord mo_Expected;
+				BevTraceRecord mo_Actual;
+			};
+
+			//重放时每一帧的输入，由录制的一方自己保存
+			class BevTraceInputSource
+			{
+			public:
+				virtual ~BevTraceInputSource()
+				{
+				}
+				//第_ui_Frame帧（从0开始）的输入，没有了返回NULL；返回的输入要保持到下一次调用
+				virtual const BevNodeInputParam *oGetInput(u32 _ui_Frame) = 0;
+			};
+
+			//确定性重放：用录下来的输入在一个新的agent上重新跑一遍树，和录下来的轨迹逐条比较，找出走的路径第一次分岔的地方
+			//  录制时agent要在第一次评估之前挂上BevTraceRecorder，每帧和这里一样先Evaluate，通过了再Tick
+			//  只比较事件、节点ID和值，不比较帧号和agent编号
+			class BevTraceReplayer
+			{
+			public:
+				BevTraceReplayer();
+
+				//读BevTraceRecorder写的文件，只留下_ui_AgentID的记录
+				bool Load(const char *_z_FilePath, u32 _ui_AgentID);
+				//直接用内存里的记录，同样只留下_ui_AgentID的
+				void SetRecords(const BevTraceRecord *_o_Records, u32 _ui_Count, u32 _ui_AgentID);
+				const std::vector<BevTraceRecord> &GetRecords() const
+				{
+					return mao_Expected;
+				}
+
+				//一直跑到输入用完，路径和录下来的一样返回true，不一样时停在分岔的那一帧，用GetMismatch看
+				bool Replay(const BevNode &_o_Root, BevTraceInputSource &_o_Source, BevNodeOutputParam &_o_Output);
+				bool Replay(const BevCompiledTree &_o_Tree, BevTraceInputSource &_o_Source, BevNodeOutputParam &_o_Output);
+				//重放出来的记录
+				const std::vector<BevTraceRecord> &GetReplayedRecords() const
+				{
+					return mao_Actual;
+				}
+				const BevTraceMismatch &GetMismatch() const
+				{
+					return mo_Mismatch;
+				}
+				void PrintMismatch() const;
+
+				//逐条比较两段轨迹，一样返回true；_ui_Start之前的认为已经比过
+				static bool Diff(const BevTraceRecord *_o_Expected, u32 _ui_ExpectedCount, const BevTraceRecord *_o_Actual, u32 _ui_ActualCount, BevTraceMismatch &_o_Mismatch, u32 _ui_Start = 0);
+
+			private:
+				//_o_Tree为NULL时用根节点跑
+				bool _Replay(const BevNode *_o_Root, const BevCompiledTree *_o_Tree, BevTraceInputSource &_o_Source, BevNodeOutputParam &_o_Output);
+
+			private:
+				std::vector<BevTraceRecord> mao_Expected;
+				std::vector<BevTraceRecord> mao_Actual;
+				BevTraceMismatch mo_Mismatch;
+			};
+		}
+	}
+}
+
+#endif
@@ -1,4 +1,10 @@
 #include "TAI_BevTree.h"
+#include "TAI_BevBlackboard.h"
+#include "TAI_BevCompiledTree.h"
+#include "TCore_JobPool.h"
+#include "TEngine_ClockModule.h"
+#include "TAI_RefValue.h"
+#include "TAI_StringID.h"
 
 namespace TsiU
 {
@@ -6,122 +12,420 @@ namespace TsiU
 	{
 		namespace BehaviorTree
 		{
+			//-------------------------------------------------------------------------------------
+			// BevClock
+			//-------------------------------------------------------------------------------------
+			const BevClock *BevClock::ms_Default = NULL;
+			void BevClock::SetDefault(const BevClock *_o_Clock)
+			{
+				ms_Default = _o_Clock;
+			}
+			const BevClock *BevClock::oGetDefault()
+			{
+				return ms_Default;
+			}
+			f32 BevEngineClock::GetSeconds() const
+			{
+				return mo_Clock->GetTotalElapsedSeconds();
+			}
+			//-------------------------------------------------------------------------------------
+			// BevAgentState
+			//-------------------------------------------------------------------------------------
+			BevAgentState::BevAgentState(const BevNode &_o_Root)
+				: mo_Root(&_o_Root), mui_Size(_o_Root.GetTreeStateSize()), mui_ConditionCacheOffset(_o_Root.GetConditionCacheOffset()), mui_ConditionCacheCount(_o_Root.GetConditionCacheCount()), mab_InitialState(NULL),
+				  mab_Data(NULL), mb_OwnData(true), mo_ActiveNode(NULL), mo_LastActiveNode(NULL), mf_DeltaTime(0), mui_EvaluateStamp(0), mpui_ConditionCache(NULL), mui_ConditionEpoch(1), mo_Trace(NULL), mui_TraceAgentID(0), mo_Blackboard(NULL), mo_Clock(NULL),
+				  mui_RootWatchMask(_o_Root.GetWatchMask()), mb_RootWatchable(_o_Root.IsWatchable()), mb_LastEvaluateResult(true)
+			{
+				_Init();
+			}
+			BevAgentState::BevAgentState(const BevNode &_o_Root, void *_p_Memory)
+				: mo_Root(&_o_Root), mui_Size(_o_Root.GetTreeStateSize()), mui_ConditionCacheOffset(_o_Root.GetConditionCacheOffset()), mui_ConditionCacheCount(_o_Root.GetConditionCacheCount()), mab_InitialState(NULL),
+				  mab_Data(static_cast<u8 *>(_p_Memory)), mb_OwnData(false), mo_ActiveNode(NULL), mo_LastActiveNode(NULL), mf_DeltaTime(0), mui_EvaluateStamp(0), mpui_ConditionCache(NULL), mui_ConditionEpoch(1), mo_Trace(NULL), mui_TraceAgentID(0), mo_Blackboard(NULL), mo_Clock(NULL),
+				  mui_RootWatchMask(_o_Root.GetWatchMask()), mb_RootWatchable(_o_Root.IsWatchable()), mb_LastEvaluateResult(true)
+			{
+				D_CHECK(mab_Data);
+				_Init();
+			}
+			BevAgentState::BevAgentState(const BevCompiledTree &_o_Tree)
+				: mo_Root(_o_Tree.oGetRoot()), mui_Size(_o_Tree.GetTreeStateSize()), mui_ConditionCacheOffset(_o_Tree.GetConditionCacheOffset()), mui_ConditionCacheCount(_o_Tree.GetConditionCacheCount()), mab_InitialState(_o_Tree.GetInitialState()),
+				  mab_Data(NULL), mb_OwnData(true), mo_ActiveNode(NULL), mo_LastActiveNode(NULL), mf_DeltaTime(0), mui_EvaluateStamp(0), mpui_ConditionCache(NULL), mui_ConditionEpoch(1), mo_Trace(NULL), mui_TraceAgentID(0), mo_Blackboard(NULL), mo_Clock(NULL),
+				  mui_RootWatchMask(_o_Tree.GetNode(0).mui_WatchMask), mb_RootWatchable(_o_Tree.GetNode(0).mb_Watchable), mb_LastEvaluateResult(true)
+			{
+				_Init();
+			}
+			BevAgentState::BevAgentState(const BevCompiledTree &_o_Tree, void *_p_Memory)
+				: mo_Root(_o_Tree.oGetRoot()), mui_Size(_o_Tree.GetTreeStateSize()), mui_ConditionCacheOffset(_o_Tree.GetConditionCacheOffset()), mui_ConditionCacheCount(_o_Tree.GetConditionCacheCount()), mab_InitialState(_o_Tree.GetInitialState()),
+				  mab_Data(static_cast<u8 *>(_p_Memory)), mb_OwnData(false), mo_ActiveNode(NULL), mo_LastActiveNode(NULL), mf_DeltaTime(0), mui_EvaluateStamp(0), mpui_ConditionCache(NULL), mui_ConditionEpoch(1), mo_Trace(NULL), mui_TraceAgentID(0), mo_Blackboard(NULL), mo_Clock(NULL),
+				  mui_RootWatchMask(_o_Tree.GetNode(0).mui_WatchMask), mb_RootWatchable(_o_Tree.GetNode(0).mb_Watchable), mb_LastEvaluateResult(true)
+			{
+				D_CHECK(mab_Data);
+				_Init();
+			}
+			BevAgentState::BevAgentState(const BevAgentState &_o_Parent, BevBlackboard *_o_Blackboard)
+				: mo_Root(_o_Parent.mo_Root), mui_Size(_o_Parent.mui_Size), mui_ConditionCacheOffset(_o_Parent.mui_ConditionCacheOffset), mui_ConditionCacheCount(_o_Parent.mui_ConditionCacheCount), mab_InitialState(_o_Parent.mab_InitialState),
+				  mab_Data(_o_Parent.mab_Data), mb_OwnData(false), mo_ActiveNode(_o_Parent.mo_ActiveNode), mo_LastActiveNode(_o_Parent.mo_LastActiveNode), mf_DeltaTime(_o_Parent.mf_DeltaTime), mui_EvaluateStamp(_o_Parent.mui_EvaluateStamp),
+				  mpui_ConditionCache(_o_Parent.mpui_ConditionCache), mui_ConditionEpoch(_o_Parent.mui_ConditionEpoch), mo_Trace(_o_Parent.mo_Trace), mui_TraceAgentID(_o_Parent.mui_TraceAgentID), mo_Blackboard(_o_Blackboard), mo_Clock(_o_Parent.mo_Clock),
+				  mui_RootWatchMask(_o_Parent.mui_RootWatchMask), mb_RootWatchable(_o_Parent.mb_RootWatchable), mb_LastEvaluateResult(_o_Parent.mb_LastEvaluateResult)
+			{
+				memcpy(maui_DirtyStamp, _o_Parent.maui_DirtyStamp, sizeof(maui_DirtyStamp));
+				//黑板的分身写的时候标分身的脏，不用SetBlackboard，那样所有key都算脏了
+				if (mo_Blackboard)
+				{
+					D_CHECK(!mo_Blackboard->mo_Agent);
+					mo_Blackboard->mo_Agent = this;
+				}
+			}
+			u32 BevAgentState::_GetDirtyMaskSince(const BevAgentState &_o_Parent) const
+			{
+				u32 mask = 0;
+				for (u32 i = 0; i < k_BLimited_WatchKeyBits; ++i)
+				{
+					if (maui_DirtyStamp[i] != _o_Parent.maui_DirtyStamp[i])
+						mask |= 1u << i;
+				}
+				return mask;
+			}
+			void BevAgentState::_MergeActiveNode(const BevNode *_o_ActiveNode, const BevNode *_o_LastActiveNode)
+			{
+				//分身里换的时候已经记过轨迹了，这里再记一次，轨迹里最后一条是合并以后的结果
+				if (mo_Trace && _o_ActiveNode != mo_ActiveNode)
+					_Trace(k_BTE_ActiveNode, _o_ActiveNode, 0);
+				mo_LastActiveNode = _o_LastActiveNode;
+				mo_ActiveNode = _o_ActiveNode;
+			}
+			void BevAgentState::_Init()
+			{
+				memset(maui_DirtyStamp, 0, sizeof(maui_DirtyStamp));
+				D_CHECK(mui_Size > 0);
+				//没有原来的树时只能从初始内容恢复
+				D_CHECK(mo_Root || mab_InitialState);
+				if (!mab_Data)
+					mab_Data = new u8[mui_Size];
+				mpui_ConditionCache = reinterpret_cast<u32 *>(mab_Data + mui_ConditionCacheOffset);
+				Reset();
+			}
+			BevAgentState::~BevAgentState()
+			{
+				SetBlackboard(NULL);
+				if (mb_OwnData)
+					delete[] mab_Data;
+				mab_Data = NULL;
+			}
+			void BevAgentState::Reset()
+			{
+				mo_ActiveNode = NULL;
+				mo_LastActiveNode = NULL;
+				mb_LastEvaluateResult = true;
+				if (mab_InitialState)
+				{
+					memcpy(mab_Data, mab_InitialState, mui_Size);
+					return;
+				}
+				memset(mab_Data, 0, mui_Size);
+				mo_Root->InitState(*this);
+			}
+			void BevAgentState::Rebind(const BevNode &_o_Root)
+			{
+				u32 size = _o_Root.GetTreeStateSize();
+				D_CHECK(size > 0);
+				if (mb_OwnData ? size != mui_Size : size > mui_Size)
+				{
+					if (mb_OwnData)
+						delete[] mab_Data;
+					mab_Data = new u8[size];
+					mb_OwnData = true;
+				}
+				mo_Root = &_o_Root;
+				mui_Size = size;
+				mui_ConditionCacheOffset = _o_Root.GetConditionCacheOffset();
+				mui_ConditionCacheCount = _o_Root.GetConditionCacheCount();
+				mui_RootWatchMask = _o_Root.GetWatchMask();
+				mb_RootWatchable = _o_Root.IsWatchable();
+				mab_InitialState = NULL;
+				mpui_ConditionCache = reinterpret_cast<u32 *>(mab_Data + mui_ConditionCacheOffset);
+				Reset();
+				//新树的条件依赖的key和旧树不一定一样
+				MarkDirtyMask(0xffffffff);
+			}
+			u32 BevAgentState::GetSize() const
+			{
+				return mui_Size;
+			}
+			void BevAgentState::_ResetConditionCache()
+			{
+				//代数用完了，从头开始，旧的槽位都清成过期
+				memset(mpui_ConditionCache, 0, mui_ConditionCacheCount * sizeof(u32));
+				mui_ConditionEpoch = 1;
+			}
+			void BevAgentState::SetBlackboard(BevBlackboard *_o_Blackboard)
+			{
+				if (_o_Blackboard == mo_Blackboard)
+					return;
+				if (mo_Blackboard)
+					mo_Blackboard->mo_Agent = NULL;
+				mo_Blackboard = _o_Blackboard;
+				if (mo_Blackboard)
+				{
+					D_CHECK(!mo_Blackboard->mo_Agent);
+					mo_Blackboard->mo_Agent = this;
+					//挂上之前写的值这个agent还没看到过
+					MarkDirtyMask(0xffffffff);
+				}
+			}
+			void BevAgentState::_ClearBlackboardChanges()
+			{
+				mo_Blackboard->ClearChanges();
+			}
+			void BevAgentState::MarkDirtyRefValues(const RefValueBase *const *_o_Values, u32 _ui_Count)
+			{
+				for (u32 i = 0; i < _ui_Count; ++i)
+				{
+					if (_o_Values[i]->IsDirty())
+						MarkDirty(*_o_Values[i]);
+				}
+			}
+			void BevNodePrecondition::_DoCheckEach(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+			{
+				for (u32 i = 0; i < _ui_Count; ++i)
+				{
+					u32 id = _ui_Indices[i];
+					_ab_Results[i] = _DoCheck(*_o_Agents[id], _o_Inputs[id]) ? 1 : 0;
+				}
+			}
+			u32 BevGetWatchKey(const RefValueBase &_o_Value)
+			{
+				return StringID::Hash(_o_Value.GetName());
+			}
+			u32 BevMakeNodeID(u32 _ui_ParentID, const char *_name)
+			{
+				return _ui_ParentID * 31 + StringID::Hash(_name);
+			}
+			//-------------------------------------------------------------------------------------
+			// BevNode
+			//-------------------------------------------------------------------------------------
+			void BevNode::_GrowChildNodeList()
+			{
+				int capacity = mi_ChildNodeCapacity > 0 ? mi_ChildNodeCapacity * 2 : k_BLimited_InlineChildNodeCnt;
+				if (capacity > k_BLimited_MaxChildNodeCnt)
+					capacity = k_BLimited_MaxChildNodeCnt;
+				_ResizeChildNodeList(capacity);
+			}
+			void BevNode::_ResizeChildNodeList(int capacity)
+			{
+				BevNode **aoChildNodeList;
+				if (mo_Arena)
+					aoChildNodeList = static_cast<BevNode **>(mo_Arena->Alloc(capacity * sizeof(BevNode *)));
+				else
+					aoChildNodeList = new BevNode *[capacity];
+				for (int i = 0; i < mul_ChildNodeCount; ++i)
+					aoChildNodeList[i] = mao_ChildNodeList[i];
+				//子类自带的和arena里的旧数组不用还
+				if (mb_ChildNodeListOnHeap)
+					delete[] mao_ChildNodeList;
+				mao_ChildNodeList = aoChildNodeList;
+				mi_ChildNodeCapacity = capacity;
+				mb_ChildNodeListOnHeap = mo_Arena == NULL;
+			}
+			namespace
+			{
+				//组合条件按操作数往下走，被引用（REF）的条件会绑定多次，Bind是幂等的
+				void _BindPreconditionBlackboard(const BevNodePrecondition *_o_Precondition, BevBlackboardLayout &_o_Layout)
+				{
+					_o_Precondition->BindBlackboard(_o_Layout);
+					const BevNodePrecondition *operand;
+					for (int i = 0; (operand = _o_Precondition->oGetOperand(i)) != NULL; ++i)
+						_BindPreconditionBlackboard(operand, _o_Layout);
+				}
+			}
+			void BevNode::BindBlackboard(BevBlackboardLayout &_o_Layout)
+			{
+				if (mo_NodePrecondition)
+					_BindPreconditionBlackboard(mo_NodePrecondition, _o_Layout);
+				_BindBlackboard(_o_Layout);
+				for (int i = 0; i < mul_ChildNodeCount; ++i)
+					mao_ChildNodeList[i]->BindBlackboard(_o_Layout);
+			}
 			//-------------------------------------------------------------------------------------
 			// BevNodePrioritySelector
 			//-------------------------------------------------------------------------------------
-			bool BevNodePrioritySelector::_DoEvaluate(const BevNodeInputParam &input)
+			bool BevNodePrioritySelector::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
 			{
-				mui_CurrentSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				State &s = _GetState<State>(state);
+				//上次的选择已经tick过（两个索引相等），前面标记过的孩子在mui_ObserveStamp时都不通过
+				if (mb_HasAbortChildren && _bCheckIndex(s.mui_LastSelectIndex) && s.mui_CurrentSelectIndex == s.mui_LastSelectIndex)
+				{
+					u32 running = s.mui_LastSelectIndex;
+					u32 observeCount = s.mui_ObserveCount;
+					u32 observeStamp = s.mui_ObserveStamp;
+					s.mui_ObserveStamp = state.GetEvaluateStamp();
+					//前面的孩子只有标记了k_BAF_LowerPriority、依赖的key变过的才检查
+					for (u32 i = 0; i < running; ++i)
+					{
+						BevNode *oBN = mao_ChildNodeList[i];
+						if (!(oBN->GetAbortFlags() & k_BAF_LowerPriority))
+							continue;
+						if (i < observeCount && oBN->IsWatchable() && !state.IsDirtySince(oBN->GetWatchMask(), observeStamp))
+							continue;
+						if (oBN->Evaluate(state, input))
+						{
+							s.mui_CurrentSelectIndex = i;
+							s.mui_ObserveCount = (u16)i;
+							if (s.mui_KnownFailCount > i)
+								s.mui_KnownFailCount = (u16)i;
+							return true;
+						}
+					}
+					BevNode *oBN = mao_ChildNodeList[running];
+					if ((oBN->GetAbortFlags() & k_BAF_Self) ? oBN->Evaluate(state, input) : oBN->EvaluateBody(state, input))
+					{
+						s.mui_CurrentSelectIndex = running;
+						s.mui_ObserveCount = (u16)running;
+						return true;
+					}
+					//正在运行的被中断了，按优先级重新选
+				}
+				return _EvaluateScan(state, input);
+			}
+			bool BevNodePrioritySelector::_EvaluateScan(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				State &s = _GetState<State>(state);
+				s.mui_CurrentSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				u32 knownFail = s.mui_KnownFailCount;
+				u32 knownStamp = s.mui_KnownFailStamp;
+				s.mui_KnownFailStamp = state.GetEvaluateStamp();
+				s.mui_ObserveStamp = s.mui_KnownFailStamp;
 				for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
 				{
 					BevNode *oBN = mao_ChildNodeList[i];
-					if (oBN->Evaluate(input))//如果有子节点的条件满足了直接返回，将当前的索引直到这
+					//上次就没通过，依赖的key也没变过，结果不会变
+					if (i < knownFail && oBN->IsWatchable() && !state.IsDirtySince(oBN->GetWatchMask(), knownStamp))
+						continue;
+					if (oBN->Evaluate(state, input))//如果有子节点的条件满足了直接返回，将当前的索引直到这
 					{
-						mui_CurrentSelectIndex = i;
+						s.mui_CurrentSelectIndex = i;
+						s.mui_KnownFailCount = (u16)i;
+						s.mui_ObserveCount = (u16)i;
 						return true;
 					}
 				}
+				s.mui_KnownFailCount = (u16)mul_ChildNodeCount;
+				s.mui_ObserveCount = (u16)mul_ChildNodeCount;
 				return false;
 			}
 
-			void BevNodePrioritySelector::_DoTransition(const BevNodeInputParam &input)
+			void BevNodePrioritySelector::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
 			{
-				if (_bCheckIndex(mui_LastSelectIndex))//检查越界
+				State &s = _GetState<State>(state);
+				if (_bCheckIndex(s.mui_LastSelectIndex))//检查越界
 				{
-					BevNode *oBN = mao_ChildNodeList[mui_LastSelectIndex];
-					oBN->Transition(input);
+					BevNode *oBN = mao_ChildNodeList[s.mui_LastSelectIndex];
+					oBN->Transition(state, input);
+					//转移会改掉孩子的状态，从它开始的评估结果不能再沿用
+					if (s.mui_KnownFailCount > s.mui_LastSelectIndex)
+						s.mui_KnownFailCount = s.mui_LastSelectIndex;
+					if (s.mui_ObserveCount > s.mui_LastSelectIndex)
+						s.mui_ObserveCount = s.mui_LastSelectIndex;
 				}
-				mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				s.mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
 			}
 
-			BevRunningStatus BevNodePrioritySelector::_DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+			BevRunningStatus BevNodePrioritySelector::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
 			{
+				State &s = _GetState<State>(state);
 				BevRunningStatus bIsFinish = k_BRS_Finish;
-				if (_bCheckIndex(mui_CurrentSelectIndex))	//检查当前选择的是否越界
+				if (_bCheckIndex(s.mui_CurrentSelectIndex))	//检查当前选择的是否越界
 				{
-					if (mui_LastSelectIndex != mui_CurrentSelectIndex) //新的选择结果
+					if (s.mui_LastSelectIndex != s.mui_CurrentSelectIndex) //新的选择结果
 					{
-						if (_bCheckIndex(mui_LastSelectIndex)) //检查上一个索引是否越界
+						if (_bCheckIndex(s.mui_LastSelectIndex)) //检查上一个索引是否越界
 						{
-							BevNode *oBN = mao_ChildNodeList[mui_LastSelectIndex];
-							oBN->Transition(input); //we need transition
+							BevNode *oBN = mao_ChildNodeList[s.mui_LastSelectIndex];
+							oBN->Transition(state, input); //we need transition
+							if (s.mui_KnownFailCount > s.mui_LastSelectIndex)
+								s.mui_KnownFailCount = s.mui_LastSelectIndex;
+							if (s.mui_ObserveCount > s.mui_LastSelectIndex)
+								s.mui_ObserveCount = s.mui_LastSelectIndex;
 						}
 						//这个语句使得当切换完成后，用mui_LastSelectIndex来保存mui_CurrentSelectIndex的值，继续运行下面的代码才有意义
 						//这样能保证LastSelectIndex在切换后，LastSelectIndex记录的一定是当前正在运行的节点
-						mui_LastSelectIndex = mui_CurrentSelectIndex;
+						s.mui_LastSelectIndex = s.mui_CurrentSelectIndex;
 					}
 				}
-				if (_bCheckIndex(mui_LastSelectIndex))	//检查上一个选择结果是否越界（其实就是正在运行的节点）
+				if (_bCheckIndex(s.mui_LastSelectIndex))	//检查上一个选择结果是否越界（其实就是正在运行的节点）
 				{
 					//每一帧运行的代码是在这个部分。
-					BevNode *oBN = mao_ChildNodeList[mui_LastSelectIndex];
-					bIsFinish = oBN->Tick(input, output);
+					BevNode *oBN = mao_ChildNodeList[s.mui_LastSelectIndex];
+					bIsFinish = oBN->Tick(state, input, output);
 					//如果完成了那就清除变量。
 					if (bIsFinish)
-						mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
+						s.mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
 				}
 				return bIsFinish;
 			}
 			//-------------------------------------------------------------------------------------
 			// BevNodeNonePrioritySelector
 			//-------------------------------------------------------------------------------------
-			bool BevNodeNonePrioritySelector::_DoEvaluate(const BevNodeInputParam &input)
+			bool BevNodeNonePrioritySelector::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
 			{
-				if (_bCheckIndex(mui_CurrentSelectIndex))
+				State &s = _GetState<State>(state);
+				if (_bCheckIndex(s.mui_CurrentSelectIndex))
 				{
-					BevNode *oBN = mao_ChildNodeList[mui_CurrentSelectIndex];
-					if (oBN->Evaluate(input))
+					BevNode *oBN = mao_ChildNodeList[s.mui_CurrentSelectIndex];
+					if (oBN->Evaluate(state, input))
 					{
 						return true;
 					}
 				}
-				return BevNodePrioritySelector::_DoEvaluate(input);
+				return _EvaluateScan(state, input);
 			}
 			//-------------------------------------------------------------------------------------
 			// BevNodeSequence
 			//-------------------------------------------------------------------------------------
-			bool BevNodeSequence::_DoEvaluate(const BevNodeInputParam &input)
+			bool BevNodeSequence::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
 			{
+				State &s = _GetState<State>(state);
 				unsigned int testNode;
-				if (mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex)
+				if (s.mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex)
 					testNode = 0;
 				else
-					testNode = mui_CurrentNodeIndex;
+					testNode = s.mui_CurrentNodeIndex;
 
 				if (_bCheckIndex(testNode))
 				{
 					BevNode *oBN = mao_ChildNodeList[testNode];
-					if (oBN->Evaluate(input))
+					if (oBN->Evaluate(state, input))
 						return true;
 				}
 				return false;
 			}
-			void BevNodeSequence::_DoTransition(const BevNodeInputParam &input)
+			void BevNodeSequence::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
 			{
-				if (_bCheckIndex(mui_CurrentNodeIndex))
+				State &s = _GetState<State>(state);
+				if (_bCheckIndex(s.mui_CurrentNodeIndex))
 				{
-					BevNode *oBN = mao_ChildNodeList[mui_CurrentNodeIndex];
-					oBN->Transition(input);
+					BevNode *oBN = mao_ChildNodeList[s.mui_CurrentNodeIndex];
+					oBN->Transition(state, input);
 				}
-				mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+				s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
 			}
-			BevRunningStatus BevNodeSequence::_DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+			BevRunningStatus BevNodeSequence::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
 			{
+				State &s = _GetState<State>(state);
 				BevRunningStatus bIsFinish = k_BRS_Finish;
 
 				//First Time
-				if (mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex)
-					mui_CurrentNodeIndex = 0;
+				if (s.mui_CurrentNodeIndex == k_BLimited_InvalidChildNodeIndex)
+					s.mui_CurrentNodeIndex = 0;
 
-				BevNode *oBN = mao_ChildNodeList[mui_CurrentNodeIndex];
-				bIsFinish = oBN->Tick(input, output);
+				BevNode *oBN = mao_ChildNodeList[s.mui_CurrentNodeIndex];
+				bIsFinish = oBN->Tick(state, input, output);
 				if (bIsFinish == k_BRS_Finish)
 				{
-					++mui_CurrentNodeIndex;
+					++s.mui_CurrentNodeIndex;
 					//sequence is over
-					if (mui_CurrentNodeIndex == mul_ChildNodeCount)
+					if (s.mui_CurrentNodeIndex == mul_ChildNodeCount)
 					{
-						mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+						s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
 					}
 					else
 					{
@@ -130,7 +434,7 @@ namespace TsiU
 				}
 				if (bIsFinish < 0)
 				{
-					mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+					s.mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
 				}
 				return bIsFinish;
 			}
@@ -138,58 +442,97 @@ namespace TsiU
 			//-------------------------------------------------------------------------------------
 			// BevNodeTerminal
 			//-------------------------------------------------------------------------------------
-			void BevNodeTerminal::_DoTransition(const BevNodeInputParam &input)
+			void BevNodeTerminal::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
 			{
-				if (mb_NeedExit) //call Exit if we have called Enter
-					_DoExit(input, k_BRS_ERROR_Transition);
+				State &s = _GetState<State>(state);
+				if (s.mb_NeedExit) //call Exit if we have called Enter
+				{
+					_DoExit(state, input, k_BRS_ERROR_Transition);
+					state.Trace(k_BTE_Exit, this, k_BRS_ERROR_Transition);
+				}
 
-				SetActiveNode(NULL);
-				me_Status = k_TNS_Ready;
-				mb_NeedExit = false;
+				state.SetActiveNode(NULL);
+				s.me_Status = k_TNS_Ready;
+				s.mb_NeedExit = false;
 			}
-			BevRunningStatus BevNodeTerminal::_DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+			BevRunningStatus BevNodeTerminal::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
 			{
+				State &s = _GetState<State>(state);
 				BevRunningStatus bIsFinish = k_BRS_Finish;
 				//如果状态是初始状态，那就需要退出，同时将这个节点设为活跃节点
-				if (me_Status == k_TNS_Ready)
+				if (s.me_Status == k_TNS_Ready)
 				{
-					_DoEnter(input);
-					mb_NeedExit = true;
-					me_Status = k_TNS_Running;
-					SetActiveNode(this);
+					_DoEnter(state, input);
+					state.Trace(k_BTE_Enter, this, 0);
+					s.mb_NeedExit = true;
+					s.me_Status = k_TNS_Running;
+					state.SetActiveNode(this);
 				}
 				//如果是运行状态，就执行行为节点的逻辑，接收是否结束。
-				if (me_Status == k_TNS_Running)
+				if (s.me_Status == k_TNS_Running)
 				{
-					bIsFinish = _DoExecute(input, output);
-					SetActiveNode(this);
+					bIsFinish = _DoExecute(state, input, output);
+					state.Trace(k_BTE_Execute, this, bIsFinish);
+					state.SetActiveNode(this);
 					if (bIsFinish == k_BRS_Finish || bIsFinish == k_BRS_ERROR_Transition)
-						me_Status = k_TNS_Finish;
+						s.me_Status = k_TNS_Finish;
 				}
 				//如果是结束状态，那就初始化，返回结束
-				if (me_Status == k_TNS_Finish)
+				if (s.me_Status == k_TNS_Finish)
 				{
-					if (mb_NeedExit) //call Exit if we have called Enter
-						_DoExit(input, bIsFinish);
+					if (s.mb_NeedExit) //call Exit if we have called Enter
+					{
+						_DoExit(state, input, bIsFinish);
+						state.Trace(k_BTE_Exit, this, bIsFinish);
+					}
 
-					me_Status = k_TNS_Ready;
-					mb_NeedExit = false;
-					SetActiveNode(NULL);
+					s.me_Status = k_TNS_Ready;
+					s.mb_NeedExit = false;
+					state.SetActiveNode(NULL);
 				}
 				return bIsFinish;
 			}
 
+			//-------------------------------------------------------------------------------------
+			// BevNodeCoroutine
+			//-------------------------------------------------------------------------------------
+			BevRunningStatus BevNodeCoroutine::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				//重新进入节点时从头开始，子类的_DoEnter/_DoExit不用管恢复点
+				if (_GetState<State>(state).me_Status == k_TNS_Ready)
+					memset(&_GetCoroutineState(state), 0, _GetUserStateSize());
+				return BevNodeTerminal::_DoTick(state, input, output);
+			}
+			BevRunningStatus BevNodeCoroutine::_DoExecute(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				BevCoroutineState &co = _GetCoroutineState(state);
+				if (co.mui_WaitFrames > 0)
+				{
+					--co.mui_WaitFrames;
+					return k_BRS_Executing;
+				}
+				if (co.mf_WaitSeconds > 0)
+				{
+					co.mf_WaitSeconds -= state.GetDeltaTime();
+					if (co.mf_WaitSeconds > 0)
+						return k_BRS_Executing;
+					co.mf_WaitSeconds = 0;
+				}
+				return _DoResume(co, state, input, output);
+			}
+
 			//-------------------------------------------------------------------------------------
 			// BevNodeParallel
 			//-------------------------------------------------------------------------------------
-			bool BevNodeParallel::_DoEvaluate(const BevNodeInputParam &input)
+			bool BevNodeParallel::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
 			{
+				s8 *abChildNodeStatus = &_GetState<s8>(state);
 				for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
 				{
 					BevNode *oBN = mao_ChildNodeList[i];
-					if (mab_ChildNodeStatus[i] == 0)
+					if (abChildNodeStatus[i] == 0)
 					{
-						if (!oBN->Evaluate(input))
+						if (!oBN->Evaluate(state, input))
 						{
 							return false;
 						}
@@ -197,15 +540,14 @@ namespace TsiU
 				}
 				return true;
 			}
-			void BevNodeParallel::_DoTransition(const BevNodeInputParam &input)
+			void BevNodeParallel::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
 			{
-				for (unsigned int i = 0; i < k_BLimited_MaxChildNodeCnt; ++i)
-					mab_ChildNodeStatus[i] = k_BRS_Executing;
+				_ResetChildNodeStatus(&_GetState<s8>(state));
 
 				for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
 				{
 					BevNode *oBN = mao_ChildNodeList[i];
-					oBN->Transition(input);
+					oBN->Transition(state, input);
 				}
 			}
 			BevNodeParallel &BevNodeParallel::SetFinishCondition(E_ParallelFinishCondition _e_Condition)
@@ -213,32 +555,35 @@ namespace TsiU
 				me_FinishCondition = _e_Condition;
 				return (*this);
 			}
-			BevRunningStatus BevNodeParallel::_DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+			BevRunningStatus BevNodeParallel::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
 			{
+				if (mo_JobPool && mul_ChildNodeCount > 1)
+					return _DoTickConcurrent(state, input, output);
+
+				s8 *abChildNodeStatus = &_GetState<s8>(state);
 				unsigned int finishedChildCount = 0;
 				for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
 				{
 					BevNode *oBN = mao_ChildNodeList[i];
 					if (me_FinishCondition == k_PFC_OR)
 					{
-						if (mab_ChildNodeStatus[i] == k_BRS_Executing)
+						if (abChildNodeStatus[i] == k_BRS_Executing)
 						{
-							mab_ChildNodeStatus[i] = oBN->Tick(input, output);
+							abChildNodeStatus[i] = (s8)oBN->Tick(state, input, output);
 						}
-						if (mab_ChildNodeStatus[i] != k_BRS_Executing)
+						if (abChildNodeStatus[i] != k_BRS_Executing)
 						{
-							for (unsigned int i = 0; i < k_BLimited_MaxChildNodeCnt; ++i)
-								mab_ChildNodeStatus[i] = k_BRS_Executing;
+							_ResetChildNodeStatus(abChildNodeStatus);
 							return k_BRS_Finish;
 						}
 					}
 					else if (me_FinishCondition == k_PFC_AND)
 					{
-						if (mab_ChildNodeStatus[i] == k_BRS_Executing)
+						if (abChildNodeStatus[i] == k_BRS_Executing)
 						{
-							mab_ChildNodeStatus[i] = oBN->Tick(input, output);
+							abChildNodeStatus[i] = (s8)oBN->Tick(state, input, output);
 						}
-						if (mab_ChildNodeStatus[i] != k_BRS_Executing)
+						if (abChildNodeStatus[i] != k_BRS_Executing)
 						{
 							finishedChildCount++;
 						}
@@ -251,8 +596,143 @@ namespace TsiU
 				}
 				if (finishedChildCount == mul_ChildNodeCount)
 				{
-					for (unsigned int i = 0; i < k_BLimited_MaxChildNodeCnt; ++i)
-						mab_ChildNodeStatus[i] = k_BRS_Executing;
+					_ResetChildNodeStatus(abChildNodeStatus);
+					return k_BRS_Finish;
+				}
+				return k_BRS_Executing;
+			}
+
+			//并发模式下一个孩子的一次Tick，活跃节点、标脏和黑板的写入记录先留在这里，Run结束后再合并
+			class BevNodeParallel::ChildJob : public IJob
+			{
+			public:
+				virtual void Execute()
+				{
+					//OR模式下已经有孩子结束了，还没开始的就不用做了
+					if (*mpi_Cancel)
+						return;
+					mo_Parallel->_TickChild(*this);
+				}
+
+			public:
+				const BevNodeParallel *mo_Parallel;
+				const BevNode *mo_Node;
+				BevAgentState *mo_State;
+				const BevNodeInputParam *mo_Input;
+				BevNodeOutputParam *mo_Output;
+				s8 *mp_Status;
+				volatile s32 *mpi_Cancel;
+				bool mb_CancelOnFinish;
+				//没挂黑板时是NULL
+				u32 *maui_Changed;
+				bool mb_Ran;
+				const BevNode *mo_ActiveNode;
+				const BevNode *mo_LastActiveNode;
+				u32 mui_DirtyMask;
+			};
+
+			void BevNodeParallel::_TickChild(ChildJob &_o_Job) const
+			{
+				BevAgentState &state = *_o_Job.mo_State;
+				//黑板的分身要比agent的分身后析构，析构时agent的分身会把自己从黑板上取下来
+				if (_o_Job.maui_Changed)
+				{
+					BevBlackboard oForkBlackboard(state.oGetBlackboard(), _o_Job.maui_Changed);
+					BevAgentState oFork(state, &oForkBlackboard);
+					_TickFork(_o_Job, oFork);
+				}
+				else
+				{
+					BevAgentState oFork(state, NULL);
+					_TickFork(_o_Job, oFork);
+				}
+			}
+			void BevNodeParallel::_TickFork(ChildJob &_o_Job, BevAgentState &_o_Fork) const
+			{
+				BevRunningStatus status = _o_Job.mo_Node->Tick(_o_Fork, *_o_Job.mo_Input, *_o_Job.mo_Output);
+				*_o_Job.mp_Status = (s8)status;
+				_o_Job.mb_Ran = true;
+				_o_Job.mo_ActiveNode = _o_Fork.mo_ActiveNode;
+				_o_Job.mo_LastActiveNode = _o_Fork.mo_LastActiveNode;
+				_o_Job.mui_DirtyMask = _o_Fork._GetDirtyMaskSince(*_o_Job.mo_State);
+				if (_o_Job.mb_CancelOnFinish && status != k_BRS_Executing)
+					AtomicExchange(_o_Job.mpi_Cancel, 1);
+			}
+
+			BevRunningStatus BevNodeParallel::_DoTickConcurrent(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				s8 *abChildNodeStatus = &_GetState<s8>(state);
+				//孩子不多的时候任务和写入记录放在栈上，多了再去堆上申请
+				const u32 kInlineJobCount = 16;
+				const u32 kInlineChangeWordCount = 4;
+				ChildJob aoInlineJobs[kInlineJobCount];
+				IJob *aoInlineJobList[kInlineJobCount];
+				u32 aiInlineChanged[kInlineJobCount * kInlineChangeWordCount];
+				std::vector<ChildJob> aoHeapJobs;
+				std::vector<IJob *> aoHeapJobList;
+				std::vector<u32> aiHeapChanged;
+				ChildJob *aoJobs = aoInlineJobs;
+				IJob **aoJobList = aoInlineJobList;
+				u32 *aiChanged = aiInlineChanged;
+				if ((u32)mul_ChildNodeCount > kInlineJobCount)
+				{
+					aoHeapJobs.resize(mul_ChildNodeCount);
+					aoHeapJobList.resize(mul_ChildNodeCount);
+					aoJobs = &aoHeapJobs[0];
+					aoJobList = &aoHeapJobList[0];
+				}
+				BevBlackboard *oBlackboard = state.HasBlackboard() ? &state.oGetBlackboard() : NULL;
+				u32 changeWordCount = oBlackboard ? oBlackboard->oGetLayout().GetChangeWordCount() : 0;
+				if ((u32)mul_ChildNodeCount * changeWordCount > kInlineJobCount * kInlineChangeWordCount)
+				{
+					aiHeapChanged.resize(mul_ChildNodeCount * changeWordCount);
+					aiChanged = &aiHeapChanged[0];
+				}
+				volatile s32 iCancel = 0;
+				u32 jobCount = 0;
+				for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
+				{
+					if (abChildNodeStatus[i] != k_BRS_Executing)
+						continue;
+					ChildJob &job = aoJobs[jobCount];
+					job.mo_Parallel = this;
+					job.mo_Node = mao_ChildNodeList[i];
+					job.mo_State = &state;
+					job.mo_Input = &input;
+					job.mo_Output = &output;
+					job.mp_Status = &abChildNodeStatus[i];
+					job.mpi_Cancel = &iCancel;
+					job.mb_CancelOnFinish = me_FinishCondition == k_PFC_OR;
+					job.maui_Changed = oBlackboard ? aiChanged + jobCount * changeWordCount : NULL;
+					job.mb_Ran = false;
+					aoJobList[jobCount++] = &job;
+				}
+				mo_JobPool->Run(aoJobList, jobCount);
+
+				//按孩子的顺序合并各个分身，结果和线程怎么排的无关
+				for (u32 i = 0; i < jobCount; ++i)
+				{
+					const ChildJob &job = aoJobs[i];
+					if (!job.mb_Ran)
+						continue;
+					if (job.mo_ActiveNode != state.mo_ActiveNode || job.mo_LastActiveNode != state.mo_LastActiveNode)
+						state._MergeActiveNode(job.mo_ActiveNode, job.mo_LastActiveNode);
+					if (job.mui_DirtyMask)
+						state.MarkDirtyMask(job.mui_DirtyMask);
+					if (oBlackboard)
+						oBlackboard->_MergeChanges(job.maui_Changed);
+				}
+
+				//所有孩子都结束以后再判断完成条件
+				unsigned int finishedChildCount = 0;
+				for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
+				{
+					if (abChildNodeStatus[i] != k_BRS_Executing)
+						finishedChildCount++;
+				}
+				if ((me_FinishCondition == k_PFC_OR && finishedChildCount > 0) || finishedChildCount == mul_ChildNodeCount)
+				{
+					_ResetChildNodeStatus(abChildNodeStatus);
 					return k_BRS_Finish;
 				}
 				return k_BRS_Executing;
@@ -260,10 +740,11 @@ namespace TsiU
 			//-------------------------------------------------------------------------------------
 			// BevNodeLoop
 			//-------------------------------------------------------------------------------------
-			bool BevNodeLoop::_DoEvaluate(const BevNodeInputParam &input)
+			bool BevNodeLoop::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
 			{
+				State &s = _GetState<State>(state);
 				bool checkLoopCount = (mi_LoopCount == kInfiniteLoop) ||
-									  mi_CurrentCount < mi_LoopCount;
+									  s.mi_CurrentCount < mi_LoopCount;
 
 				if (!checkLoopCount)
 					return false;
@@ -271,34 +752,35 @@ namespace TsiU
 				if (_bCheckIndex(0))
 				{
 					BevNode *oBN = mao_ChildNodeList[0];
-					if (oBN->Evaluate(input))
+					if (oBN->Evaluate(state, input))
 						return true;
 				}
 				return false;
 			}
-			void BevNodeLoop::_DoTransition(const BevNodeInputParam &input)
+			void BevNodeLoop::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
 			{
 				if (_bCheckIndex(0))
 				{
 					BevNode *oBN = mao_ChildNodeList[0];
-					oBN->Transition(input);
+					oBN->Transition(state, input);
 				}
-				mi_CurrentCount = 0;
+				_GetState<State>(state).mi_CurrentCount = 0;
 			}
-			BevRunningStatus BevNodeLoop::_DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+			BevRunningStatus BevNodeLoop::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
 			{
+				State &s = _GetState<State>(state);
 				BevRunningStatus bIsFinish = k_BRS_Finish;
 				if (_bCheckIndex(0))
 				{
 					BevNode *oBN = mao_ChildNodeList[0];
-					bIsFinish = oBN->Tick(input, output);
+					bIsFinish = oBN->Tick(state, input, output);
 
 					if (bIsFinish == k_BRS_Finish)
 					{
 						if (mi_LoopCount != kInfiniteLoop)
 						{
-							mi_CurrentCount++;
-							if (mi_CurrentCount < mi_LoopCount)
+							s.mi_CurrentCount++;
+							if (s.mi_CurrentCount < mi_LoopCount)
 							{
 								bIsFinish = k_BRS_Executing;
 							}
@@ -311,10 +793,138 @@ namespace TsiU
 				}
 				if (bIsFinish)
 				{
-					mi_CurrentCount = 0;
+					s.mi_CurrentCount = 0;
+				}
+				return bIsFinish;
+			}
+			//-------------------------------------------------------------------------------------
+			// BevNodeDecorator
+			//-------------------------------------------------------------------------------------
+			bool BevNodeDecorator::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				const BevNode *oBN = _oGetChild();
+				return oBN == NULL || oBN->Evaluate(state, input);
+			}
+			void BevNodeDecorator::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				const BevNode *oBN = _oGetChild();
+				if (oBN)
+					oBN->Transition(state, input);
+			}
+			//-------------------------------------------------------------------------------------
+			// BevNodeInverter
+			//-------------------------------------------------------------------------------------
+			BevRunningStatus BevNodeInverter::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				const BevNode *oBN = _oGetChild();
+				BevRunningStatus bIsFinish = oBN ? oBN->Tick(state, input, output) : k_BRS_Finish;
+				if (bIsFinish == k_BRS_Finish)
+					return k_BRS_ERROR_Transition;
+				if (bIsFinish == k_BRS_ERROR_Transition)
+					return k_BRS_Finish;
+				return bIsFinish;
+			}
+			//-------------------------------------------------------------------------------------
+			// BevNodeRetry
+			//-------------------------------------------------------------------------------------
+			void BevNodeRetry::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevNodeDecorator::_DoTransition(state, input);
+				_GetState<State>(state).mi_FailCount = 0;
+			}
+			BevRunningStatus BevNodeRetry::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				State &s = _GetState<State>(state);
+				const BevNode *oBN = _oGetChild();
+				BevRunningStatus bIsFinish = oBN ? oBN->Tick(state, input, output) : k_BRS_Finish;
+				if (bIsFinish == k_BRS_ERROR_Transition)
+				{
+					//失败时孩子已经把自己的状态重置了，下一次tick从头开始
+					++s.mi_FailCount;
+					if (mi_MaxAttempts == kInfiniteRetry || s.mi_FailCount < mi_MaxAttempts)
+						return k_BRS_Executing;
 				}
+				if (bIsFinish != k_BRS_Executing)
+					s.mi_FailCount = 0;
 				return bIsFinish;
 			}
+			//-------------------------------------------------------------------------------------
+			// BevNodeCooldown
+			//-------------------------------------------------------------------------------------
+			bool BevNodeCooldown::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				const State &s = _GetState<State>(state);
+				//只在冷却中才读时钟
+				if (s.mb_Cooling && !s.mb_Running && state.GetTime() < s.mf_ReadyTime)
+					return false;
+				return BevNodeDecorator::_DoEvaluate(state, input);
+			}
+			void BevNodeCooldown::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevNodeDecorator::_DoTransition(state, input);
+				if (_GetState<State>(state).mb_Running)
+					_StartCooldown(state);
+			}
+			BevRunningStatus BevNodeCooldown::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				_GetState<State>(state).mb_Running = true;
+				const BevNode *oBN = _oGetChild();
+				BevRunningStatus bIsFinish = oBN ? oBN->Tick(state, input, output) : k_BRS_Finish;
+				if (bIsFinish != k_BRS_Executing)
+					_StartCooldown(state);
+				return bIsFinish;
+			}
+			void BevNodeCooldown::_StartCooldown(BevAgentState &state) const
+			{
+				State &s = _GetState<State>(state);
+				s.mf_ReadyTime = state.GetTime() + mf_Seconds;
+				s.mb_Cooling = true;
+				s.mb_Running = false;
+			}
+			//-------------------------------------------------------------------------------------
+			// BevNodeTimeout
+			//-------------------------------------------------------------------------------------
+			void BevNodeTimeout::_DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				BevNodeDecorator::_DoTransition(state, input);
+				_GetState<State>(state).mb_Running = false;
+			}
+			BevRunningStatus BevNodeTimeout::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				State &s = _GetState<State>(state);
+				f32 now = state.GetTime();
+				if (!s.mb_Running)
+				{
+					s.mf_StartTime = now;
+					s.mb_Running = true;
+				}
+				else if (now - s.mf_StartTime >= mf_Seconds)
+				{
+					//超时了：转移掉孩子（会调用行为节点的_DoExit），按失败结束
+					BevNodeDecorator::_DoTransition(state, input);
+					s.mb_Running = false;
+					return k_BRS_ERROR_Transition;
+				}
+				const BevNode *oBN = _oGetChild();
+				BevRunningStatus bIsFinish = oBN ? oBN->Tick(state, input, output) : k_BRS_Finish;
+				if (bIsFinish != k_BRS_Executing)
+					s.mb_Running = false;
+				return bIsFinish;
+			}
+			//-------------------------------------------------------------------------------------
+			// BevNodeRateLimit
+			//-------------------------------------------------------------------------------------
+			BevRunningStatus BevNodeRateLimit::_DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+			{
+				State &s = _GetState<State>(state);
+				f32 now = state.GetTime();
+				if (s.mb_Ticked && now < s.mf_NextTickTime)
+					return k_BRS_Executing;
+				s.mf_NextTickTime = now + mf_Interval;
+				s.mb_Ticked = true;
+				const BevNode *oBN = _oGetChild();
+				return oBN ? oBN->Tick(state, input, output) : k_BRS_Finish;
+			}
 		}
 	}
-}
\ No newline at end of file
+}
@@ -2,17 +2,33 @@
 #define __TAI_BEVTREE_H__
 
 #include <string>
+#include <vector>
 #include "TUtility_AnyData.h"
+#include "TAI_BevTreeArena.h"
+#include "TAI_BevProfiler.h"
+#include "TAI_BevTrace.h"
 
 namespace TsiU
 {
+	class JobPool;
+	class ClockModule;
+
 	namespace AI
 	{
+		class RefValueBase;
+
 		namespace BehaviorTree
 		{
 
-#define k_BLimited_MaxChildNodeCnt 16
-#define k_BLimited_InvalidChildNodeIndex k_BLimited_MaxChildNodeCnt
+//孩子下标存在u16的状态里，0xffff留给无效下标
+#define k_BLimited_MaxChildNodeCnt 0xfffe
+#define k_BLimited_InvalidChildNodeIndex 0xffff
+//控制节点自带的孩子数组大小，超过了再换成arena或堆上的数组
+#define k_BLimited_InlineChildNodeCnt 4
+#define k_BLimited_StateAlignment 4
+#define k_BLimited_WatchKeyBits 32
+#define k_BLimited_InvalidCacheSlot 0xffffffff
+#define k_BLimited_MaxConditionEpoch 0x7fffffff
 
 			//并行完成条件判断
 			enum E_ParallelFinishCondition
@@ -40,33 +56,220 @@ namespace TsiU
 			typedef AnyData BevNodeInputParam;
 			typedef AnyData BevNodeOutputParam;
 
+			//key（黑板的key、RefValue名字的hash等）在脏标记里对应的位，不同的key可能落在同一位上，只会多评估不会漏评估
+			D_Inline u32 BevGetWatchBit(u32 _ui_Key)
+			{
+				return 1u << (_ui_Key % k_BLimited_WatchKeyBits);
+			}
+			//RefValue按名字算key
+			u32 BevGetWatchKey(const RefValueBase &_o_Value);
+			//没有显式设置ID的节点用父亲的ID和自己的名字算出ID
+			u32 BevMakeNodeID(u32 _ui_ParentID, const char *_name);
+
 			//---------------------------------------------------------------------------------------------------------------------------------
 
+			class BevAgentState;
+			class BevNode;
+			class BevBlackboard;
+			class BevBlackboardLayout;
+			class BevCompiledTree;
+			class BevPreconditionProgram;
+			class BevTreeFile;
+			class BevTreeImage;
+			class BevTreeReloader;
+
+			//前提条件类型，BevPreconditionProgram用它把组合条件展开成指令
+			enum E_BevPreconditionType
+			{
+				k_BPT_Leaf = 0,
+				k_BPT_TRUE,
+				k_BPT_FALSE,
+				k_BPT_NOT,
+				k_BPT_AND,
+				k_BPT_OR,
+				k_BPT_XOR,
+				k_BPT_REF,
+				k_BPT_FUNC,
+			};
+
+			//自定义的节点和前提条件要存进BevTreeFile的话，在类里写上这一句，按类名找回类型（不用RTTI）
+#define D_BevDeclareType(_Name)	public: static const char *StaticTypeName() { return #_Name; } virtual const char *GetTypeName() const { return #_Name; }
+
 			//前提条件类（虚类）
-			class BevNodePrecondition
+			class BevNodePrecondition : public BevArenaObject
 			{
+				friend class BevCompiledTree;
+				friend class BevPreconditionProgram;
+				friend class BevTreeFile;
+				friend class BevTreeImage;
+
 			public:
+				BevNodePrecondition()
+					: mui_WatchMask(0), mb_Watched(false), mui_CacheSlot(k_BLimited_InvalidCacheSlot), mo_CacheOwner(NULL), mb_Cacheable(true)
+				{
+				}
+				virtual ~BevNodePrecondition()
+				{
+				}
+
 				virtual bool ExternalCondition(const BevNodeInputParam &input) const = 0;
+
+				//批量求值，_ab_Results[i]对应_o_Inputs[_ui_Indices[i]]
+				//默认逐个调用ExternalCondition，子类可以重载成一次处理一整段agent
+				virtual void ExternalConditionBatch(const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					for (u32 i = 0; i < _ui_Count; ++i)
+						_ab_Results[i] = ExternalCondition(_o_Inputs[_ui_Indices[i]]) ? 1 : 0;
+				}
+
+				//声明这个条件只依赖这些key，key没有被标脏时可以沿用上次的结果；要在BuildStateLayout之前声明
+				//一个都没声明的条件被认为每帧都可能变化
+				BevNodePrecondition &WatchKey(u32 _ui_Key)
+				{
+					mui_WatchMask |= BevGetWatchBit(_ui_Key);
+					mb_Watched = true;
+					return (*this);
+				}
+				BevNodePrecondition &WatchRefValue(const RefValueBase &_o_Value)
+				{
+					return WatchKey(BevGetWatchKey(_o_Value));
+				}
+				//依赖的key的掩码，返回false表示不知道依赖什么
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
+				{
+					_ui_Mask = mui_WatchMask;
+					return mb_Watched;
+				}
+
+				//树里都通过它求值：同一个agent从根节点评估开始到下一次根节点评估之前，结果只算一次
+				bool Check(BevAgentState &state, const BevNodeInputParam &input) const;
+
+				//结果不只取决于input的条件（随机、计时、有副作用的）要关掉缓存，在BuildStateLayout之前设置
+				BevNodePrecondition &SetCacheable(bool _b_Cacheable)
+				{
+					mb_Cacheable = _b_Cacheable;
+					if (!mb_Cacheable)
+						mui_CacheSlot = k_BLimited_InvalidCacheSlot;
+					return (*this);
+				}
+				bool IsCacheable() const
+				{
+					return mb_Cacheable;
+				}
+
+				//用D_BevDeclareType声明过的类返回类名，保存成文件时按它找回类型
+				virtual const char *GetTypeName() const
+				{
+					return NULL;
+				}
+
+				//自定义的条件都是k_BPT_Leaf，组合条件通过oGetOperand取操作数
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_Leaf;
+				}
+				virtual const BevNodePrecondition *oGetOperand(int _i_Index) const
+				{
+					return NULL;
+				}
+
+				//BuildStateLayout时调用，给自己和子条件分配agent状态块里的缓存槽位，_o_Owner是这棵树的根节点
+				virtual void BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
+				{
+					_AssignCacheSlot(_o_Slots, _o_Owner);
+				}
+				//BevNode::BindBlackboard时调用，把用到的黑板key绑定到布局上；组合条件的操作数由树去遍历，不用在这里转发
+				virtual void BindBlackboard(BevBlackboardLayout &_o_Layout) const
+				{
+				}
+
+			protected:
+				//实际的求值，组合条件重载它去调用子条件的Check，让共用的子条件也能命中缓存
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					return ExternalCondition(input);
+				}
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					ExternalConditionBatch(_o_Inputs, _ui_Indices, _ui_Count, _ab_Results);
+				}
+				//逐个agent调用_DoCheck，给组合条件的_DoCheckBatch用
+				void _DoCheckEach(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const;
+
+				void _AssignCacheSlot(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
+				{
+					if (!mb_Cacheable)
+						return;
+					//两棵树通过REF引用了同一个条件，槽位只能按一棵树的布局编号，两边都不缓存
+					if (mo_CacheOwner && mo_CacheOwner != _o_Owner)
+					{
+						if (mui_CacheSlot != k_BLimited_InvalidCacheSlot)
+							D_Output("BevNodePrecondition: shared by two trees, its result won't be cached\n");
+						mui_CacheSlot = k_BLimited_InvalidCacheSlot;
+						mb_Cacheable = false;
+						return;
+					}
+					//同一个条件被多处引用时只分配一次
+					if (mui_CacheSlot < _o_Slots.size() && _o_Slots[mui_CacheSlot] == this)
+						return;
+					mo_CacheOwner = _o_Owner;
+					mui_CacheSlot = (u32)_o_Slots.size();
+					_o_Slots.push_back(this);
+				}
+
+			protected:
+				u32 mui_WatchMask;
+				bool mb_Watched;
+				mutable u32 mui_CacheSlot;
+				//分配槽位的树（根节点），共用的条件被另一棵树分配时关掉缓存
+				mutable const BevNode *mo_CacheOwner;
+				mutable bool mb_Cacheable;
 			};
 
 			//true
 			class BevNodePreconditionTRUE : public BevNodePrecondition
 			{
 			public:
+				BevNodePreconditionTRUE()
+				{
+					SetCacheable(false);
+				}
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_TRUE;
+				}
 				virtual bool ExternalCondition(const BevNodeInputParam &input) const
 				{
 					return true;
 				}
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
+				{
+					_ui_Mask = 0;
+					return true;
+				}
 			};
 
 			//false
 			class BevNodePreconditionFALSE : public BevNodePrecondition
 			{
 			public:
+				BevNodePreconditionFALSE()
+				{
+					SetCacheable(false);
+				}
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_FALSE;
+				}
 				virtual bool ExternalCondition(const BevNodeInputParam &input) const
 				{
 					return false;
 				}
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
+				{
+					_ui_Mask = 0;
+					return true;
+				}
 			};
 
 			//逻辑 非
@@ -86,6 +289,35 @@ namespace TsiU
 				{
 					return !m_lhs->ExternalCondition(input);
 				}
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_NOT;
+				}
+				virtual const BevNodePrecondition *oGetOperand(int _i_Index) const
+				{
+					return _i_Index == 0 ? m_lhs : NULL;
+				}
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
+				{
+					if (mb_Watched)
+						return BevNodePrecondition::GetWatchMask(_ui_Mask);
+					return m_lhs->GetWatchMask(_ui_Mask);
+				}
+				virtual void BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
+				{
+					_AssignCacheSlot(_o_Slots, _o_Owner);
+					m_lhs->BuildCacheSlots(_o_Slots, _o_Owner);
+				}
+
+			protected:
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					return !m_lhs->Check(state, input);
+				}
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					_DoCheckEach(_o_Agents, _o_Inputs, _ui_Indices, _ui_Count, _ab_Results);
+				}
 
 			private:
 				BevNodePrecondition *m_lhs;
@@ -109,6 +341,40 @@ namespace TsiU
 				{
 					return m_lhs->ExternalCondition(input) && m_rhs->ExternalCondition(input);
 				}
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_AND;
+				}
+				virtual const BevNodePrecondition *oGetOperand(int _i_Index) const
+				{
+					return _i_Index == 0 ? m_lhs : (_i_Index == 1 ? m_rhs : NULL);
+				}
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
+				{
+					if (mb_Watched)
+						return BevNodePrecondition::GetWatchMask(_ui_Mask);
+					u32 lhsMask, rhsMask;
+					bool bWatched = m_lhs->GetWatchMask(lhsMask);
+					bWatched = m_rhs->GetWatchMask(rhsMask) && bWatched;
+					_ui_Mask = lhsMask | rhsMask;
+					return bWatched;
+				}
+				virtual void BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
+				{
+					_AssignCacheSlot(_o_Slots, _o_Owner);
+					m_lhs->BuildCacheSlots(_o_Slots, _o_Owner);
+					m_rhs->BuildCacheSlots(_o_Slots, _o_Owner);
+				}
+
+			protected:
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					return m_lhs->Check(state, input) && m_rhs->Check(state, input);
+				}
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					_DoCheckEach(_o_Agents, _o_Inputs, _ui_Indices, _ui_Count, _ab_Results);
+				}
 
 			private:
 				BevNodePrecondition *m_lhs;
@@ -133,6 +399,40 @@ namespace TsiU
 				{
 					return m_lhs->ExternalCondition(input) || m_rhs->ExternalCondition(input);
 				}
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_OR;
+				}
+				virtual const BevNodePrecondition *oGetOperand(int _i_Index) const
+				{
+					return _i_Index == 0 ? m_lhs : (_i_Index == 1 ? m_rhs : NULL);
+				}
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
+				{
+					if (mb_Watched)
+						return BevNodePrecondition::GetWatchMask(_ui_Mask);
+					u32 lhsMask, rhsMask;
+					bool bWatched = m_lhs->GetWatchMask(lhsMask);
+					bWatched = m_rhs->GetWatchMask(rhsMask) && bWatched;
+					_ui_Mask = lhsMask | rhsMask;
+					return bWatched;
+				}
+				virtual void BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
+				{
+					_AssignCacheSlot(_o_Slots, _o_Owner);
+					m_lhs->BuildCacheSlots(_o_Slots, _o_Owner);
+					m_rhs->BuildCacheSlots(_o_Slots, _o_Owner);
+				}
+
+			protected:
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					return m_lhs->Check(state, input) || m_rhs->Check(state, input);
+				}
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					_DoCheckEach(_o_Agents, _o_Inputs, _ui_Indices, _ui_Count, _ab_Results);
+				}
 
 			private:
 				BevNodePrecondition *m_lhs;
@@ -157,231 +457,1063 @@ namespace TsiU
 				{
 					return m_lhs->ExternalCondition(input) ^ m_rhs->ExternalCondition(input);
 				}
-
-			private:
-				BevNodePrecondition *m_lhs;
-				BevNodePrecondition *m_rhs;
-			};
-			
-			//---------------------------------------------------------------------------------------------------------------------------------
-
-			//树节点基类
-			class BevNode
-			{
-			public:
-				BevNode(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodeScript = NULL)
-					: mul_ChildNodeCount(0), mz_DebugName("UNNAMED"), mo_ActiveNode(NULL), mo_LastActiveNode(NULL), mo_NodePrecondition(NULL)
+				virtual E_BevPreconditionType GetPreconditionType() const
 				{
-					for (int i = 0; i < k_BLimited_MaxChildNodeCnt; ++i)
-						mao_ChildNodeList[i] = NULL;
-
-					_SetParentNode(_o_ParentNode);
-					SetNodePrecondition(_o_NodeScript);
+					return k_BPT_XOR;
 				}
-
-				virtual ~BevNode()
+				virtual const BevNodePrecondition *oGetOperand(int _i_Index) const
 				{
-					for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
-					{
-						D_SafeDelete(mao_ChildNodeList[i]);
-					}
-					D_SafeDelete(mo_NodePrecondition);
+					return _i_Index == 0 ? m_lhs : (_i_Index == 1 ? m_rhs : NULL);
 				}
-				
-				//评估 先判断是否满足当前节点的前提条件，满足的话再去做 _DoEvaluate(这里用于调用子类的_DoEvaluate)
-				bool Evaluate(const BevNodeInputParam &input)
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
 				{
-					//&&前面的是控制节点本身的评估，后面的则会调用孩子的评估函数。
-					return (mo_NodePrecondition == NULL || mo_NodePrecondition->ExternalCondition(input)) && _DoEvaluate(input);
+					if (mb_Watched)
+						return BevNodePrecondition::GetWatchMask(_ui_Mask);
+					u32 lhsMask, rhsMask;
+					bool bWatched = m_lhs->GetWatchMask(lhsMask);
+					bWatched = m_rhs->GetWatchMask(rhsMask) && bWatched;
+					_ui_Mask = lhsMask | rhsMask;
+					return bWatched;
 				}
-				
-				//转移，从上一个可运行的节点切换到另一个节点的行为，如何取决于子类。
-				void Transition(const BevNodeInputParam &input)
+				virtual void BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
 				{
-					_DoTransition(input);
+					_AssignCacheSlot(_o_Slots, _o_Owner);
+					m_lhs->BuildCacheSlots(_o_Slots, _o_Owner);
+					m_rhs->BuildCacheSlots(_o_Slots, _o_Owner);
 				}
-				
-				//更新，传入数据到行为节点进行更新
-				BevRunningStatus Tick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+
+			protected:
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
 				{
-					return _DoTick(input, output);
+					return m_lhs->Check(state, input) ^ m_rhs->Check(state, input);
 				}
-				//---------------------------------------------------------------
-				
-				//添加孩子节点
-				BevNode &AddChildNode(BevNode *_o_ChildNode)
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
 				{
-					//越界判断
-					if (mul_ChildNodeCount == k_BLimited_MaxChildNodeCnt)
-					{
-						D_Output("The number of child nodes is up to 16");
-						D_CHECK(0);
-						return (*this);
-					}
-					mao_ChildNodeList[mul_ChildNodeCount] = _o_ChildNode;
-					++mul_ChildNodeCount;
-					return (*this);
+					_DoCheckEach(_o_Agents, _o_Inputs, _ui_Indices, _ui_Count, _ab_Results);
 				}
-				
-				//设置前提条件
-				BevNode &SetNodePrecondition(BevNodePrecondition *_o_NodePrecondition)
-				{
-					//如果传入的先决条件和现在的一样就不做任何操作。
-					if (mo_NodePrecondition != _o_NodePrecondition)
-					{
-						//如果本来就有先决条件，则先释放
-						if (mo_NodePrecondition)
-							delete mo_NodePrecondition;
 
-						mo_NodePrecondition = _o_NodePrecondition;
-					}
-					return (*this);
-				}
+			private:
+				BevNodePrecondition *m_lhs;
+				BevNodePrecondition *m_rhs;
+			};
 
-				//给节点设置名字
-				BevNode &SetDebugName(const char *_debugName)
-				{
-					mz_DebugName = _debugName;
-					return (*this);
-				}
-				
-				//获取上一个活跃的节点
-				const BevNode *oGetLastActiveNode() const
+			//引用别处的条件，不负责释放（被引用的条件要比树活得久）
+			//多个节点共用同一个子条件时用它，同一帧里子条件只算一次
+			class BevNodePreconditionREF : public BevNodePrecondition
+			{
+			public:
+				BevNodePreconditionREF(const BevNodePrecondition *target)
+					: m_target(target)
 				{
-					return mo_LastActiveNode;
+					D_CHECK(m_target);
+					//结果已经缓存在被引用的条件上
+					SetCacheable(false);
 				}
-
-				//设置活跃的节点为当前节点，同时更新父亲节点的活跃节点
-				void SetActiveNode(BevNode *_o_Node)
+				virtual bool ExternalCondition(const BevNodeInputParam &input) const
 				{
-					mo_LastActiveNode = mo_ActiveNode;
-					mo_ActiveNode = _o_Node;
-					if (mo_ParentNode != NULL)
-						mo_ParentNode->SetActiveNode(_o_Node);
+					return m_target->ExternalCondition(input);
 				}
-
-				//获取当前节点的名字
-				const char *GetDebugName() const
+				virtual E_BevPreconditionType GetPreconditionType() const
 				{
-					return mz_DebugName.c_str();
+					return k_BPT_REF;
 				}
-
-			protected:
-				//--------------------------------------------------------------
-				// virtual function 这一块由子类自己去完成，行为节点无需实现_DoEvaluate，需要自动返回true
-				//--------------------------------------------------------------
-				virtual bool _DoEvaluate(const BevNodeInputParam &input)
+				virtual const BevNodePrecondition *oGetOperand(int _i_Index) const
 				{
-					return true;
+					return _i_Index == 0 ? m_target : NULL;
 				}
-				virtual void _DoTransition(const BevNodeInputParam &input)
+				virtual bool GetWatchMask(u32 &_ui_Mask) const
 				{
+					return m_target->GetWatchMask(_ui_Mask);
 				}
-				virtual BevRunningStatus _DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output)
+				virtual void BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
 				{
-					return k_BRS_Finish;
+					m_target->BuildCacheSlots(_o_Slots, _o_Owner);
 				}
 
 			protected:
-				//设置父亲节点
-				void _SetParentNode(BevNode *_o_ParentNode)
+				virtual bool _DoCheck(BevAgentState &state, const BevNodeInputParam &input) const
 				{
-					mo_ParentNode = _o_ParentNode;
+					return m_target->Check(state, input);
 				}
-
-				//检查索引是否越界
-				bool _bCheckIndex(int _ui_Index) const
+				virtual void _DoCheckBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
 				{
-					return _ui_Index >= 0 && _ui_Index < mul_ChildNodeCount;
+					_DoCheckEach(_o_Agents, _o_Inputs, _ui_Indices, _ui_Count, _ab_Results);
 				}
 
-			protected:
-				//用来存放孩子节点
-				BevNode *mao_ChildNodeList[k_BLimited_MaxChildNodeCnt];
-				//记录孩子节点的数量
-				int mul_ChildNodeCount;
-				//记录父亲节点
-				BevNode *mo_ParentNode;
-				//记录当前活跃的节点
-				BevNode *mo_ActiveNode;
-				//记录上一个活跃的节点
-				BevNode *mo_LastActiveNode;
-				//前提条件
-				BevNodePrecondition *mo_NodePrecondition;
-				//名称
-				std::string mz_DebugName;
+			private:
+				const BevNodePrecondition *m_target;
 			};
-		
-			//有优先级的选择类型控制节点
-			class BevNodePrioritySelector : public BevNode
+
+			//普通函数做的条件，编译成BevPreconditionProgram以后直接调函数指针，不走虚函数
+			typedef bool (*BevPreconditionFunc)(const BevNodeInputParam &input);
+			class BevNodePreconditionFUNC : public BevNodePrecondition
 			{
 			public:
-
-				//传入父亲节点和前提条件，会调用基类的构造函数。将索引置都为16，即越界，为空
-				BevNodePrioritySelector(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
-					: BevNode(_o_ParentNode, _o_NodePrecondition), mui_LastSelectIndex(k_BLimited_InvalidChildNodeIndex), mui_CurrentSelectIndex(k_BLimited_InvalidChildNodeIndex)
+				BevNodePreconditionFUNC(BevPreconditionFunc func)
+					: m_func(func)
 				{
+					D_CHECK(m_func);
 				}
-				
-				//控制节点做评估的地方，会一直往下递推下去，直到找到第一个满足所有条件的行为节点。
-				virtual bool _DoEvaluate(const BevNodeInputParam &input);
-
-				//先检查越界，再切换到上一个行为，直到切换到没有上一个行为的节点
-				virtual void _DoTransition(const BevNodeInputParam &input);
-
-				//更新函数
-				virtual BevRunningStatus _DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output);
-
-			protected:
-				//当前选择的索引
-				int mui_CurrentSelectIndex;
-				//上一个选择的索引
-				int mui_LastSelectIndex;
-			};
-
-			class BevNodeNonePrioritySelector : public BevNodePrioritySelector
-			{
-			public:
-				BevNodeNonePrioritySelector(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
-					: BevNodePrioritySelector(_o_ParentNode, _o_NodePrecondition)
+				virtual bool ExternalCondition(const BevNodeInputParam &input) const
 				{
+					return m_func(input);
 				}
-				virtual bool _DoEvaluate(const BevNodeInputParam &input);
-			};
-
-			class BevNodeSequence : public BevNode
-			{
-			public:
-				BevNodeSequence(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
-					: BevNode(_o_ParentNode, _o_NodePrecondition), mui_CurrentNodeIndex(k_BLimited_InvalidChildNodeIndex)
+				virtual E_BevPreconditionType GetPreconditionType() const
+				{
+					return k_BPT_FUNC;
+				}
+				BevPreconditionFunc GetFunc() const
 				{
+					return m_func;
 				}
-				virtual bool _DoEvaluate(const BevNodeInputParam &input);
-				virtual void _DoTransition(const BevNodeInputParam &input);
-				virtual BevRunningStatus _DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output);
 
 			private:
-				int mui_CurrentNodeIndex;
+				BevPreconditionFunc m_func;
 			};
+			
+			//---------------------------------------------------------------------------------------------------------------------------------
 
-			class BevNodeParallel : public BevNode
+			class BevNode;
+
+			//节点类型，BevCompiledTree用它来代替虚函数分发
+			enum E_BevNodeType
 			{
-			public:
+				k_BNT_Custom = 0,
+				k_BNT_PrioritySelector,
+				k_BNT_NonePrioritySelector,
+				k_BNT_Sequence,
+				k_BNT_Parallel,
+				k_BNT_Loop,
+				k_BNT_Terminal,
+			};
+
+			//观察者中断：挂在有优先级的选择节点的孩子上，孩子正在运行时只靠标记过的条件打断它
+			enum E_BevAbortFlag
+			{
+				k_BAF_None = 0,
+				//自己正在运行时每帧重新检查前提条件，不满足就中断；没有这个标记时前提条件只在进入时检查
+				k_BAF_Self = 1 << 0,
+				//后面优先级低的孩子正在运行时，依赖的key变了才检查自己，满足就抢过来
+				k_BAF_LowerPriority = 1 << 1,
+				k_BAF_Both = k_BAF_Self | k_BAF_LowerPriority,
+			};
+
+			//内置控制节点在agent状态块里的数据，BevCompiledTree和节点类共用同一份布局
+			struct BevSelectorState
+			{
+				//当前选择的索引
+				u16 mui_CurrentSelectIndex;
+				//上一个选择的索引
+				u16 mui_LastSelectIndex;
+				//前面这么多个孩子在第mui_KnownFailStamp次评估时都没通过，之后依赖的key没变脏就不用再评估
+				u16 mui_KnownFailCount;
+				//有中断标记的孩子时，前面这么多个孩子里标记过的在第mui_ObserveStamp次评估时都没通过
+				u16 mui_ObserveCount;
+				u32 mui_KnownFailStamp;
+				u32 mui_ObserveStamp;
+			};
+			struct BevSequenceState
+			{
+				u16 mui_CurrentNodeIndex;
+			};
+			struct BevLoopState
+			{
+				s32 mi_CurrentCount;
+			};
+			//并行节点的状态是每个孩子一个s8的BevRunningStatus
+
+			//计时的装饰节点读的时钟，单位是秒，只要求不减
+			class BevClock
+			{
+			public:
+				virtual ~BevClock() {}
+				virtual f32 GetSeconds() const = 0;
+
+				//没有给agent单独设置时钟时用这个，一般启动时设成一个BevEngineClock
+				static void SetDefault(const BevClock *_o_Clock);
+				static const BevClock *oGetDefault();
+
+			private:
+				static const BevClock *ms_Default;
+			};
+			//引擎的ClockModule::GetTotalElapsedSeconds
+			class BevEngineClock : public BevClock
+			{
+			public:
+				explicit BevEngineClock(const ClockModule &_o_Clock)
+					: mo_Clock(&_o_Clock)
+				{
+				}
+				virtual f32 GetSeconds() const;
+
+			private:
+				const ClockModule *mo_Clock;
+			};
+			//手动推进的时钟，回放、工具和单独驱动树的时候用
+			class BevManualClock : public BevClock
+			{
+			public:
+				BevManualClock()
+					: mf_Seconds(0)
+				{
+				}
+				virtual f32 GetSeconds() const
+				{
+					return mf_Seconds;
+				}
+				void SetSeconds(f32 _f_Seconds)
+				{
+					mf_Seconds = _f_Seconds;
+				}
+				void Advance(f32 _f_DeltaTime)
+				{
+					mf_Seconds += _f_DeltaTime;
+				}
+
+			private:
+				f32 mf_Seconds;
+			};
+
+			//agent的运行时状态块。树的定义（BevNode）是只读的，同一原型的所有agent共享一棵树，
+			//每个agent只持有这一小块内存，各节点的状态按BuildStateLayout分配的偏移存放在里面
+			class BevAgentState
+			{
+				friend class BevNodeParallel;
+
+			public:
+				//自己分配状态内存
+				BevAgentState(const BevNode &_o_Root);
+				//使用外部内存（大小至少为_o_Root.GetTreeStateSize()），不负责释放
+				BevAgentState(const BevNode &_o_Root, void *_p_Memory);
+				//按编译后的树的布局分配，BevTreeImage里的树没有原来的根节点，只能用这两个
+				BevAgentState(const BevCompiledTree &_o_Tree);
+				BevAgentState(const BevCompiledTree &_o_Tree, void *_p_Memory);
+				~BevAgentState();
+
+				//把所有节点的状态恢复成初始值，不会调用_DoExit
+				void Reset();
+				//换到另一棵树上，状态按新树重新初始化（不会调用_DoExit），所有key都算作脏了
+				//外部内存放不下新树的状态时改为自己分配；要保留正在运行的状态用BevTreeReloader
+				void Rebind(const BevNode &_o_Root);
+
+				const BevNode &oGetRoot() const
+				{
+					D_CHECK(mo_Root);
+					return *mo_Root;
+				}
+				//是不是这个根节点的状态，没有原来的树时根节点是NULL
+				bool IsRoot(const BevNode *_o_Root) const
+				{
+					return mo_Root == _o_Root;
+				}
+				u8 *GetData()
+				{
+					return mab_Data;
+				}
+				const u8 *GetData() const
+				{
+					return mab_Data;
+				}
+				u32 GetSize() const;
+
+				//获取当前活跃的行为节点
+				const BevNode *oGetActiveNode() const
+				{
+					return mo_ActiveNode;
+				}
+				//获取上一个活跃的行为节点
+				const BevNode *oGetLastActiveNode() const
+				{
+					return mo_LastActiveNode;
+				}
+				//设置活跃的行为节点
+				void SetActiveNode(const BevNode *_o_Node)
+				{
+					if (mo_Trace && _o_Node != mo_ActiveNode)
+						_Trace(k_BTE_ActiveNode, _o_Node, 0);
+					mo_LastActiveNode = mo_ActiveNode;
+					mo_ActiveNode = _o_Node;
+				}
+				//挂上执行轨迹，之后的记录都带着_ui_AgentID，传NULL取下来；要重放的话在第一次评估之前挂上
+				void SetTrace(BevTraceRecorder *_o_Recorder, u32 _ui_AgentID)
+				{
+					mo_Trace = _o_Recorder;
+					mui_TraceAgentID = _ui_AgentID;
+				}
+				BevTraceRecorder *oGetTrace() const
+				{
+					return mo_Trace;
+				}
+				//没挂执行轨迹时什么都不做
+				void Trace(E_BevTraceEvent _e_Event, const BevNode *_o_Node, s32 _i_Value)
+				{
+					if (mo_Trace)
+						_Trace(_e_Event, _o_Node, _i_Value);
+				}
+				//挂上黑板（不负责释放），黑板的布局要和树绑定的是同一个；一块黑板只能挂在一个agent上
+				//之后黑板上的写入会标这个agent的脏，传NULL取下来
+				void SetBlackboard(BevBlackboard *_o_Blackboard);
+				bool HasBlackboard() const
+				{
+					return mo_Blackboard != NULL;
+				}
+				BevBlackboard &oGetBlackboard() const
+				{
+					D_CHECK(mo_Blackboard);
+					return *mo_Blackboard;
+				}
+				//距离这个agent上一次tick经过的时间，由调度器在tick之前填写；分帧调度时包含了被跳过的帧
+				f32 GetDeltaTime() const
+				{
+					return mf_DeltaTime;
+				}
+				void SetDeltaTime(f32 _f_DeltaTime)
+				{
+					mf_DeltaTime = _f_DeltaTime;
+				}
+				//计时的装饰节点用的时钟，NULL时用BevClock::oGetDefault()；时钟不归agent所有
+				void SetClock(const BevClock *_o_Clock)
+				{
+					mo_Clock = _o_Clock;
+				}
+				const BevClock *oGetClock() const
+				{
+					return mo_Clock ? mo_Clock : BevClock::oGetDefault();
+				}
+				//当前时间（秒）
+				f32 GetTime() const
+				{
+					const BevClock *clock = oGetClock();
+					D_CHECK(clock);
+					return clock ? clock->GetSeconds() : 0.f;
+				}
+
+				//标记某个key的数据变了，之后的评估里依赖它的分支会重新评估
+				void MarkDirty(u32 _ui_Key)
+				{
+					maui_DirtyStamp[_ui_Key % k_BLimited_WatchKeyBits] = (u16)mui_EvaluateStamp;
+				}
+				void MarkDirty(const RefValueBase &_o_Value)
+				{
+					MarkDirty(BevGetWatchKey(_o_Value));
+				}
+				//把一组RefValue里IsDirty的都标上
+				void MarkDirtyRefValues(const RefValueBase *const *_o_Values, u32 _ui_Count);
+				void MarkDirtyMask(u32 _ui_Mask)
+				{
+					for (u32 i = 0; _ui_Mask != 0; ++i, _ui_Mask >>= 1)
+					{
+						if (_ui_Mask & 1)
+							maui_DirtyStamp[i] = (u16)mui_EvaluateStamp;
+					}
+				}
+				//_ui_Mask里有没有key在第_ui_Stamp次评估之后被标脏
+				bool IsDirtySince(u32 _ui_Mask, u32 _ui_Stamp) const
+				{
+					for (u32 i = 0; _ui_Mask != 0; ++i, _ui_Mask >>= 1)
+					{
+						if ((_ui_Mask & 1) && _GetDirtyStamp(i) > _ui_Stamp)
+							return true;
+					}
+					return false;
+				}
+				//当前是第几次根节点评估
+				u32 GetEvaluateStamp() const
+				{
+					return mui_EvaluateStamp;
+				}
+				//根节点评估开始时调用，上一帧缓存的前提条件结果全部作废
+				void BeginEvaluate()
+				{
+					InvalidateConditionCache();
+				}
+				//根节点评估完调用，之后标的脏都算到下一次评估上；黑板的写入记录也从这里重新开始
+				void EndEvaluate(bool _b_Result)
+				{
+					++mui_EvaluateStamp;
+					mb_LastEvaluateResult = _b_Result;
+					if (mo_Blackboard)
+						_ClearBlackboardChanges();
+				}
+				//上一次根节点评估没通过，而且整棵树的评估只取决于订阅的key（根节点IsWatchable）时，
+				//要等这些key被标脏（包括写黑板）才需要再评估；调度器用它让闲着的agent睡下
+				bool NeedsEvaluate() const
+				{
+					return mb_LastEvaluateResult || !mb_RootWatchable || IsDirtySince(mui_RootWatchMask, mui_EvaluateStamp - 1);
+				}
+
+				//前提条件结果缓存，每个槽位存(代数 << 1) | 结果，代数对不上就是过期的
+				bool GetCachedCondition(u32 _ui_Slot, bool &_b_Result) const
+				{
+					D_CHECK(_ui_Slot < mui_ConditionCacheCount);
+					u32 entry = mpui_ConditionCache[_ui_Slot];
+					if ((entry >> 1) != mui_ConditionEpoch)
+						return false;
+					_b_Result = (entry & 1) != 0;
+					return true;
+				}
+				void SetCachedCondition(u32 _ui_Slot, bool _b_Result)
+				{
+					D_CHECK(_ui_Slot < mui_ConditionCacheCount);
+					mpui_ConditionCache[_ui_Slot] = (mui_ConditionEpoch << 1) | (_b_Result ? 1 : 0);
+				}
+				//一帧里input变了又要重新评估时手动调用
+				void InvalidateConditionCache()
+				{
+					if (++mui_ConditionEpoch == k_BLimited_MaxConditionEpoch)
+						_ResetConditionCache();
+				}
+
+			private:
+				BevAgentState(const BevAgentState &);
+				BevAgentState &operator=(const BevAgentState &);
+				//并发的并行节点给每个任务建一个分身：状态块、条件缓存和黑板上的值和_o_Parent共用，
+				//活跃节点、标脏和黑板（_o_Blackboard，要是_o_Parent的黑板的分身）的写入记录各记各的
+				BevAgentState(const BevAgentState &_o_Parent, BevBlackboard *_o_Blackboard);
+				//分身比_o_Parent多标脏的key
+				u32 _GetDirtyMaskSince(const BevAgentState &_o_Parent) const;
+				//分身换过活跃节点的话，合并回来的时候照着它设置
+				void _MergeActiveNode(const BevNode *_o_ActiveNode, const BevNode *_o_LastActiveNode);
+
+				//标脏时只存了序号的低16位，还原成不晚于当前序号的最近一个；超过65535次评估没标过的key还原得偏晚，只会多评估一次，不会漏
+				u32 _GetDirtyStamp(u32 _ui_Bit) const
+				{
+					return mui_EvaluateStamp - (u16)((u16)mui_EvaluateStamp - maui_DirtyStamp[_ui_Bit]);
+				}
+
+				void _Init();
+				void _ResetConditionCache();
+				void _Trace(E_BevTraceEvent _e_Event, const BevNode *_o_Node, s32 _i_Value);
+				void _ClearBlackboardChanges();
+
+			private:
+				const BevNode *mo_Root;
+				u32 mui_Size;
+				u32 mui_ConditionCacheOffset;
+				u32 mui_ConditionCacheCount;
+				const u8 *mab_InitialState;
+				u8 *mab_Data;
+				bool mb_OwnData;
+				const BevNode *mo_ActiveNode;
+				const BevNode *mo_LastActiveNode;
+				f32 mf_DeltaTime;
+				//每个key位最后一次被标脏时的评估序号，只存低16位（见_GetDirtyStamp）
+				u32 mui_EvaluateStamp;
+				u16 maui_DirtyStamp[k_BLimited_WatchKeyBits];
+				//状态块里前提条件缓存的起始位置，和当前的代数
+				u32 *mpui_ConditionCache;
+				u32 mui_ConditionEpoch;
+				BevTraceRecorder *mo_Trace;
+				u32 mui_TraceAgentID;
+				BevBlackboard *mo_Blackboard;
+				const BevClock *mo_Clock;
+				//根节点订阅的key，和上一次根节点评估的结果
+				u32 mui_RootWatchMask;
+				bool mb_RootWatchable;
+				bool mb_LastEvaluateResult;
+			};
+
+			D_Inline bool BevNodePrecondition::Check(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				//没有槽位的（关了缓存、或者不在这棵树的布局里）直接算
+				bool bResult;
+				if (mui_CacheSlot == k_BLimited_InvalidCacheSlot)
+				{
+					bResult = _DoCheck(state, input);
+					D_BevProfileCondition(this, bResult, false);
+					return bResult;
+				}
+				if (state.GetCachedCondition(mui_CacheSlot, bResult))
+				{
+					D_BevProfileCondition(this, bResult, true);
+					return bResult;
+				}
+				bResult = _DoCheck(state, input);
+				state.SetCachedCondition(mui_CacheSlot, bResult);
+				D_BevProfileCondition(this, bResult, false);
+				return bResult;
+			}
+
+			//---------------------------------------------------------------------------------------------------------------------------------
+
+			//树节点基类，建好树之后只读，运行时的数据都放在BevAgentState里
+			class BevNode : public BevArenaObject
+			{
+				friend class BevCompiledTree;
+				friend class BevNodeFactory;
+				friend class BevTreeImage;
+				friend class BevTreeReloader;
+
+			public:
+				BevNode(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodeScript = NULL)
+					: mao_ChildNodeList(NULL), mul_ChildNodeCount(0), mi_ChildNodeCapacity(0), mb_ChildNodeListOnHeap(false), mz_DebugName("UNNAMED"), mo_NodePrecondition(NULL), mui_NodeID(0), mb_HasNodeID(false), mui_StateOffset(0), mui_TreeStateSize(0), mui_WatchMask(0), mb_Watchable(false), mui_EvaluateWatchMask(0), mb_EvaluateWatched(false), mui_AbortFlags(k_BAF_None), mb_HasAbortChildren(false), mui_ConditionCacheOffset(0), mui_ConditionCacheCount(0), mo_Arena(NULL)
+				{
+					_SetParentNode(_o_ParentNode);
+					SetNodePrecondition(_o_NodeScript);
+				}
+
+				virtual ~BevNode()
+				{
+					for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
+					{
+						D_SafeDelete(mao_ChildNodeList[i]);
+					}
+					if (mb_ChildNodeListOnHeap)
+						delete[] mao_ChildNodeList;
+					D_SafeDelete(mo_NodePrecondition);
+				}
+				
+				//评估 先判断是否满足当前节点的前提条件，满足的话再去做 _DoEvaluate(这里用于调用子类的_DoEvaluate)
+				bool Evaluate(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					D_BevProfileScope(this, k_BPE_Evaluate);
+					bool bRoot = state.IsRoot(this);
+					if (bRoot)
+						state.BeginEvaluate();
+					//&&前面的是控制节点本身的评估，后面的则会调用孩子的评估函数。
+					bool bResult = (mo_NodePrecondition == NULL || mo_NodePrecondition->Check(state, input)) && _DoEvaluate(state, input);
+					if (bRoot)
+					{
+						state.EndEvaluate(bResult);
+						state.Trace(k_BTE_Evaluate, this, bResult);
+					}
+					return bResult;
+				}
+				//跳过自己的前提条件只评估下面的部分，正在运行、没有k_BAF_Self标记的孩子每帧走这里
+				bool EvaluateBody(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					D_BevProfileScope(this, k_BPE_Evaluate);
+					return _DoEvaluate(state, input);
+				}
+				
+				//转移，从上一个可运行的节点切换到另一个节点的行为，如何取决于子类。
+				void Transition(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					D_BevProfileScope(this, k_BPE_Transition);
+					_DoTransition(state, input);
+				}
+				
+				//更新，传入数据到行为节点进行更新
+				BevRunningStatus Tick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+				{
+					D_BevProfileScope(this, k_BPE_Tick);
+					return _DoTick(state, input, output);
+				}
+				//---------------------------------------------------------------
+				
+				//添加孩子节点
+				BevNode &AddChildNode(BevNode *_o_ChildNode)
+				{
+					//越界判断
+					if (mul_ChildNodeCount == k_BLimited_MaxChildNodeCnt)
+					{
+						D_Output("The number of child nodes is up to 65534");
+						D_CHECK(0);
+						return (*this);
+					}
+					if (mul_ChildNodeCount == mi_ChildNodeCapacity)
+						_GrowChildNodeList();
+					mao_ChildNodeList[mul_ChildNodeCount] = _o_ChildNode;
+					++mul_ChildNodeCount;
+					return (*this);
+				}
+				//事先知道孩子数量时一次分配好，免得逐步扩容
+				BevNode &ReserveChildNodes(int _i_Count)
+				{
+					D_CHECK(_i_Count <= k_BLimited_MaxChildNodeCnt);
+					if (_i_Count > mi_ChildNodeCapacity)
+						_ResizeChildNodeList(_i_Count);
+					return (*this);
+				}
+				
+				//设置前提条件
+				BevNode &SetNodePrecondition(BevNodePrecondition *_o_NodePrecondition)
+				{
+					//如果传入的先决条件和现在的一样就不做任何操作。
+					if (mo_NodePrecondition != _o_NodePrecondition)
+					{
+						//如果本来就有先决条件，则先释放
+						if (mo_NodePrecondition)
+							delete mo_NodePrecondition;
+
+						mo_NodePrecondition = _o_NodePrecondition;
+					}
+					return (*this);
+				}
+
+				//给节点设置名字
+				BevNode &SetDebugName(const char *_debugName)
+				{
+					mz_DebugName = _debugName;
+					return (*this);
+				}
+
+				//获取当前节点的名字
+				const char *GetDebugName() const
+				{
+					return mz_DebugName.c_str();
+				}
+
+				//热重载时按ID把agent的状态对应到新树的节点上，要在BuildStateLayout之前设置
+				//没设置的节点在BuildStateLayout时用父亲的ID和自己的名字算，路径上的名字不变ID就不变
+				BevNode &SetNodeID(u32 _ui_ID)
+				{
+					mui_NodeID = _ui_ID;
+					mb_HasNodeID = true;
+					return (*this);
+				}
+				u32 GetNodeID() const
+				{
+					return mui_NodeID;
+				}
+
+				//节点类型，自定义的控制节点返回k_BNT_Custom
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_Custom;
+				}
+				//用D_BevDeclareType声明过的类返回类名，内置的控制节点不需要
+				virtual const char *GetTypeName() const
+				{
+					return NULL;
+				}
+				int GetChildNodeCount() const
+				{
+					return mul_ChildNodeCount;
+				}
+				const BevNode *oGetChildNode(int _i_Index) const
+				{
+					D_CHECK(_bCheckIndex(_i_Index));
+					return mao_ChildNodeList[_i_Index];
+				}
+				const BevNodePrecondition *oGetNodePrecondition() const
+				{
+					return mo_NodePrecondition;
+				}
+				//节点所在的arena，堆上分配的是NULL
+				BevTreeArena *oGetArena() const
+				{
+					return mo_Arena;
+				}
+				u32 GetStateOffset() const
+				{
+					return mui_StateOffset;
+				}
+				//订阅key：声明这个节点自己的_DoEvaluate只依赖这些key，要在BuildStateLayout之前声明
+				//声明过的自定义节点、行为节点和内置的控制节点一样可以靠脏标记跳过评估；前提条件用BevNodePrecondition::WatchKey
+				BevNode &WatchKey(u32 _ui_Key)
+				{
+					mui_EvaluateWatchMask |= BevGetWatchBit(_ui_Key);
+					mb_EvaluateWatched = true;
+					return (*this);
+				}
+				//声明_DoEvaluate什么key都不依赖（比如没重载_DoEvaluate的行为节点），要在BuildStateLayout之前声明
+				BevNode &SetEvaluateWatched()
+				{
+					mb_EvaluateWatched = true;
+					return (*this);
+				}
+				//E_BevAbortFlag的组合，只对有优先级的选择节点下的孩子生效，要在BuildStateLayout之前设置
+				//标记过k_BAF_LowerPriority的孩子最好只依赖订阅过的key，不然每帧都要检查
+				BevNode &SetAbortFlags(u32 _ui_Flags)
+				{
+					D_CHECK((_ui_Flags & ~k_BAF_Both) == 0);
+					mui_AbortFlags = (u8)_ui_Flags;
+					return (*this);
+				}
+				u32 GetAbortFlags() const
+				{
+					return mui_AbortFlags;
+				}
+				//有孩子设置了中断标记（BuildStateLayout之后有效）
+				bool HasAbortChildren() const
+				{
+					return mb_HasAbortChildren;
+				}
+				//子树里所有前提条件和节点订阅的key的掩码（BuildStateLayout之后有效）
+				u32 GetWatchMask() const
+				{
+					return mui_WatchMask;
+				}
+				//子树的评估结果是否只取决于GetWatchMask里的key
+				bool IsWatchable() const
+				{
+					return mb_Watchable;
+				}
+
+				//建树完成后在根节点上调用一次，给子树中每个节点分配状态块里的偏移，返回整个状态块的大小
+				//前提条件的结果缓存放在所有节点状态的后面
+				u32 BuildStateLayout()
+				{
+					u32 offset = 0;
+					_LayoutState(offset);
+					std::vector<const BevNodePrecondition *> slots;
+					_BuildCacheSlots(slots, this);
+					offset = (offset + sizeof(u32) - 1) & ~(sizeof(u32) - 1);
+					mui_ConditionCacheOffset = offset;
+					mui_ConditionCacheCount = (u32)slots.size();
+					offset += mui_ConditionCacheCount * sizeof(u32);
+					mui_TreeStateSize = offset;
+					return mui_TreeStateSize;
+				}
+
+				//把子树中节点和前提条件用到的黑板key绑定到_o_Layout上，布局里没有的key会加进去
+				//建树时在根节点上调用，要在用这个布局创建BevBlackboard之前
+				void BindBlackboard(BevBlackboardLayout &_o_Layout);
+
+				//整棵树的状态块大小（只在调用过BuildStateLayout的根节点上有效）
+				u32 GetTreeStateSize() const
+				{
+					return mui_TreeStateSize;
+				}
+				//前提条件缓存在状态块里的偏移和槽位数（同上，只在根节点上有效）
+				u32 GetConditionCacheOffset() const
+				{
+					return mui_ConditionCacheOffset;
+				}
+				u32 GetConditionCacheCount() const
+				{
+					return mui_ConditionCacheCount;
+				}
+
+				//把子树中所有节点的状态写成初始值
+				void InitState(BevAgentState &state) const
+				{
+					_DoInitState(state.GetData() + mui_StateOffset);
+					for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
+						mao_ChildNodeList[i]->InitState(state);
+				}
+
+			protected:
+				//--------------------------------------------------------------
+				// virtual function 这一块由子类自己去完成，行为节点无需实现_DoEvaluate，需要自动返回true
+				//--------------------------------------------------------------
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+					return true;
+				}
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const
+				{
+				}
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+				{
+					return k_BRS_Finish;
+				}
+				//BevCompiledTree::TickBatch里对一段agent做_DoEvaluate，_ab_Results[i]对应_o_Agents[_ui_Indices[i]]
+				//默认逐个调用_DoEvaluate，自定义节点可以重载成一次处理一整段agent
+				virtual void _DoEvaluateBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+				{
+					for (u32 i = 0; i < _ui_Count; ++i)
+						_ab_Results[i] = _DoEvaluate(*_o_Agents[_ui_Indices[i]], _o_Inputs[_ui_Indices[i]]) ? 1 : 0;
+				}
+
+				//每个agent在这个节点上需要的状态大小和对齐
+				virtual u32 _GetStateSize() const
+				{
+					return 0;
+				}
+				virtual u32 _GetStateAlignment() const
+				{
+					return k_BLimited_StateAlignment;
+				}
+				//初始化这个节点的状态
+				virtual void _DoInitState(void *_p_State) const
+				{
+				}
+				//_DoEvaluate的结果是否只取决于孩子和前提条件；只有内置的控制节点默认是，
+				//自定义节点和行为节点要自己声明（重载返回true，或者WatchKey、SetEvaluateWatched）
+				virtual bool _IsEvaluateWatchable() const
+				{
+					E_BevNodeType type = GetNodeType();
+					return type != k_BNT_Custom && type != k_BNT_Terminal;
+				}
+				//用到黑板的节点在这里把自己的key绑定到布局上（BevBlackboardKey::Bind）
+				virtual void _BindBlackboard(BevBlackboardLayout &_o_Layout) const
+				{
+				}
+
+			protected:
+				//设置父亲节点
+				void _SetParentNode(BevNode *_o_ParentNode)
+				{
+					mo_ParentNode = _o_ParentNode;
+				}
+				//控制节点在构造函数里把自带的数组交给基类，行为节点没有孩子数组
+				void _SetInlineChildNodeList(BevNode **_ao_ChildNodeList, int _i_Capacity)
+				{
+					D_CHECK(mul_ChildNodeCount == 0);
+					mao_ChildNodeList = _ao_ChildNodeList;
+					mi_ChildNodeCapacity = _i_Capacity;
+				}
+
+				//检查索引是否越界
+				bool _bCheckIndex(int _ui_Index) const
+				{
+					return _ui_Index >= 0 && _ui_Index < mul_ChildNodeCount;
+				}
+
+				//取这个节点在agent状态块中的数据
+				template <typename T>
+				T &_GetState(BevAgentState &state) const
+				{
+					return *reinterpret_cast<T *>(state.GetData() + mui_StateOffset);
+				}
+
+			private:
+				//容量翻倍，新数组优先从节点的arena里分配
+				void _GrowChildNodeList();
+				void _ResizeChildNodeList(int capacity);
+				void _LayoutState(u32 &_ui_Offset)
+				{
+					if (!mb_HasNodeID)
+						mui_NodeID = BevMakeNodeID(mo_ParentNode ? mo_ParentNode->mui_NodeID : 0, mz_DebugName.c_str());
+					u32 align = _GetStateAlignment();
+					_ui_Offset = (_ui_Offset + align - 1) & ~(align - 1);
+					mui_StateOffset = _ui_Offset;
+					_ui_Offset += _GetStateSize();
+					for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
+						mao_ChildNodeList[i]->_LayoutState(_ui_Offset);
+					_BuildWatchMask();
+				}
+				void _BuildCacheSlots(std::vector<const BevNodePrecondition *> &_o_Slots, const BevNode *_o_Owner) const
+				{
+					if (mo_NodePrecondition)
+						mo_NodePrecondition->BuildCacheSlots(_o_Slots, _o_Owner);
+					for (int i = 0; i < mul_ChildNodeCount; ++i)
+						mao_ChildNodeList[i]->_BuildCacheSlots(_o_Slots, _o_Owner);
+				}
+				void _BuildWatchMask()
+				{
+					mui_WatchMask = mui_EvaluateWatchMask;
+					mb_Watchable = mb_EvaluateWatched || _IsEvaluateWatchable();
+					if (mo_NodePrecondition)
+					{
+						u32 mask;
+						mb_Watchable = mo_NodePrecondition->GetWatchMask(mask) && mb_Watchable;
+						mui_WatchMask |= mask;
+					}
+					mb_HasAbortChildren = false;
+					for (int i = 0; i < mul_ChildNodeCount; ++i)
+					{
+						mui_WatchMask |= mao_ChildNodeList[i]->mui_WatchMask;
+						mb_Watchable = mb_Watchable && mao_ChildNodeList[i]->mb_Watchable;
+						mb_HasAbortChildren = mb_HasAbortChildren || mao_ChildNodeList[i]->mui_AbortFlags != k_BAF_None;
+					}
+				}
+
+			protected:
+				//用来存放孩子节点，指向子类自带的数组或者扩容后的数组
+				BevNode **mao_ChildNodeList;
+				//记录孩子节点的数量
+				int mul_ChildNodeCount;
+				int mi_ChildNodeCapacity;
+				//扩容后的数组是new出来的（arena里的跟着arena一起还）
+				bool mb_ChildNodeListOnHeap;
+				//记录父亲节点
+				BevNode *mo_ParentNode;
+				//前提条件
+				BevNodePrecondition *mo_NodePrecondition;
+				//名称
+				std::string mz_DebugName;
+				//稳定的节点ID，mb_HasNodeID为false时是算出来的
+				u32 mui_NodeID;
+				bool mb_HasNodeID;
+				//在agent状态块中的偏移
+				u32 mui_StateOffset;
+				//整个状态块的大小
+				u32 mui_TreeStateSize;
+				//子树依赖的key的掩码
+				u32 mui_WatchMask;
+				//子树能否靠脏标记跳过评估
+				bool mb_Watchable;
+				//节点自己订阅的key
+				u32 mui_EvaluateWatchMask;
+				bool mb_EvaluateWatched;
+				//E_BevAbortFlag，父亲是有优先级的选择节点时才有用
+				u8 mui_AbortFlags;
+				bool mb_HasAbortChildren;
+				//前提条件缓存（只在根节点上有效）
+				u32 mui_ConditionCacheOffset;
+				u32 mui_ConditionCacheCount;
+				//通过BevNodeFactory从arena里分配时记下来，孩子默认跟着父亲用同一个
+				BevTreeArena *mo_Arena;
+			};
+
+			D_Inline void BevAgentState::_Trace(E_BevTraceEvent _e_Event, const BevNode *_o_Node, s32 _i_Value)
+			{
+				//根节点评估在EndEvaluate之后记，和这一帧后面的Tick是同一个序号
+				mo_Trace->Record(mui_TraceAgentID, mui_EvaluateStamp, _o_Node ? _o_Node->GetNodeID() : 0, _e_Event, _i_Value);
+			}
+		
+			//有优先级的选择类型控制节点
+			class BevNodePrioritySelector : public BevNode
+			{
+			public:
+
+				//传入父亲节点和前提条件，会调用基类的构造函数。
+				BevNodePrioritySelector(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNode(_o_ParentNode, _o_NodePrecondition)
+				{
+					_SetInlineChildNodeList(mao_InlineChildNodeList, k_BLimited_InlineChildNodeCnt);
+				}
+				
+				//控制节点做评估的地方，会一直往下递推下去，直到找到第一个满足所有条件的行为节点。
+				//孩子设置了中断标记时，正在运行的孩子只被标记过的条件打断，不再每帧从头扫
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+
+				//先检查越界，再切换到上一个行为，直到切换到没有上一个行为的节点
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+
+				//更新函数
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_PrioritySelector;
+				}
+
+			protected:
+				//从头按优先级扫一遍孩子，跳过上次没通过、依赖的key也没变过的
+				bool _EvaluateScan(BevAgentState &state, const BevNodeInputParam &input) const;
+
+				//每个agent的选择状态，索引都初始化为无效下标，即为空
+				typedef BevSelectorState State;
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					State *pState = static_cast<State *>(_p_State);
+					pState->mui_CurrentSelectIndex = k_BLimited_InvalidChildNodeIndex;
+					pState->mui_LastSelectIndex = k_BLimited_InvalidChildNodeIndex;
+					pState->mui_KnownFailCount = 0;
+					pState->mui_KnownFailStamp = 0;
+					pState->mui_ObserveCount = 0;
+					pState->mui_ObserveStamp = 0;
+				}
+
+			private:
+				BevNode *mao_InlineChildNodeList[k_BLimited_InlineChildNodeCnt];
+			};
+
+			//选中的孩子一直运行到评估不通过为止，不看孩子的中断标记
+			class BevNodeNonePrioritySelector : public BevNodePrioritySelector
+			{
+			public:
+				BevNodeNonePrioritySelector(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNodePrioritySelector(_o_ParentNode, _o_NodePrecondition)
+				{
+				}
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_NonePrioritySelector;
+				}
+			};
+
+			class BevNodeSequence : public BevNode
+			{
+			public:
+				BevNodeSequence(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNode(_o_ParentNode, _o_NodePrecondition)
+				{
+					_SetInlineChildNodeList(mao_InlineChildNodeList, k_BLimited_InlineChildNodeCnt);
+				}
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_Sequence;
+				}
+
+			protected:
+				typedef BevSequenceState State;
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					static_cast<State *>(_p_State)->mui_CurrentNodeIndex = k_BLimited_InvalidChildNodeIndex;
+				}
+
+			private:
+				BevNode *mao_InlineChildNodeList[k_BLimited_InlineChildNodeCnt];
+			};
+
+			class BevNodeParallel : public BevNode
+			{
+			public:
 				BevNodeParallel(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
-					: BevNode(_o_ParentNode, _o_NodePrecondition), me_FinishCondition(k_PFC_OR)
+					: BevNode(_o_ParentNode, _o_NodePrecondition), me_FinishCondition(k_PFC_OR), mo_JobPool(NULL)
 				{
-					for (unsigned int i = 0; i < k_BLimited_MaxChildNodeCnt; ++i)
-						mab_ChildNodeStatus[i] = k_BRS_Executing;
+					_SetInlineChildNodeList(mao_InlineChildNodeList, k_BLimited_InlineChildNodeCnt);
 				}
-				virtual bool _DoEvaluate(const BevNodeInputParam &input);
-				virtual void _DoTransition(const BevNodeInputParam &input);
-				virtual BevRunningStatus _DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output);
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
 
 				BevNodeParallel &SetFinishCondition(E_ParallelFinishCondition _e_Condition);
+				E_ParallelFinishCondition GetFinishCondition() const
+				{
+					return me_FinishCondition;
+				}
+				//设置了任务池后孩子们作为任务并发执行，全部结束后再判断完成条件；OR模式下有孩子结束时，还没开始的孩子不再执行
+				//每个孩子在agent的分身上跑：状态块和黑板上的值是共用的（各孩子的状态不重叠），活跃节点、标脏和黑板的写入记录各记各的，
+				//全部结束后按孩子的顺序合并回agent，活跃节点取最后一个换过活跃节点的孩子的
+				//孩子之间没有别的同步：output要么不写，要么各写各的部分；同一个黑板key不要有两个孩子写；条件缓存是共用的，tick里不要评估
+				//要在BevCompiledTree::Compile之前设置，编译后的树遇到并发的并行节点会交回给这个节点执行
+				BevNodeParallel &SetJobPool(JobPool *_o_JobPool)
+				{
+					mo_JobPool = _o_JobPool;
+					return (*this);
+				}
+				JobPool *oGetJobPool() const
+				{
+					return mo_JobPool;
+				}
+
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_Parallel;
+				}
+
+			protected:
+				//每个孩子一个字节的运行状态，只按实际的孩子数量分配
+				virtual u32 _GetStateSize() const
+				{
+					return mul_ChildNodeCount * sizeof(s8);
+				}
+				virtual u32 _GetStateAlignment() const
+				{
+					return 1;
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					_ResetChildNodeStatus(static_cast<s8 *>(_p_State));
+				}
+
+			private:
+				void _ResetChildNodeStatus(s8 *_ab_ChildNodeStatus) const
+				{
+					for (unsigned int i = 0; i < mul_ChildNodeCount; ++i)
+						_ab_ChildNodeStatus[i] = k_BRS_Executing;
+				}
+				BevRunningStatus _DoTickConcurrent(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+				//并发模式下一个孩子的一次Tick，在agent的分身上跑，结果留在任务里
+				class ChildJob;
+				friend class ChildJob;
+				void _TickChild(ChildJob &_o_Job) const;
+				void _TickFork(ChildJob &_o_Job, BevAgentState &_o_Fork) const;
 
 			private:
 				E_ParallelFinishCondition me_FinishCondition;
-				BevRunningStatus mab_ChildNodeStatus[k_BLimited_MaxChildNodeCnt];
+				JobPool *mo_JobPool;
+				BevNode *mao_InlineChildNodeList[k_BLimited_InlineChildNodeCnt];
 			};
 
 			class BevNodeLoop : public BevNode
@@ -391,93 +1523,485 @@ namespace TsiU
 
 			public:
 				BevNodeLoop(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL, int _i_LoopCnt = kInfiniteLoop)
-					: BevNode(_o_ParentNode, _o_NodePrecondition), mi_LoopCount(_i_LoopCnt), mi_CurrentCount(0)
+					: BevNode(_o_ParentNode, _o_NodePrecondition), mi_LoopCount(_i_LoopCnt)
+				{
+					_SetInlineChildNodeList(&mo_InlineChildNode, 1);
+				}
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				int GetLoopCount() const
+				{
+					return mi_LoopCount;
+				}
+
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_Loop;
+				}
+
+			protected:
+				typedef BevLoopState State;
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
 				{
+					static_cast<State *>(_p_State)->mi_CurrentCount = 0;
 				}
-				virtual bool _DoEvaluate(const BevNodeInputParam &input);
-				virtual void _DoTransition(const BevNodeInputParam &input);
-				virtual BevRunningStatus _DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output);
 
 			private:
 				int mi_LoopCount;
-				int mi_CurrentCount;
+				//循环节点只有一个孩子
+				BevNode *mo_InlineChildNode;
+			};
+
+			//装饰节点的基类：只有一个孩子，评估和转移默认直接交给孩子
+			//节点在agent之间共享，计时、计数都放在agent的状态块里，时间从BevAgentState::GetTime读
+			//运行的结果里k_BRS_Finish算成功，k_BRS_ERROR_Transition算失败
+			//下面的装饰节点声明了类名，热重载时按它区分；参数不存进BevTreeFile，要存文件就派生一个固定参数的类另外声明、注册
+			class BevNodeDecorator : public BevNode
+			{
+			public:
+				BevNodeDecorator(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNode(_o_ParentNode, _o_NodePrecondition)
+				{
+					_SetInlineChildNodeList(&mo_InlineChildNode, 1);
+				}
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+
+			protected:
+				//评估只看孩子的，和内置节点一样可以靠脏标记跳过
+				virtual bool _IsEvaluateWatchable() const
+				{
+					return true;
+				}
+				const BevNode *_oGetChild() const
+				{
+					return mul_ChildNodeCount > 0 ? mao_ChildNodeList[0] : NULL;
+				}
+
+			private:
+				BevNode *mo_InlineChildNode;
+			};
+
+			//把孩子运行的结果反过来，成功变失败、失败变成功；要反转前提条件用BevNodePreconditionNOT
+			class BevNodeInverter : public BevNodeDecorator
+			{
+				D_BevDeclareType(BevNodeInverter)
+
+			public:
+				BevNodeInverter(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNodeDecorator(_o_ParentNode, _o_NodePrecondition)
+				{
+				}
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+			};
+
+			//孩子失败了下一次tick重新开始，直到成功或者失败了_i_MaxAttempts次
+			class BevNodeRetry : public BevNodeDecorator
+			{
+				D_BevDeclareType(BevNodeRetry)
+
+			public:
+				static const int kInfiniteRetry = -1;
+
+			public:
+				BevNodeRetry(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL, int _i_MaxAttempts = kInfiniteRetry)
+					: BevNodeDecorator(_o_ParentNode, _o_NodePrecondition), mi_MaxAttempts(_i_MaxAttempts)
+				{
+				}
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				int GetMaxAttempts() const
+				{
+					return mi_MaxAttempts;
+				}
+
+			protected:
+				struct State
+				{
+					//这一轮已经失败的次数
+					s32 mi_FailCount;
+				};
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					static_cast<State *>(_p_State)->mi_FailCount = 0;
+				}
+
+			private:
+				int mi_MaxAttempts;
+			};
+
+			//孩子结束（或者被转移）后_f_Seconds秒内评估不通过
+			class BevNodeCooldown : public BevNodeDecorator
+			{
+				D_BevDeclareType(BevNodeCooldown)
+
+			public:
+				BevNodeCooldown(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL, f32 _f_Seconds = 0.f)
+					: BevNodeDecorator(_o_ParentNode, _o_NodePrecondition), mf_Seconds(_f_Seconds)
+				{
+				}
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				f32 GetSeconds() const
+				{
+					return mf_Seconds;
+				}
+
+			protected:
+				struct State
+				{
+					//冷却结束的时间，mb_Cooling为false时没用
+					f32 mf_ReadyTime;
+					u8 mb_Cooling;
+					u8 mb_Running;
+				};
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					State *pState = static_cast<State *>(_p_State);
+					pState->mf_ReadyTime = 0.f;
+					pState->mb_Cooling = false;
+					pState->mb_Running = false;
+				}
+				//评估结果和时间有关，不能靠脏标记跳过
+				virtual bool _IsEvaluateWatchable() const
+				{
+					return false;
+				}
+
+			private:
+				void _StartCooldown(BevAgentState &state) const;
+
+				f32 mf_Seconds;
+			};
+
+			//孩子一次运行超过_f_Seconds秒就转移掉它，返回失败
+			class BevNodeTimeout : public BevNodeDecorator
+			{
+				D_BevDeclareType(BevNodeTimeout)
+
+			public:
+				BevNodeTimeout(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL, f32 _f_Seconds = 0.f)
+					: BevNodeDecorator(_o_ParentNode, _o_NodePrecondition), mf_Seconds(_f_Seconds)
+				{
+				}
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				f32 GetSeconds() const
+				{
+					return mf_Seconds;
+				}
+
+			protected:
+				struct State
+				{
+					f32 mf_StartTime;
+					u8 mb_Running;
+				};
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					State *pState = static_cast<State *>(_p_State);
+					pState->mf_StartTime = 0.f;
+					pState->mb_Running = false;
+				}
+
+			private:
+				f32 mf_Seconds;
+			};
+
+			//孩子两次tick之间至少隔_f_Interval秒，没到时间的tick不调用孩子，直接返回k_BRS_Executing
+			//间隔跨过孩子的多次运行；孩子里按GetDeltaTime计时的只会看到调用它的那些帧的时间
+			class BevNodeRateLimit : public BevNodeDecorator
+			{
+				D_BevDeclareType(BevNodeRateLimit)
+
+			public:
+				BevNodeRateLimit(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL, f32 _f_Interval = 0.f)
+					: BevNodeDecorator(_o_ParentNode, _o_NodePrecondition), mf_Interval(_f_Interval)
+				{
+				}
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				f32 GetInterval() const
+				{
+					return mf_Interval;
+				}
+
+			protected:
+				struct State
+				{
+					f32 mf_NextTickTime;
+					u8 mb_Ticked;
+				};
+				virtual u32 _GetStateSize() const
+				{
+					return sizeof(State);
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					State *pState = static_cast<State *>(_p_State);
+					pState->mf_NextTickTime = 0.f;
+					pState->mb_Ticked = false;
+				}
+
+			private:
+				f32 mf_Interval;
 			};
 
 			//行为节点的基类，所有的行为节点都要继承与这个类
+			//节点对象在agent之间共享，需要跨帧保存的数据不能放在成员变量里，
+			//要通过_GetUserStateSize声明大小，再用_GetUserState取出本agent的那一份
 			class BevNodeTerminal : public BevNode
 			{
 			public:
 				BevNodeTerminal(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
-					: BevNode(_o_ParentNode, _o_NodePrecondition), me_Status(k_TNS_Ready), mb_NeedExit(false)
+					: BevNode(_o_ParentNode, _o_NodePrecondition)
 				{}
 
 				//行为节点的转移就是把节点状态初始化了
-				virtual void _DoTransition(const BevNodeInputParam &input);
+				virtual void _DoTransition(BevAgentState &state, const BevNodeInputParam &input) const;
 				
 				//更新函数
-				virtual BevRunningStatus _DoTick(const BevNodeInputParam &input, BevNodeOutputParam &output);
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_Terminal;
+				}
 			protected:
 				//进入这个类时会调用的接口，可用于初始化一些东西
-				virtual void _DoEnter(const BevNodeInputParam &input) {}
+				virtual void _DoEnter(BevAgentState &state, const BevNodeInputParam &input) const {}
 				//执行行为的函数，可以在这里对传入的数据进行判断。
-				virtual BevRunningStatus _DoExecute(const BevNodeInputParam &input, BevNodeOutputParam &output) { return k_BRS_Finish; }
+				virtual BevRunningStatus _DoExecute(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const { return k_BRS_Finish; }
 				//退出类时会调用的接口（转移控制权或者结束行为时会调用），
-				virtual void _DoExit(const BevNodeInputParam &input, BevRunningStatus _ui_ExitID) {}
+				virtual void _DoExit(BevAgentState &state, const BevNodeInputParam &input, BevRunningStatus _ui_ExitID) const {}
+
+				//子类需要的每个agent的数据（POD），BevAgentState初始化时清零，之后由子类自己在_DoEnter里重置
+				virtual u32 _GetUserStateSize() const { return 0; }
+				template <typename T>
+				T &_GetUserState(BevAgentState &state) const
+				{
+					D_CHECK(sizeof(T) <= _GetUserStateSize());
+					return *reinterpret_cast<T *>(reinterpret_cast<u8 *>(&_GetState<State>(state)) + kUserStateOffset);
+				}
+
+			protected:
+				//节点自己的状态，有子类数据时跟在kUserStateOffset之后
+				static const u32 kUserStateOffset = 8;
+				struct State
+				{
+					u8 me_Status;
+					u8 mb_NeedExit;
+				};
+				virtual u32 _GetStateSize() const
+				{
+					u32 userStateSize = _GetUserStateSize();
+					return userStateSize > 0 ? kUserStateOffset + userStateSize : sizeof(State);
+				}
+				virtual u32 _GetStateAlignment() const
+				{
+					return _GetUserStateSize() > 0 ? kUserStateOffset : k_BLimited_StateAlignment;
+				}
+				virtual void _DoInitState(void *_p_State) const
+				{
+					memset(_p_State, 0, _GetStateSize());
+					static_cast<State *>(_p_State)->me_Status = k_TNS_Ready;
+				}
+			};
+
+			//协程式行为节点每个agent的恢复点和等待条件
+			struct BevCoroutineState
+			{
+				//0是从头开始，其它是上次挂起处的行号
+				u32 mui_ResumePoint;
+				//还要跳过几次tick
+				u32 mui_WaitFrames;
+				//还要等多久，按BevAgentState::GetDeltaTime扣
+				f32 mf_WaitSeconds;
+				u32 mui_Reserved;
+			};
+
+			//在_DoResume里使用，用switch实现的无栈协程：挂起时记下行号，下次tick从那里继续
+			//局部变量在挂起后就没了，要跨帧的数据放在_GetLocals里；一行里只能写一个挂起的宏，也不能放在_DoResume内部的switch里
+#define D_BevCoBegin(co)					switch ((co).mui_ResumePoint) { case 0:
+#define D_BevCoEnd(co)						} (co).mui_ResumePoint = 0; return k_BRS_Finish
+//下一次tick继续
+#define D_BevCoYield(co)					do { (co).mui_ResumePoint = __LINE__; return k_BRS_Executing; case __LINE__:; } while (0)
+//再过_i_Frames次tick时继续，D_BevCoYield相当于等1次；_i_Frames只求值一次，局部变量放在里层块里，跳到case时不会越过它的初始化
+#define D_BevCoWaitFrames(co, _i_Frames)	do { { s32 iBevCoFrames = (s32)(_i_Frames); (co).mui_WaitFrames = iBevCoFrames > 0 ? (u32)(iBevCoFrames - 1) : 0; } (co).mui_ResumePoint = __LINE__; return k_BRS_Executing; case __LINE__:; } while (0)
+//累计的GetDeltaTime达到_f_Seconds后继续
+#define D_BevCoWaitSeconds(co, _f_Seconds)	do { (co).mf_WaitSeconds = (_f_Seconds); (co).mui_ResumePoint = __LINE__; return k_BRS_Executing; case __LINE__:; } while (0)
+//每次tick检查一次，条件成立就继续往下走（比如等异步查询的结果）
+#define D_BevCoWaitUntil(co, _b_Condition)	do { (co).mui_ResumePoint = __LINE__; case __LINE__: if (!(_b_Condition)) return k_BRS_Executing; } while (0)
+
+			//协程式行为节点：不用自己写跨帧的状态机，在_DoResume里顺序写下去，用上面的宏挂起
+			//  D_BevCoBegin(co);
+			//  ...
+			//  D_BevCoWaitSeconds(co, 1.5f);
+			//  D_BevCoWaitUntil(co, _IsPathReady(state));
+			//  D_BevCoEnd(co);
+			//_DoEnter/_DoExit和普通行为节点一样调用；_DoResume可以直接return k_BRS_ERROR_Transition中止
+			//节点重新开始（结束或者被转移之后）时恢复点清零；等待中的tick不会调用_DoResume
+			//按时间等待依赖调度器填写的GetDeltaTime，自己驱动树时要每帧调用BevAgentState::SetDeltaTime
+			class BevNodeCoroutine : public BevNodeTerminal
+			{
+			public:
+				BevNodeCoroutine(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNodeTerminal(_o_ParentNode, _o_NodePrecondition)
+				{}
+
+				virtual BevRunningStatus _DoTick(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+
+			protected:
+				//协程体，返回k_BRS_Executing表示挂起
+				virtual BevRunningStatus _DoResume(BevCoroutineState &co, BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const = 0;
+
+				//跨挂起点保存的数据（POD），节点重新开始时清零
+				virtual u32 _GetLocalsSize() const { return 0; }
+				template <typename T>
+				T &_GetLocals(BevAgentState &state) const
+				{
+					D_CHECK(sizeof(T) <= _GetLocalsSize());
+					return *reinterpret_cast<T *>(&_GetCoroutineState(state) + 1);
+				}
+				BevCoroutineState &_GetCoroutineState(BevAgentState &state) const
+				{
+					return _GetUserState<BevCoroutineState>(state);
+				}
 
 			private:
-				E_TerminalNodeStaus me_Status;
-				bool mb_NeedExit;
+				virtual BevRunningStatus _DoExecute(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const;
+				virtual u32 _GetUserStateSize() const
+				{
+					return sizeof(BevCoroutineState) + _GetLocalsSize();
+				}
 			};
 
 			class BevNodeFactory
 			{
 			public:
-				static BevNode &oCreateParallelNode(BevNode *_o_Parent, E_ParallelFinishCondition _e_Condition, const char *_debugName)
+				//_o_Arena为NULL时用父亲节点的arena，都没有就在堆上分配
+				//arena里的节点照常delete根节点，删完再对arena调用Reset或者析构就把整棵树的内存一次还掉
+				static BevNode &oCreateParallelNode(BevNode *_o_Parent, E_ParallelFinishCondition _e_Condition, const char *_debugName, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodeParallel *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeParallel(_o_Parent);
+					pReturn->SetFinishCondition(_e_Condition);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreateConcurrentParallelNode(BevNode *_o_Parent, E_ParallelFinishCondition _e_Condition, JobPool *_o_JobPool, const char *_debugName, BevTreeArena *_o_Arena = NULL)
 				{
-					BevNodeParallel *pReturn = new BevNodeParallel(_o_Parent);
+					BevNodeParallel *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeParallel(_o_Parent);
 					pReturn->SetFinishCondition(_e_Condition);
-					oCreateNodeCommon(pReturn, _o_Parent, _debugName);
+					pReturn->SetJobPool(_o_JobPool);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreatePrioritySelectorNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodePrioritySelector *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodePrioritySelector(_o_Parent);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreateNonePrioritySelectorNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodeNonePrioritySelector *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeNonePrioritySelector(_o_Parent);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreateSequenceNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodeSequence *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeSequence(_o_Parent);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreateLoopNode(BevNode *_o_Parent, const char *_debugName, int _i_LoopCount, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodeLoop *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeLoop(_o_Parent, NULL, _i_LoopCount);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreateInverterNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodeInverter *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeInverter(_o_Parent);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
+					return (*pReturn);
+				}
+				static BevNode &oCreateRetryNode(BevNode *_o_Parent, const char *_debugName, int _i_MaxAttempts, BevTreeArena *_o_Arena = NULL)
+				{
+					BevNodeRetry *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeRetry(_o_Parent, NULL, _i_MaxAttempts);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
 					return (*pReturn);
 				}
-				static BevNode &oCreatePrioritySelectorNode(BevNode *_o_Parent, const char *_debugName)
+				static BevNode &oCreateCooldownNode(BevNode *_o_Parent, const char *_debugName, f32 _f_Seconds, BevTreeArena *_o_Arena = NULL)
 				{
-					BevNodePrioritySelector *pReturn = new BevNodePrioritySelector(_o_Parent);
-					oCreateNodeCommon(pReturn, _o_Parent, _debugName);
+					BevNodeCooldown *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeCooldown(_o_Parent, NULL, _f_Seconds);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
 					return (*pReturn);
 				}
-				static BevNode &oCreateNonePrioritySelectorNode(BevNode *_o_Parent, const char *_debugName)
+				static BevNode &oCreateTimeoutNode(BevNode *_o_Parent, const char *_debugName, f32 _f_Seconds, BevTreeArena *_o_Arena = NULL)
 				{
-					BevNodeNonePrioritySelector *pReturn = new BevNodeNonePrioritySelector(_o_Parent);
-					oCreateNodeCommon(pReturn, _o_Parent, _debugName);
+					BevNodeTimeout *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeTimeout(_o_Parent, NULL, _f_Seconds);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
 					return (*pReturn);
 				}
-				static BevNode &oCreateSequenceNode(BevNode *_o_Parent, const char *_debugName)
+				static BevNode &oCreateRateLimitNode(BevNode *_o_Parent, const char *_debugName, f32 _f_Interval, BevTreeArena *_o_Arena = NULL)
 				{
-					BevNodeSequence *pReturn = new BevNodeSequence(_o_Parent);
-					oCreateNodeCommon(pReturn, _o_Parent, _debugName);
+					BevNodeRateLimit *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) BevNodeRateLimit(_o_Parent, NULL, _f_Interval);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
 					return (*pReturn);
 				}
-				static BevNode &oCreateLoopNode(BevNode *_o_Parent, const char *_debugName, int _i_LoopCount)
+				template <typename T>
+				static BevNode &oCreateTeminalNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena = NULL)
 				{
-					BevNodeLoop *pReturn = new BevNodeLoop(_o_Parent, NULL, _i_LoopCount);
-					oCreateNodeCommon(pReturn, _o_Parent, _debugName);
+					BevNodeTerminal *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) T(_o_Parent);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
 					return (*pReturn);
 				}
+				//不是行为节点的自定义节点
 				template <typename T>
-				static BevNode &oCreateTeminalNode(BevNode *_o_Parent, const char *_debugName)
+				static BevNode &oCreateCustomNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena = NULL)
 				{
-					BevNodeTerminal *pReturn = new T(_o_Parent);
-					oCreateNodeCommon(pReturn, _o_Parent, _debugName);
+					BevNode *pReturn = new (_oGetArena(_o_Parent, _o_Arena)) T(_o_Parent);
+					oCreateNodeCommon(pReturn, _o_Parent, _debugName, _o_Arena);
 					return (*pReturn);
 				}
 
 			private:
-				static void oCreateNodeCommon(BevNode *_o_Me, BevNode *_o_Parent, const char *_debugName)
+				static void oCreateNodeCommon(BevNode *_o_Me, BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena)
 				{
+					_o_Me->mo_Arena = _oGetArena(_o_Parent, _o_Arena);
 					if (_o_Parent)
 						_o_Parent->AddChildNode(_o_Me);
 					_o_Me->SetDebugName(_debugName);
 				}
+				static BevTreeArena *_oGetArena(BevNode *_o_Parent, BevTreeArena *_o_Arena)
+				{
+					if (_o_Arena)
+						return _o_Arena;
+					return _o_Parent ? _o_Parent->mo_Arena : NULL;
+				}
 			};
 		}
 	}
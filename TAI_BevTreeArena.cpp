@@ -0,0 +1,116 @@
+#include "TAI_BevTreeArena.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			BevTreeArena::BevTreeArena(u32 _ui_BlockSize)
+				: mui_BlockSize(_ui_BlockSize > 0 ? _ui_BlockSize : k_BLimited_ArenaDefaultBlockSize), mo_Blocks(NULL)
+			{
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+			}
+
+			BevTreeArena::~BevTreeArena()
+			{
+				D_CHECK(mo_Stats.mui_LiveObjectCount == 0);
+				while (mo_Blocks)
+				{
+					Block *next = mo_Blocks->mo_Next;
+					delete[] reinterpret_cast<u8 *>(mo_Blocks);
+					mo_Blocks = next;
+				}
+			}
+
+			BevTreeArena::Block *BevTreeArena::_NewBlock(u32 _ui_Size)
+			{
+				u32 headerSize = (sizeof(Block) + k_BLimited_ArenaAlignment - 1) & ~(k_BLimited_ArenaAlignment - 1);
+				Block *block = reinterpret_cast<Block *>(new u8[headerSize + _ui_Size]);
+				block->mo_Next = mo_Blocks;
+				block->mui_Size = _ui_Size;
+				block->mui_Used = 0;
+				mo_Blocks = block;
+				++mo_Stats.mui_BlockCount;
+				mo_Stats.mui_ReservedBytes += _ui_Size;
+				return block;
+			}
+
+			void *BevTreeArena::Alloc(u32 _ui_Size)
+			{
+				u32 size = GetAllocSize(_ui_Size);
+				Block *block = mo_Blocks;
+				if (!block || block->mui_Used + size > block->mui_Size)
+					block = _NewBlock(size > mui_BlockSize ? size : mui_BlockSize);
+
+				void *mem = _GetBlockData(block) + block->mui_Used;
+				block->mui_Used += size;
+				mo_Stats.mui_UsedBytes += size;
+				if (mo_Stats.mui_UsedBytes > mo_Stats.mui_PeakUsedBytes)
+					mo_Stats.mui_PeakUsedBytes = mo_Stats.mui_UsedBytes;
+				return mem;
+			}
+
+			void BevTreeArena::Reserve(u32 _ui_Size)
+			{
+				u32 size = GetAllocSize(_ui_Size);
+				if (!mo_Blocks || mo_Blocks->mui_Used + size > mo_Blocks->mui_Size)
+					_NewBlock(size > mui_BlockSize ? size : mui_BlockSize);
+			}
+
+			void BevTreeArena::Reset()
+			{
+				D_CHECK(mo_Stats.mui_LiveObjectCount == 0);
+				if (mo_Stats.mui_BlockCount > 1)
+				{
+					//上一棵树分成了好几块，换成一整块，下一棵同样的树就是连续的了
+					while (mo_Blocks)
+					{
+						Block *next = mo_Blocks->mo_Next;
+						delete[] reinterpret_cast<u8 *>(mo_Blocks);
+						mo_Blocks = next;
+					}
+					mo_Stats.mui_BlockCount = 0;
+					mo_Stats.mui_ReservedBytes = 0;
+					if (mo_Stats.mui_PeakUsedBytes > mui_BlockSize)
+						mui_BlockSize = mo_Stats.mui_PeakUsedBytes;
+				}
+				else if (mo_Blocks)
+					mo_Blocks->mui_Used = 0;
+				mo_Stats.mui_UsedBytes = 0;
+				mo_Stats.mui_ObjectCount = 0;
+			}
+
+			void *BevTreeArena::AllocObject(u32 _ui_Size, BevTreeArena *_o_Arena)
+			{
+				u32 size = _ui_Size + sizeof(ObjectHeader);
+				ObjectHeader *header;
+				if (_o_Arena)
+				{
+					header = static_cast<ObjectHeader *>(_o_Arena->Alloc(size));
+					++_o_Arena->mo_Stats.mui_ObjectCount;
+					++_o_Arena->mo_Stats.mui_LiveObjectCount;
+				}
+				else
+					header = static_cast<ObjectHeader *>(::operator new(size));
+				header->mo_Arena = _o_Arena;
+				return header + 1;
+			}
+
+			void BevTreeArena::FreeObject(void *_p_Object)
+			{
+				if (!_p_Object)
+					return;
+				ObjectHeader *header = static_cast<ObjectHeader *>(_p_Object) - 1;
+				//arena里的内存等Reset时一起还
+				if (header->mo_Arena)
+				{
+					D_CHECK(header->mo_Arena->mo_Stats.mui_LiveObjectCount > 0);
+					--header->mo_Arena->mo_Stats.mui_LiveObjectCount;
+				}
+				else
+					::operator delete(header);
+			}
+		}
+	}
+}
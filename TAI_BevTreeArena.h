@@ -0,0 +1,120 @@
+#ifndef __TAI_BEVTREEARENA_H__
+#define __TAI_BEVTREEARENA_H__
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+
+#define k_BLimited_ArenaAlignment 8
+#define k_BLimited_ArenaDefaultBlockSize 4096
+
+			//一棵树的节点和前提条件用的线性分配器：对象依次排在大块内存里，单个对象delete时只跑析构，不释放内存，
+			//整棵树删完以后Reset（或者析构）把内存块一次还掉
+			//块用完了会再申请一块，用GetStats().mui_UsedBytes作为下一次的块大小就能让整棵树落在一块连续内存里
+			//不是线程安全的，建树和删树要在同一个线程里做
+			class BevTreeArena
+			{
+			public:
+				struct Stats
+				{
+					//申请过的内存块数和总字节数
+					u32 mui_BlockCount;
+					u32 mui_ReservedBytes;
+					//已经分配出去的字节数（含对齐和对象头），Reset之后清零
+					u32 mui_UsedBytes;
+					u32 mui_PeakUsedBytes;
+					//分配过的对象数和还没析构的对象数
+					u32 mui_ObjectCount;
+					u32 mui_LiveObjectCount;
+				};
+
+				BevTreeArena(u32 _ui_BlockSize = k_BLimited_ArenaDefaultBlockSize);
+				//对象要先删掉
+				~BevTreeArena();
+
+				void *Alloc(u32 _ui_Size);
+				//保证接下来_ui_Size字节的分配都落在同一块里，当前块不够时直接换一块足够大的
+				void Reserve(u32 _ui_Size);
+				//所有对象都删掉以后调用，只留下第一块内存给下一棵树用
+				void Reset();
+
+				const Stats &GetStats() const
+				{
+					return mo_Stats;
+				}
+
+				//给BevArenaObject用：对象前面放一个头，记录它来自哪个分配器（NULL是普通的堆）
+				static void *AllocObject(u32 _ui_Size, BevTreeArena *_o_Arena);
+				static void FreeObject(void *_p_Object);
+				//AllocObject实际从arena里用掉的字节数（含对齐和对象头），事先算整棵树的大小用
+				static u32 GetObjectAllocSize(u32 _ui_Size)
+				{
+					return GetAllocSize(_ui_Size + sizeof(ObjectHeader));
+				}
+				static u32 GetAllocSize(u32 _ui_Size)
+				{
+					return (_ui_Size + k_BLimited_ArenaAlignment - 1) & ~(k_BLimited_ArenaAlignment - 1);
+				}
+
+			private:
+				BevTreeArena(const BevTreeArena &);
+				BevTreeArena &operator=(const BevTreeArena &);
+
+				struct Block
+				{
+					Block *mo_Next;
+					u32 mui_Size;
+					u32 mui_Used;
+				};
+				union ObjectHeader
+				{
+					BevTreeArena *mo_Arena;
+					u8 mab_Align[k_BLimited_ArenaAlignment];
+				};
+
+				Block *_NewBlock(u32 _ui_Size);
+				u8 *_GetBlockData(Block *_o_Block)
+				{
+					return reinterpret_cast<u8 *>(_o_Block) + ((sizeof(Block) + k_BLimited_ArenaAlignment - 1) & ~(k_BLimited_ArenaAlignment - 1));
+				}
+
+			private:
+				u32 mui_BlockSize;
+				//当前在用的块在链表头
+				Block *mo_Blocks;
+				Stats mo_Stats;
+			};
+
+			//BevNode和BevNodePrecondition的基类，只提供operator new/delete
+			//  new X(...)            和原来一样从堆上分配
+			//  new (&arena) X(...)   从arena里分配，arena为NULL时也是堆
+			//两种对象都可以直接delete，arena里的对象delete时只析构
+			class BevArenaObject
+			{
+			public:
+				static void *operator new(size_t _ui_Size)
+				{
+					return BevTreeArena::AllocObject((u32)_ui_Size, NULL);
+				}
+				static void *operator new(size_t _ui_Size, BevTreeArena *_o_Arena)
+				{
+					return BevTreeArena::AllocObject((u32)_ui_Size, _o_Arena);
+				}
+				static void operator delete(void *_p_Object)
+				{
+					BevTreeArena::FreeObject(_p_Object);
+				}
+				//构造函数抛异常时用
+				static void operator delete(void *_p_Object, BevTreeArena *)
+				{
+					BevTreeArena::FreeObject(_p_Object);
+				}
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,538 @@
+#include "TAI_BevTreeFile.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			namespace
+			{
+				bool _CheckString(const BevTreeFileHeader &_o_Header, u32 _ui_Offset, bool _b_Optional)
+				{
+					if (_ui_Offset == k_BLimited_TreeFileInvalidIndex)
+						return _b_Optional;
+					return _ui_Offset < _o_Header.mui_StringTableSize;
+				}
+				//操作数要排在前面，而且只能有一个持有者
+				bool _AddOwner(const BevTreeFilePrecondition *_o_Preconditions, u32 _ui_Count, u32 _ui_Index, std::vector<u8> &_ab_Owned)
+				{
+					if (_ui_Index >= _ui_Count || (_o_Preconditions[_ui_Index].mui_Flags & k_BTPF_Shared) || _ab_Owned[_ui_Index])
+						return false;
+					_ab_Owned[_ui_Index] = 1;
+					return true;
+				}
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevStringTable
+			//-------------------------------------------------------------------------------------
+			u32 BevStringTable::Add(const char *_str)
+			{
+				std::map<std::string, u32>::const_iterator it = mao_Offsets.find(_str);
+				if (it != mao_Offsets.end())
+					return it->second;
+				u32 offset = (u32)mab_Data.size();
+				mab_Data.insert(mab_Data.end(), _str, _str + strlen(_str) + 1);
+				mao_Offsets[_str] = offset;
+				return offset;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevTypeRegistry
+			//-------------------------------------------------------------------------------------
+			const BevTypeRegistry::NodeType *BevTypeRegistry::oFindNode(const char *_name) const
+			{
+				std::map<std::string, NodeType>::const_iterator it = mao_NodeTypes.find(_name);
+				return it != mao_NodeTypes.end() ? &it->second : NULL;
+			}
+			const BevTypeRegistry::PreconditionType *BevTypeRegistry::oFindPrecondition(const char *_name) const
+			{
+				std::map<std::string, PreconditionType>::const_iterator it = mao_PreconditionTypes.find(_name);
+				return it != mao_PreconditionTypes.end() ? &it->second : NULL;
+			}
+			BevPreconditionFunc BevTypeRegistry::FindFunc(const char *_name) const
+			{
+				std::map<std::string, BevPreconditionFunc>::const_iterator it = mao_Funcs.find(_name);
+				return it != mao_Funcs.end() ? it->second : NULL;
+			}
+			const char *BevTypeRegistry::FindFuncName(BevPreconditionFunc _f_Func) const
+			{
+				for (std::map<std::string, BevPreconditionFunc>::const_iterator it = mao_Funcs.begin(); it != mao_Funcs.end(); ++it)
+				{
+					if (it->second == _f_Func)
+						return it->first.c_str();
+				}
+				return NULL;
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevTreeFile
+			//-------------------------------------------------------------------------------------
+			struct BevTreeFile::SaveContext
+			{
+				SaveContext(const BevTypeRegistry &_o_Registry)
+					: mo_Registry(_o_Registry)
+				{
+				}
+				const BevTypeRegistry &mo_Registry;
+				BevStringTable mo_Strings;
+				std::map<const BevNodePrecondition *, u32> mao_PreconditionIndex;
+				std::vector<BevTreeFilePrecondition> mao_Preconditions;
+				//是否已经被节点或者组合条件持有
+				std::vector<u8> mab_Owned;
+			};
+
+			BevTreeFile::BevTreeFile()
+				: mo_Root(NULL), mao_SharedPreconditions(NULL), mui_SharedPreconditionCount(0)
+			{
+			}
+
+			bool BevTreeFile::_SavePrecondition(SaveContext &_o_Context, const BevNodePrecondition *_o_Precondition, u32 &_ui_Index)
+			{
+				std::map<const BevNodePrecondition *, u32>::const_iterator it = _o_Context.mao_PreconditionIndex.find(_o_Precondition);
+				if (it != _o_Context.mao_PreconditionIndex.end())
+				{
+					_ui_Index = it->second;
+					return true;
+				}
+
+				BevTreeFilePrecondition record;
+				memset(&record, 0, sizeof(record));
+				record.me_Type = (u8)_o_Precondition->GetPreconditionType();
+				record.mui_Name = k_BLimited_TreeFileInvalidIndex;
+				record.mui_Operand[0] = record.mui_Operand[1] = k_BLimited_TreeFileInvalidIndex;
+				int operandCount = 0;
+				switch (record.me_Type)
+				{
+				case k_BPT_Leaf:
+				{
+					const char *name = _o_Precondition->GetTypeName();
+					if (!name || !_o_Context.mo_Registry.oFindPrecondition(name))
+					{
+						D_Output("BevTreeFile: precondition type %s is not registered\n", name ? name : "UNNAMED");
+						return false;
+					}
+					record.mui_Name = _o_Context.mo_Strings.Add(name);
+					break;
+				}
+				case k_BPT_FUNC:
+				{
+					const char *name = _o_Context.mo_Registry.FindFuncName(static_cast<const BevNodePreconditionFUNC *>(_o_Precondition)->GetFunc());
+					if (!name)
+					{
+						D_Output("BevTreeFile: precondition function is not registered\n");
+						return false;
+					}
+					record.mui_Name = _o_Context.mo_Strings.Add(name);
+					break;
+				}
+				case k_BPT_NOT:
+				case k_BPT_REF:
+					operandCount = 1;
+					break;
+				case k_BPT_AND:
+				case k_BPT_OR:
+				case k_BPT_XOR:
+					operandCount = 2;
+					break;
+				}
+				for (int i = 0; i < operandCount; ++i)
+				{
+					u32 operand;
+					if (!_SavePrecondition(_o_Context, _o_Precondition->oGetOperand(i), operand))
+						return false;
+					//REF只是引用，其它的操作数归组合条件所有
+					if (record.me_Type != k_BPT_REF)
+					{
+						if (_o_Context.mab_Owned[operand])
+						{
+							D_Output("BevTreeFile: a precondition is owned twice\n");
+							return false;
+						}
+						_o_Context.mab_Owned[operand] = 1;
+					}
+					record.mui_Operand[i] = operand;
+				}
+				if (_o_Precondition->mb_Cacheable)
+					record.mui_Flags |= k_BTPF_Cacheable;
+				if (_o_Precondition->mb_Watched)
+					record.mui_Flags |= k_BTPF_Watched;
+				record.mui_WatchMask = _o_Precondition->mui_WatchMask;
+
+				_ui_Index = (u32)_o_Context.mao_Preconditions.size();
+				_o_Context.mao_Preconditions.push_back(record);
+				_o_Context.mab_Owned.push_back(0);
+				_o_Context.mao_PreconditionIndex[_o_Precondition] = _ui_Index;
+				return true;
+			}
+
+			bool BevTreeFile::Save(const BevNode &_o_Root, const BevTypeRegistry &_o_Registry, std::vector<u8> &_o_Data)
+			{
+				SaveContext context(_o_Registry);
+				std::vector<BevTreeFileNode> records;
+				//层序遍历，孩子们追加在末尾，自然是相邻的
+				std::vector<const BevNode *> nodes;
+				nodes.push_back(&_o_Root);
+				for (u32 i = 0; i < nodes.size(); ++i)
+				{
+					const BevNode *node = nodes[i];
+					BevTreeFileNode record;
+					memset(&record, 0, sizeof(record));
+					record.me_NodeType = (u8)node->GetNodeType();
+					record.mui_FirstChild = (u32)nodes.size();
+					record.mui_ChildCount = (u32)node->GetChildNodeCount();
+					record.mui_Name = context.mo_Strings.Add(node->GetDebugName());
+					record.mui_TypeName = k_BLimited_TreeFileInvalidIndex;
+					record.mui_Precondition = k_BLimited_TreeFileInvalidIndex;
+					record.mui_AbortFlags = (u8)node->GetAbortFlags();
+
+					const char *typeName = node->GetTypeName();
+					if (typeName)
+					{
+						if (!_o_Registry.oFindNode(typeName))
+						{
+							D_Output("BevTreeFile: node type %s is not registered\n", typeName);
+							return false;
+						}
+						record.mui_TypeName = context.mo_Strings.Add(typeName);
+					}
+					else if (record.me_NodeType == k_BNT_Custom || record.me_NodeType == k_BNT_Terminal)
+					{
+						D_Output("BevTreeFile: node %s has no type name\n", node->GetDebugName());
+						return false;
+					}
+					if (record.me_NodeType == k_BNT_Parallel)
+						record.me_FinishCondition = (u8)static_cast<const BevNodeParallel *>(node)->GetFinishCondition();
+					else if (record.me_NodeType == k_BNT_Loop)
+						record.mi_LoopCount = static_cast<const BevNodeLoop *>(node)->GetLoopCount();
+
+					if (node->oGetNodePrecondition())
+					{
+						u32 precondition;
+						if (!_SavePrecondition(context, node->oGetNodePrecondition(), precondition))
+							return false;
+						if (context.mab_Owned[precondition])
+						{
+							D_Output("BevTreeFile: a precondition is owned twice\n");
+							return false;
+						}
+						context.mab_Owned[precondition] = 1;
+						record.mui_Precondition = precondition;
+					}
+
+					for (int j = 0; j < node->GetChildNodeCount(); ++j)
+						nodes.push_back(node->oGetChildNode(j));
+					records.push_back(record);
+				}
+				//没有持有者的条件只被REF引用过，加载时单独建出来
+				for (u32 i = 0; i < context.mao_Preconditions.size(); ++i)
+				{
+					if (!context.mab_Owned[i])
+						context.mao_Preconditions[i].mui_Flags |= k_BTPF_Shared;
+				}
+
+				const std::vector<char> &strings = context.mo_Strings.GetData();
+				BevTreeFileHeader header;
+				header.mui_Magic = k_BLimited_TreeFileMagic;
+				header.mui_Version = k_BLimited_TreeFileVersion;
+				header.mui_NodeCount = (u32)records.size();
+				header.mui_PreconditionCount = (u32)context.mao_Preconditions.size();
+				header.mui_StringTableSize = (u32)strings.size();
+				header.mui_Reserved = 0;
+
+				u32 nodeBytes = header.mui_NodeCount * sizeof(BevTreeFileNode);
+				u32 preconditionBytes = header.mui_PreconditionCount * sizeof(BevTreeFilePrecondition);
+				_o_Data.resize(sizeof(header) + nodeBytes + preconditionBytes + header.mui_StringTableSize);
+				u8 *p = &_o_Data[0];
+				memcpy(p, &header, sizeof(header));
+				p += sizeof(header);
+				memcpy(p, &records[0], nodeBytes);
+				p += nodeBytes;
+				if (preconditionBytes)
+					memcpy(p, &context.mao_Preconditions[0], preconditionBytes);
+				p += preconditionBytes;
+				if (header.mui_StringTableSize)
+					memcpy(p, &strings[0], header.mui_StringTableSize);
+				return true;
+			}
+
+			bool BevTreeFile::_Validate(const u8 *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, u32 &_ui_ArenaSize, u32 &_ui_SharedCount)
+			{
+				if (_ui_Size < sizeof(BevTreeFileHeader))
+					return false;
+				const BevTreeFileHeader &header = *reinterpret_cast<const BevTreeFileHeader *>(_p_Data);
+				if (header.mui_Magic != k_BLimited_TreeFileMagic || header.mui_Version != k_BLimited_TreeFileVersion || header.mui_NodeCount == 0)
+					return false;
+				u32 remain = _ui_Size - sizeof(BevTreeFileHeader);
+				if (header.mui_NodeCount > remain / sizeof(BevTreeFileNode))
+					return false;
+				remain -= header.mui_NodeCount * sizeof(BevTreeFileNode);
+				if (header.mui_PreconditionCount > remain / sizeof(BevTreeFilePrecondition))
+					return false;
+				remain -= header.mui_PreconditionCount * sizeof(BevTreeFilePrecondition);
+				if (header.mui_StringTableSize != remain)
+					return false;
+
+				const BevTreeFileNode *nodes = reinterpret_cast<const BevTreeFileNode *>(_p_Data + sizeof(BevTreeFileHeader));
+				const BevTreeFilePrecondition *preconditions = reinterpret_cast<const BevTreeFilePrecondition *>(nodes + header.mui_NodeCount);
+				const char *strings = reinterpret_cast<const char *>(preconditions + header.mui_PreconditionCount);
+				if (header.mui_StringTableSize > 0 && strings[header.mui_StringTableSize - 1] != 0)
+					return false;
+
+				_ui_ArenaSize = 0;
+				_ui_SharedCount = 0;
+				std::vector<u8> owned(header.mui_PreconditionCount, 0);
+				for (u32 i = 0; i < header.mui_PreconditionCount; ++i)
+				{
+					const BevTreeFilePrecondition &record = preconditions[i];
+					u32 size = 0;
+					bool bValid = true;
+					switch (record.me_Type)
+					{
+					case k_BPT_Leaf:
+					{
+						const BevTypeRegistry::PreconditionType *type = NULL;
+						bValid = _CheckString(header, record.mui_Name, false) && (type = _o_Registry.oFindPrecondition(strings + record.mui_Name)) != NULL;
+						size = type ? type->mui_Size : 0;
+						break;
+					}
+					case k_BPT_FUNC:
+						bValid = _CheckString(header, record.mui_Name, false) && _o_Registry.FindFunc(strings + record.mui_Name) != NULL;
+						size = sizeof(BevNodePreconditionFUNC);
+						break;
+					case k_BPT_TRUE:
+						size = sizeof(BevNodePreconditionTRUE);
+						break;
+					case k_BPT_FALSE:
+						size = sizeof(BevNodePreconditionFALSE);
+						break;
+					case k_BPT_NOT:
+						bValid = _AddOwner(preconditions, i, record.mui_Operand[0], owned);
+						size = sizeof(BevNodePreconditionNOT);
+						break;
+					case k_BPT_AND:
+					case k_BPT_OR:
+					case k_BPT_XOR:
+						bValid = _AddOwner(preconditions, i, record.mui_Operand[0], owned) && _AddOwner(preconditions, i, record.mui_Operand[1], owned);
+						if (record.me_Type == k_BPT_AND)
+							size = sizeof(BevNodePreconditionAND);
+						else if (record.me_Type == k_BPT_OR)
+							size = sizeof(BevNodePreconditionOR);
+						else
+							size = sizeof(BevNodePreconditionXOR);
+						break;
+					case k_BPT_REF:
+						bValid = record.mui_Operand[0] < i;
+						size = sizeof(BevNodePreconditionREF);
+						break;
+					default:
+						bValid = false;
+						break;
+					}
+					if (!bValid)
+						return false;
+					_ui_ArenaSize += BevTreeArena::GetObjectAllocSize(size);
+					if (record.mui_Flags & k_BTPF_Shared)
+						++_ui_SharedCount;
+				}
+
+				//层序排列时第i个有孩子的节点，孩子紧接着前面所有节点的孩子
+				u32 nextChild = 1;
+				for (u32 i = 0; i < header.mui_NodeCount; ++i)
+				{
+					const BevTreeFileNode &record = nodes[i];
+					u32 size = 0;
+					u32 inlineCount = 0;
+					if (!_CheckString(header, record.mui_Name, true) || !_CheckString(header, record.mui_TypeName, true))
+						return false;
+					if ((record.mui_AbortFlags & ~k_BAF_Both) != 0)
+						return false;
+					if (record.mui_TypeName != k_BLimited_TreeFileInvalidIndex)
+					{
+						//自定义节点自带多少个孩子的位置不知道，按全部放在arena里算
+						const BevTypeRegistry::NodeType *type = _o_Registry.oFindNode(strings + record.mui_TypeName);
+						if (!type)
+							return false;
+						size = type->mui_Size;
+					}
+					else
+					{
+						switch (record.me_NodeType)
+						{
+						case k_BNT_PrioritySelector:
+							size = sizeof(BevNodePrioritySelector);
+							inlineCount = k_BLimited_InlineChildNodeCnt;
+							break;
+						case k_BNT_NonePrioritySelector:
+							size = sizeof(BevNodeNonePrioritySelector);
+							inlineCount = k_BLimited_InlineChildNodeCnt;
+							break;
+						case k_BNT_Sequence:
+							size = sizeof(BevNodeSequence);
+							inlineCount = k_BLimited_InlineChildNodeCnt;
+							break;
+						case k_BNT_Parallel:
+							if (record.me_FinishCondition != k_PFC_OR && record.me_FinishCondition != k_PFC_AND)
+								return false;
+							size = sizeof(BevNodeParallel);
+							inlineCount = k_BLimited_InlineChildNodeCnt;
+							break;
+						case k_BNT_Loop:
+							if (record.mui_ChildCount > 1)
+								return false;
+							size = sizeof(BevNodeLoop);
+							inlineCount = 1;
+							break;
+						default:
+							//行为节点和自定义节点必须有类名
+							return false;
+						}
+					}
+					if (record.mui_ChildCount > 0)
+					{
+						if (record.mui_ChildCount > k_BLimited_MaxChildNodeCnt || record.mui_FirstChild != nextChild || record.mui_ChildCount > header.mui_NodeCount - nextChild)
+							return false;
+						nextChild += record.mui_ChildCount;
+						if (record.mui_ChildCount > inlineCount)
+							_ui_ArenaSize += BevTreeArena::GetAllocSize(record.mui_ChildCount * sizeof(BevNode *));
+					}
+					if (record.mui_Precondition != k_BLimited_TreeFileInvalidIndex && !_AddOwner(preconditions, header.mui_PreconditionCount, record.mui_Precondition, owned))
+						return false;
+					_ui_ArenaSize += BevTreeArena::GetObjectAllocSize(size);
+				}
+				if (nextChild != header.mui_NodeCount)
+					return false;
+
+				//除了共享的条件，每个条件都要正好有一个持有者，不然会泄漏
+				for (u32 i = 0; i < header.mui_PreconditionCount; ++i)
+				{
+					if (!(preconditions[i].mui_Flags & k_BTPF_Shared) && !owned[i])
+						return false;
+				}
+				if (_ui_SharedCount)
+					_ui_ArenaSize += BevTreeArena::GetAllocSize(_ui_SharedCount * sizeof(BevNodePrecondition *));
+				return true;
+			}
+
+			bool BevTreeFile::Load(const void *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, BevTreeArena &_o_Arena)
+			{
+				const u8 *data = static_cast<const u8 *>(_p_Data);
+				u32 arenaSize;
+				u32 sharedCount;
+				if (!_Validate(data, _ui_Size, _o_Registry, arenaSize, sharedCount))
+				{
+					D_Output("BevTreeFile: invalid tree data\n");
+					return false;
+				}
+				Unload();
+				_o_Arena.Reserve(arenaSize);
+
+				const BevTreeFileHeader &header = *reinterpret_cast<const BevTreeFileHeader *>(data);
+				const BevTreeFileNode *nodes = reinterpret_cast<const BevTreeFileNode *>(data + sizeof(BevTreeFileHeader));
+				const BevTreeFilePrecondition *records = reinterpret_cast<const BevTreeFilePrecondition *>(nodes + header.mui_NodeCount);
+				const char *strings = reinterpret_cast<const char *>(records + header.mui_PreconditionCount);
+
+				if (sharedCount)
+					mao_SharedPreconditions = static_cast<BevNodePrecondition **>(_o_Arena.Alloc(sharedCount * sizeof(BevNodePrecondition *)));
+
+				//操作数都在前面，按顺序建就行
+				std::vector<BevNodePrecondition *> preconditions(header.mui_PreconditionCount, (BevNodePrecondition *)NULL);
+				for (u32 i = 0; i < header.mui_PreconditionCount; ++i)
+				{
+					const BevTreeFilePrecondition &record = records[i];
+					BevNodePrecondition *precondition = NULL;
+					switch (record.me_Type)
+					{
+					case k_BPT_Leaf:
+						precondition = _o_Registry.oFindPrecondition(strings + record.mui_Name)->mf_Creator(&_o_Arena);
+						break;
+					case k_BPT_FUNC:
+						precondition = new (&_o_Arena) BevNodePreconditionFUNC(_o_Registry.FindFunc(strings + record.mui_Name));
+						break;
+					case k_BPT_TRUE:
+						precondition = new (&_o_Arena) BevNodePreconditionTRUE();
+						break;
+					case k_BPT_FALSE:
+						precondition = new (&_o_Arena) BevNodePreconditionFALSE();
+						break;
+					case k_BPT_NOT:
+						precondition = new (&_o_Arena) BevNodePreconditionNOT(preconditions[record.mui_Operand[0]]);
+						break;
+					case k_BPT_AND:
+						precondition = new (&_o_Arena) BevNodePreconditionAND(preconditions[record.mui_Operand[0]], preconditions[record.mui_Operand[1]]);
+						break;
+					case k_BPT_OR:
+						precondition = new (&_o_Arena) BevNodePreconditionOR(preconditions[record.mui_Operand[0]], preconditions[record.mui_Operand[1]]);
+						break;
+					case k_BPT_XOR:
+						precondition = new (&_o_Arena) BevNodePreconditionXOR(preconditions[record.mui_Operand[0]], preconditions[record.mui_Operand[1]]);
+						break;
+					case k_BPT_REF:
+						precondition = new (&_o_Arena) BevNodePreconditionREF(preconditions[record.mui_Operand[0]]);
+						break;
+					}
+					precondition->SetCacheable((record.mui_Flags & k_BTPF_Cacheable) != 0);
+					precondition->mui_WatchMask = record.mui_WatchMask;
+					precondition->mb_Watched = (record.mui_Flags & k_BTPF_Watched) != 0;
+					if (record.mui_Flags & k_BTPF_Shared)
+						mao_SharedPreconditions[mui_SharedPreconditionCount++] = precondition;
+					preconditions[i] = precondition;
+				}
+
+				//父亲总在孩子前面建好，建父亲时就把孩子数组一次留够
+				std::vector<BevNode *> created(header.mui_NodeCount, (BevNode *)NULL);
+				for (u32 i = 0; i < header.mui_NodeCount; ++i)
+				{
+					const BevTreeFileNode &record = nodes[i];
+					if (i == 0)
+						created[0] = _oCreateNode(record, NULL, strings, _o_Registry, _o_Arena);
+					BevNode *node = created[i];
+					node->SetAbortFlags(record.mui_AbortFlags);
+					if (record.mui_Precondition != k_BLimited_TreeFileInvalidIndex)
+						node->SetNodePrecondition(preconditions[record.mui_Precondition]);
+					if (record.mui_ChildCount == 0)
+						continue;
+					node->ReserveChildNodes(record.mui_ChildCount);
+					for (u32 j = record.mui_FirstChild; j < record.mui_FirstChild + record.mui_ChildCount; ++j)
+						created[j] = _oCreateNode(nodes[j], node, strings, _o_Registry, _o_Arena);
+				}
+				mo_Root = created[0];
+				mo_Root->BuildStateLayout();
+				return true;
+			}
+
+			BevNode *BevTreeFile::_oCreateNode(const BevTreeFileNode &_o_Record, BevNode *_o_Parent, const char *_p_Strings, const BevTypeRegistry &_o_Registry, BevTreeArena &_o_Arena)
+			{
+				const char *name = _o_Record.mui_Name != k_BLimited_TreeFileInvalidIndex ? _p_Strings + _o_Record.mui_Name : "UNNAMED";
+				if (_o_Record.mui_TypeName != k_BLimited_TreeFileInvalidIndex)
+					return &_o_Registry.oFindNode(_p_Strings + _o_Record.mui_TypeName)->mf_Creator(_o_Parent, name, &_o_Arena);
+				switch (_o_Record.me_NodeType)
+				{
+				case k_BNT_PrioritySelector:
+					return &BevNodeFactory::oCreatePrioritySelectorNode(_o_Parent, name, &_o_Arena);
+				case k_BNT_NonePrioritySelector:
+					return &BevNodeFactory::oCreateNonePrioritySelectorNode(_o_Parent, name, &_o_Arena);
+				case k_BNT_Sequence:
+					return &BevNodeFactory::oCreateSequenceNode(_o_Parent, name, &_o_Arena);
+				case k_BNT_Parallel:
+					return &BevNodeFactory::oCreateParallelNode(_o_Parent, (E_ParallelFinishCondition)_o_Record.me_FinishCondition, name, &_o_Arena);
+				case k_BNT_Loop:
+					return &BevNodeFactory::oCreateLoopNode(_o_Parent, name, _o_Record.mi_LoopCount, &_o_Arena);
+				}
+				D_CHECK(0);
+				return NULL;
+			}
+
+			void BevTreeFile::Unload()
+			{
+				//先删树，REF不会碰被引用的条件
+				D_SafeDelete(mo_Root);
+				for (u32 i = 0; i < mui_SharedPreconditionCount; ++i)
+					D_SafeDelete(mao_SharedPreconditions[i]);
+				mao_SharedPreconditions = NULL;
+				mui_SharedPreconditionCount = 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,199 @@
+#ifndef __TAI_BEVTREEFILE_H__
+#define __TAI_BEVTREEFILE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "TAI_BevTree.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+//'BEVT'
+#define k_BLimited_TreeFileMagic 0x54564542
+#define k_BLimited_TreeFileVersion 1
+#define k_BLimited_TreeFileInvalidIndex 0xffffffff
+
+			//文件格式：文件头 | 节点表 | 前提条件表 | 字符串表，都是4字节对齐的POD，按本机字节序存放
+			struct BevTreeFileHeader
+			{
+				u32 mui_Magic;
+				u32 mui_Version;
+				u32 mui_NodeCount;
+				u32 mui_PreconditionCount;
+				//字符串表的字节数，每个字符串以0结尾，相同的字符串只存一份
+				u32 mui_StringTableSize;
+				u32 mui_Reserved;
+			};
+
+			//节点按层序排列，第0个是根节点，同一个节点的孩子是相邻的
+			struct BevTreeFileNode
+			{
+				//E_BevNodeType
+				u8 me_NodeType;
+				//并行节点的完成条件
+				u8 me_FinishCondition;
+				//E_BevAbortFlag，旧文件里是0
+				u8 mui_AbortFlags;
+				u8 mui_Reserved;
+				//孩子在节点表中的范围[mui_FirstChild, mui_FirstChild + mui_ChildCount)
+				u32 mui_FirstChild;
+				u32 mui_ChildCount;
+				//循环节点的次数
+				s32 mi_LoopCount;
+				//以下是字符串表里的偏移，没有时为k_BLimited_TreeFileInvalidIndex
+				u32 mui_Name;
+				//D_BevDeclareType声明的类名，内置的控制节点没有
+				u32 mui_TypeName;
+				//前提条件表里的下标
+				u32 mui_Precondition;
+			};
+
+			enum E_BevTreeFilePreconditionFlag
+			{
+				k_BTPF_Cacheable = 1 << 0,
+				k_BTPF_Watched = 1 << 1,
+				//不归任何节点或者组合条件所有，只被REF引用，由BevTreeFile负责释放
+				k_BTPF_Shared = 1 << 2,
+			};
+
+			//前提条件按依赖排序，操作数和REF引用的条件总在前面
+			struct BevTreeFilePrecondition
+			{
+				//E_BevPreconditionType
+				u8 me_Type;
+				//E_BevTreeFilePreconditionFlag
+				u8 mui_Flags;
+				u16 mui_Reserved;
+				//k_BPT_Leaf是类名，k_BPT_FUNC是函数名，都是字符串表里的偏移
+				u32 mui_Name;
+				//NOT/AND/OR/XOR的操作数，REF引用的条件，是前提条件表里的下标
+				u32 mui_Operand[2];
+				u32 mui_WatchMask;
+			};
+
+			//存文件时用的字符串表，相同的字符串只存一份，返回的是在表里的偏移
+			class BevStringTable
+			{
+			public:
+				u32 Add(const char *_str);
+				const std::vector<char> &GetData() const
+				{
+					return mab_Data;
+				}
+
+			private:
+				std::map<std::string, u32> mao_Offsets;
+				std::vector<char> mab_Data;
+			};
+
+			//文件里只存类名和函数名，读写都要靠这张表找回类型和函数
+			//注册的类型要能用默认参数构造：节点是T(BevNode *parent)，前提条件是T()
+			class BevTypeRegistry
+			{
+			public:
+				typedef BevNode &(*NodeCreator)(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena);
+				typedef BevNodePrecondition *(*PreconditionCreator)(BevTreeArena *_o_Arena);
+
+				struct NodeType
+				{
+					NodeCreator mf_Creator;
+					u32 mui_Size;
+				};
+				struct PreconditionType
+				{
+					PreconditionCreator mf_Creator;
+					u32 mui_Size;
+				};
+
+				template <typename T>
+				void RegisterNode()
+				{
+					NodeType &type = mao_NodeTypes[T::StaticTypeName()];
+					type.mf_Creator = &_oCreateNode<T>;
+					type.mui_Size = sizeof(T);
+				}
+				template <typename T>
+				void RegisterPrecondition()
+				{
+					PreconditionType &type = mao_PreconditionTypes[T::StaticTypeName()];
+					type.mf_Creator = &_oCreatePrecondition<T>;
+					type.mui_Size = sizeof(T);
+				}
+				void RegisterFunc(const char *_name, BevPreconditionFunc _f_Func)
+				{
+					mao_Funcs[_name] = _f_Func;
+				}
+
+				const NodeType *oFindNode(const char *_name) const;
+				const PreconditionType *oFindPrecondition(const char *_name) const;
+				BevPreconditionFunc FindFunc(const char *_name) const;
+				//保存时把函数指针换回名字，没注册过返回NULL
+				const char *FindFuncName(BevPreconditionFunc _f_Func) const;
+
+			private:
+				template <typename T>
+				static BevNode &_oCreateNode(BevNode *_o_Parent, const char *_debugName, BevTreeArena *_o_Arena)
+				{
+					return BevNodeFactory::oCreateCustomNode<T>(_o_Parent, _debugName, _o_Arena);
+				}
+				template <typename T>
+				static BevNodePrecondition *_oCreatePrecondition(BevTreeArena *_o_Arena)
+				{
+					return new (_o_Arena) T();
+				}
+
+			private:
+				std::map<std::string, NodeType> mao_NodeTypes;
+				std::map<std::string, PreconditionType> mao_PreconditionTypes;
+				std::map<std::string, BevPreconditionFunc> mao_Funcs;
+			};
+
+			//把BevNodeFactory建好的树存成上面的格式，或者从这种格式直接建树
+			//加载前先算好整棵树要用的字节数，在arena里一次留够，节点、前提条件、孩子数组都排在同一块内存里
+			//存的只有树的结构：并行节点的JobPool、节点和条件自己的成员变量都不在文件里
+			class BevTreeFile
+			{
+			public:
+				BevTreeFile();
+				~BevTreeFile()
+				{
+					Unload();
+				}
+
+				//树里有没注册的类型、或者同一个前提条件对象被两处持有时返回false
+				static bool Save(const BevNode &_o_Root, const BevTypeRegistry &_o_Registry, std::vector<u8> &_o_Data);
+
+				//数据不合法、类型没注册时返回false，这时什么都不会分配
+				//成功后树已经BuildStateLayout过，整棵树的内存都在_o_Arena里，Unload之后再对arena调用Reset
+				bool Load(const void *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, BevTreeArena &_o_Arena);
+				void Unload();
+
+				BevNode *oGetRoot() const
+				{
+					return mo_Root;
+				}
+
+			private:
+				BevTreeFile(const BevTreeFile &);
+				BevTreeFile &operator=(const BevTreeFile &);
+
+				struct SaveContext;
+				static bool _SavePrecondition(SaveContext &_o_Context, const BevNodePrecondition *_o_Precondition, u32 &_ui_Index);
+				static bool _Validate(const u8 *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, u32 &_ui_ArenaSize, u32 &_ui_SharedCount);
+				static BevNode *_oCreateNode(const BevTreeFileNode &_o_Record, BevNode *_o_Parent, const char *_p_Strings, const BevTypeRegistry &_o_Registry, BevTreeArena &_o_Arena);
+
+			private:
+				BevNode *mo_Root;
+				//只被REF引用的前提条件，数组本身也在arena里
+				BevNodePrecondition **mao_SharedPreconditions;
+				u32 mui_SharedPreconditionCount;
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,520 @@
+#include "TAI_BevTreeImage.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			namespace
+			{
+				u32 _Align(u32 _ui_Offset)
+				{
+					return (_ui_Offset + k_BLimited_TreeImageAlignment - 1) & ~(k_BLimited_TreeImageAlignment - 1);
+				}
+				//段要对齐，并且整段都在镜像里面
+				bool _CheckSection(const BevTreeImageHeader &_o_Header, u32 _ui_Offset, u32 _ui_Count, u32 _ui_ElementSize)
+				{
+					if (_ui_Offset % k_BLimited_TreeImageAlignment != 0 || _ui_Offset > _o_Header.mui_Size)
+						return false;
+					return _ui_Count <= (_o_Header.mui_Size - _ui_Offset) / _ui_ElementSize;
+				}
+				bool _CheckString(const BevTreeImageHeader &_o_Header, u32 _ui_Offset)
+				{
+					return _ui_Offset < _o_Header.mui_StringTableSize;
+				}
+				template <typename T>
+				const T *_GetSection(const u8 *_p_Data, u32 _ui_Offset)
+				{
+					return reinterpret_cast<const T *>(_p_Data + _ui_Offset);
+				}
+			}
+
+			struct BevTreeImage::BuildContext
+			{
+				BuildContext(const BevTypeRegistry &_o_Registry)
+					: mo_Registry(_o_Registry)
+				{
+				}
+				const BevTypeRegistry &mo_Registry;
+				BevStringTable mo_Strings;
+				std::vector<BevTreeImageBinding> mao_Bindings;
+				//同一个叶子条件被多个条件用到时只绑定一次
+				std::map<const BevNodePrecondition *, u32> mao_PreconditionBinding;
+			};
+
+			u32 BevTreeImage::_AddPreconditionBinding(BuildContext &_o_Context, const BevNodePrecondition *_o_Precondition)
+			{
+				std::map<const BevNodePrecondition *, u32>::const_iterator it = _o_Context.mao_PreconditionBinding.find(_o_Precondition);
+				if (it != _o_Context.mao_PreconditionBinding.end())
+					return it->second;
+
+				BevTreeImageBinding binding;
+				memset(&binding, 0, sizeof(binding));
+				const char *name = NULL;
+				if (_o_Precondition->GetPreconditionType() == k_BPT_FUNC)
+				{
+					binding.me_Type = k_BTIB_Func;
+					name = _o_Context.mo_Registry.FindFuncName(static_cast<const BevNodePreconditionFUNC *>(_o_Precondition)->GetFunc());
+				}
+				else if (_o_Precondition->GetPreconditionType() == k_BPT_Leaf)
+				{
+					binding.me_Type = k_BTIB_Precondition;
+					name = _o_Precondition->GetTypeName();
+					if (name && !_o_Context.mo_Registry.oFindPrecondition(name))
+						name = NULL;
+				}
+				if (!name)
+				{
+					D_Output("BevTreeImage: precondition type is not registered\n");
+					return k_BLimited_InvalidObjectIndex;
+				}
+				binding.mui_Name = _o_Context.mo_Strings.Add(name);
+				binding.mui_DebugName = k_BLimited_InvalidObjectIndex;
+				binding.mui_Arg = _o_Precondition->mui_CacheSlot;
+
+				u32 index = (u32)_o_Context.mao_Bindings.size();
+				_o_Context.mao_Bindings.push_back(binding);
+				_o_Context.mao_PreconditionBinding[_o_Precondition] = index;
+				return index;
+			}
+
+			bool BevTreeImage::Build(const BevCompiledTree &_o_Tree, const BevTypeRegistry &_o_Registry, std::vector<u8> &_o_Data)
+			{
+				if (!_o_Tree.oGetRoot() || _o_Tree.GetNodeCount() == 0)
+					return false;
+				BuildContext context(_o_Registry);
+
+				//节点数组原样拷贝，只把对象下标换成绑定表的下标
+				std::vector<BevCompiledNode> nodes(_o_Tree.mao_NodeData, _o_Tree.mao_NodeData + _o_Tree.mui_NodeCount);
+				for (u32 i = 0; i < nodes.size(); ++i)
+				{
+					BevCompiledNode &node = nodes[i];
+					if (node.mui_ObjectIndex == k_BLimited_InvalidObjectIndex)
+						continue;
+					const BevNode *object = _o_Tree.mao_Objects[node.mui_ObjectIndex];
+					if (node.mui_ChildCount > 0)
+					{
+						D_Output("BevTreeImage: node %s runs its own children and can't be stored in an image\n", object->GetDebugName());
+						return false;
+					}
+					const char *name = object->GetTypeName();
+					if (!name || !_o_Registry.oFindNode(name))
+					{
+						D_Output("BevTreeImage: node type of %s is not registered\n", object->GetDebugName());
+						return false;
+					}
+					BevTreeImageBinding binding;
+					memset(&binding, 0, sizeof(binding));
+					binding.me_Type = k_BTIB_Node;
+					binding.mui_Name = context.mo_Strings.Add(name);
+					binding.mui_DebugName = context.mo_Strings.Add(object->GetDebugName());
+					binding.mui_Arg = object->mui_StateOffset;
+					binding.mui_StateSize = object->_GetStateSize();
+					binding.mui_NodeID = object->GetNodeID();
+					node.mui_ObjectIndex = (u32)context.mao_Bindings.size();
+					context.mao_Bindings.push_back(binding);
+				}
+
+				std::vector<BevTreeImageCondition> conditions(_o_Tree.mao_Preconditions.size());
+				std::vector<BevPreconditionInstr> code;
+				std::vector<u32> leaves;
+				for (u32 i = 0; i < conditions.size(); ++i)
+				{
+					BevTreeImageCondition &condition = conditions[i];
+					const BevPreconditionProgram &program = _o_Tree.mao_Programs[i];
+					condition.mui_FirstInstr = (u32)code.size();
+					condition.mui_InstrCount = program.GetInstrCount();
+					condition.mui_FirstLeaf = (u32)leaves.size();
+					if (program.IsEmpty())
+					{
+						const BevNodePrecondition *precondition = _o_Tree.mao_Preconditions[i];
+						leaves.push_back(_AddPreconditionBinding(context, precondition));
+						condition.mui_CacheSlot = precondition->mui_CacheSlot;
+					}
+					else
+					{
+						code.insert(code.end(), program.GetCode(), program.GetCode() + program.GetInstrCount());
+						for (u32 j = 0; j < program.GetLeafCount(); ++j)
+							leaves.push_back(_AddPreconditionBinding(context, program.oGetLeaf(j)));
+						condition.mui_CacheSlot = program.GetCacheSlot();
+					}
+					condition.mui_LeafCount = (u32)leaves.size() - condition.mui_FirstLeaf;
+				}
+				for (u32 i = 0; i < leaves.size(); ++i)
+				{
+					if (leaves[i] == k_BLimited_InvalidObjectIndex)
+						return false;
+				}
+
+				BevAgentState state(*_o_Tree.oGetRoot());
+				const std::vector<char> &strings = context.mo_Strings.GetData();
+
+				BevTreeImageHeader header;
+				memset(&header, 0, sizeof(header));
+				header.mui_Magic = k_BLimited_TreeImageMagic;
+				header.mui_Version = k_BLimited_TreeImageVersion;
+				header.mui_TreeStateSize = _o_Tree.mui_TreeStateSize;
+				header.mui_ConditionCacheOffset = _o_Tree.mui_ConditionCacheOffset;
+				header.mui_ConditionCacheCount = _o_Tree.mui_ConditionCacheCount;
+				u32 offset = _Align(sizeof(header));
+				header.mui_NodeCount = (u32)nodes.size();
+				header.mui_NodeOffset = offset;
+				offset = _Align(offset + header.mui_NodeCount * sizeof(BevCompiledNode));
+				header.mui_ConditionCount = (u32)conditions.size();
+				header.mui_ConditionOffset = offset;
+				offset = _Align(offset + header.mui_ConditionCount * sizeof(BevTreeImageCondition));
+				header.mui_InstrCount = (u32)code.size();
+				header.mui_InstrOffset = offset;
+				offset = _Align(offset + header.mui_InstrCount * sizeof(BevPreconditionInstr));
+				header.mui_LeafCount = (u32)leaves.size();
+				header.mui_LeafOffset = offset;
+				offset = _Align(offset + header.mui_LeafCount * sizeof(u32));
+				header.mui_BindingCount = (u32)context.mao_Bindings.size();
+				header.mui_BindingOffset = offset;
+				offset = _Align(offset + header.mui_BindingCount * sizeof(BevTreeImageBinding));
+				header.mui_InitialStateOffset = offset;
+				offset = _Align(offset + header.mui_TreeStateSize);
+				header.mui_StringTableSize = (u32)strings.size();
+				header.mui_StringTableOffset = offset;
+				header.mui_Size = offset + header.mui_StringTableSize;
+
+				//对齐的空隙清零，同样的树每次生成的镜像都一样
+				_o_Data.assign(header.mui_Size, 0);
+				u8 *p = &_o_Data[0];
+				memcpy(p, &header, sizeof(header));
+				memcpy(p + header.mui_NodeOffset, &nodes[0], header.mui_NodeCount * sizeof(BevCompiledNode));
+				if (header.mui_ConditionCount)
+					memcpy(p + header.mui_ConditionOffset, &conditions[0], header.mui_ConditionCount * sizeof(BevTreeImageCondition));
+				if (header.mui_InstrCount)
+					memcpy(p + header.mui_InstrOffset, &code[0], header.mui_InstrCount * sizeof(BevPreconditionInstr));
+				if (header.mui_LeafCount)
+					memcpy(p + header.mui_LeafOffset, &leaves[0], header.mui_LeafCount * sizeof(u32));
+				if (header.mui_BindingCount)
+					memcpy(p + header.mui_BindingOffset, &context.mao_Bindings[0], header.mui_BindingCount * sizeof(BevTreeImageBinding));
+				memcpy(p + header.mui_InitialStateOffset, state.GetData(), header.mui_TreeStateSize);
+				if (header.mui_StringTableSize)
+					memcpy(p + header.mui_StringTableOffset, &strings[0], header.mui_StringTableSize);
+				return true;
+			}
+
+			bool BevTreeImage::_ValidateCode(const BevPreconditionInstr *_o_Code, u32 _ui_Count, u32 _ui_LeafCount)
+			{
+				//AND/OR的Begin要跳到和它配对的End后面，中间正好多压一个值，执行时栈才不会乱
+				u32 auiBegin[k_BLimited_PreconditionStackDepth];
+				u32 auiBeginDepth[k_BLimited_PreconditionStackDepth];
+				u32 sp = 0, bp = 0;
+				for (u32 pc = 0; pc < _ui_Count; ++pc)
+				{
+					const BevPreconditionInstr &instr = _o_Code[pc];
+					switch (instr.me_Op)
+					{
+					case k_BPO_Leaf:
+					case k_BPO_True:
+					case k_BPO_False:
+						if ((instr.me_Op == k_BPO_Leaf && instr.mui_Arg >= _ui_LeafCount) || sp == k_BLimited_PreconditionStackDepth)
+							return false;
+						++sp;
+						break;
+					case k_BPO_Not:
+						if (sp < 1)
+							return false;
+						break;
+					case k_BPO_Xor:
+						if (sp < 2)
+							return false;
+						--sp;
+						break;
+					case k_BPO_AndBegin:
+					case k_BPO_OrBegin:
+						if (sp < 1 || bp == k_BLimited_PreconditionStackDepth)
+							return false;
+						auiBegin[bp] = pc;
+						auiBeginDepth[bp] = sp;
+						++bp;
+						break;
+					case k_BPO_AndEnd:
+					case k_BPO_OrEnd:
+					{
+						if (bp == 0)
+							return false;
+						--bp;
+						const BevPreconditionInstr &begin = _o_Code[auiBegin[bp]];
+						if (begin.me_Op + 1 != instr.me_Op || begin.mui_Arg != pc + 1 || sp != auiBeginDepth[bp] + 1)
+							return false;
+						--sp;
+						break;
+					}
+					default:
+						return false;
+					}
+				}
+				return sp == 1 && bp == 0;
+			}
+
+			bool BevTreeImage::_Validate(const u8 *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, u32 &_ui_ArenaSize)
+			{
+				if (_ui_Size < sizeof(BevTreeImageHeader) || reinterpret_cast<size_t>(_p_Data) % k_BLimited_TreeImageAlignment != 0)
+					return false;
+				const BevTreeImageHeader &header = *_GetSection<BevTreeImageHeader>(_p_Data, 0);
+				if (header.mui_Magic != k_BLimited_TreeImageMagic || header.mui_Version != k_BLimited_TreeImageVersion || header.mui_Size > _ui_Size)
+					return false;
+				if (!_CheckSection(header, header.mui_NodeOffset, header.mui_NodeCount, sizeof(BevCompiledNode)) ||
+					!_CheckSection(header, header.mui_ConditionOffset, header.mui_ConditionCount, sizeof(BevTreeImageCondition)) ||
+					!_CheckSection(header, header.mui_InstrOffset, header.mui_InstrCount, sizeof(BevPreconditionInstr)) ||
+					!_CheckSection(header, header.mui_LeafOffset, header.mui_LeafCount, sizeof(u32)) ||
+					!_CheckSection(header, header.mui_BindingOffset, header.mui_BindingCount, sizeof(BevTreeImageBinding)) ||
+					!_CheckSection(header, header.mui_InitialStateOffset, header.mui_TreeStateSize, 1) ||
+					!_CheckSection(header, header.mui_StringTableOffset, header.mui_StringTableSize, 1))
+					return false;
+				if (header.mui_NodeCount == 0 || header.mui_TreeStateSize == 0 || header.mui_ConditionCount > k_BLimited_InvalidPreconditionIndex ||
+					header.mui_ConditionCacheOffset % sizeof(u32) != 0 || header.mui_ConditionCacheCount > (header.mui_TreeStateSize / sizeof(u32)) ||
+					header.mui_ConditionCacheOffset > header.mui_TreeStateSize - header.mui_ConditionCacheCount * sizeof(u32))
+					return false;
+				const char *strings = _GetSection<char>(_p_Data, header.mui_StringTableOffset);
+				if (header.mui_StringTableSize > 0 && strings[header.mui_StringTableSize - 1] != 0)
+					return false;
+
+				//绑定表：类型都要在本进程注册过
+				const BevTreeImageBinding *bindings = _GetSection<BevTreeImageBinding>(_p_Data, header.mui_BindingOffset);
+				_ui_ArenaSize = 0;
+				for (u32 i = 0; i < header.mui_BindingCount; ++i)
+				{
+					const BevTreeImageBinding &binding = bindings[i];
+					if (!_CheckString(header, binding.mui_Name))
+						return false;
+					const char *name = strings + binding.mui_Name;
+					u32 size = 0;
+					switch (binding.me_Type)
+					{
+					case k_BTIB_Node:
+					{
+						const BevTypeRegistry::NodeType *type = _o_Registry.oFindNode(name);
+						if (!type || !_CheckString(header, binding.mui_DebugName) ||
+							binding.mui_StateSize > header.mui_TreeStateSize || binding.mui_Arg > header.mui_TreeStateSize - binding.mui_StateSize)
+							return false;
+						size = type->mui_Size;
+						break;
+					}
+					case k_BTIB_Precondition:
+					{
+						const BevTypeRegistry::PreconditionType *type = _o_Registry.oFindPrecondition(name);
+						if (!type)
+							return false;
+						size = type->mui_Size;
+						break;
+					}
+					case k_BTIB_Func:
+						if (!_o_Registry.FindFunc(name))
+							return false;
+						size = sizeof(BevNodePreconditionFUNC);
+						break;
+					default:
+						return false;
+					}
+					if (binding.me_Type != k_BTIB_Node && binding.mui_Arg != k_BLimited_InvalidCacheSlot && binding.mui_Arg >= header.mui_ConditionCacheCount)
+						return false;
+					_ui_ArenaSize += BevTreeArena::GetObjectAllocSize(size);
+				}
+
+				//条件：叶子都是条件的绑定，程序的结构完整
+				const BevTreeImageCondition *conditions = _GetSection<BevTreeImageCondition>(_p_Data, header.mui_ConditionOffset);
+				const BevPreconditionInstr *code = _GetSection<BevPreconditionInstr>(_p_Data, header.mui_InstrOffset);
+				const u32 *leaves = _GetSection<u32>(_p_Data, header.mui_LeafOffset);
+				for (u32 i = 0; i < header.mui_ConditionCount; ++i)
+				{
+					const BevTreeImageCondition &condition = conditions[i];
+					if (condition.mui_FirstLeaf > header.mui_LeafCount || condition.mui_LeafCount > header.mui_LeafCount - condition.mui_FirstLeaf ||
+						condition.mui_FirstInstr > header.mui_InstrCount || condition.mui_InstrCount > header.mui_InstrCount - condition.mui_FirstInstr)
+						return false;
+					if (condition.mui_CacheSlot != k_BLimited_InvalidCacheSlot && condition.mui_CacheSlot >= header.mui_ConditionCacheCount)
+						return false;
+					for (u32 j = 0; j < condition.mui_LeafCount; ++j)
+					{
+						u32 leaf = leaves[condition.mui_FirstLeaf + j];
+						if (leaf >= header.mui_BindingCount || bindings[leaf].me_Type == k_BTIB_Node)
+							return false;
+					}
+					if (condition.mui_InstrCount == 0 ? condition.mui_LeafCount != 1 : !_ValidateCode(code + condition.mui_FirstInstr, condition.mui_InstrCount, condition.mui_LeafCount))
+						return false;
+				}
+
+				//节点：孩子都在自己后面，状态都在状态块里面，初始状态里的孩子下标不越界
+				const u8 *initialState = _p_Data + header.mui_InitialStateOffset;
+				const BevCompiledNode *nodes = _GetSection<BevCompiledNode>(_p_Data, header.mui_NodeOffset);
+				for (u32 i = 0; i < header.mui_NodeCount; ++i)
+				{
+					const BevCompiledNode &node = nodes[i];
+					if (node.mui_ChildCount > 0 &&
+						(node.mui_ChildCount > k_BLimited_MaxChildNodeCnt || node.mui_FirstChild <= i || node.mui_FirstChild > header.mui_NodeCount || node.mui_ChildCount > header.mui_NodeCount - node.mui_FirstChild))
+						return false;
+					if (node.mui_PreconditionIndex != k_BLimited_InvalidPreconditionIndex && node.mui_PreconditionIndex >= header.mui_ConditionCount)
+						return false;
+					if (*reinterpret_cast<const u8 *>(&node.mb_Watchable) > 1 || (node.mui_AbortFlags & ~k_BAF_Both) != 0)
+						return false;
+					if (*reinterpret_cast<const u8 *>(&node.mb_HasAbortChildren) > (node.me_NodeType == k_BNT_PrioritySelector ? 1 : 0))
+						return false;
+					u32 stateSize = 0, align = 1;
+					switch (node.me_NodeType)
+					{
+					case k_BNT_PrioritySelector:
+					case k_BNT_NonePrioritySelector:
+						stateSize = sizeof(BevSelectorState);
+						align = sizeof(u32);
+						break;
+					case k_BNT_Sequence:
+						stateSize = sizeof(BevSequenceState);
+						align = sizeof(u16);
+						break;
+					case k_BNT_Parallel:
+						if (node.me_FinishCondition != k_PFC_OR && node.me_FinishCondition != k_PFC_AND)
+							return false;
+						stateSize = node.mui_ChildCount * sizeof(s8);
+						break;
+					case k_BNT_Loop:
+						if (node.mui_ChildCount > 1)
+							return false;
+						stateSize = sizeof(BevLoopState);
+						align = sizeof(s32);
+						break;
+					case k_BNT_Terminal:
+					case k_BNT_Custom:
+						if (node.mui_ChildCount > 0 || node.mui_ObjectIndex >= header.mui_BindingCount || bindings[node.mui_ObjectIndex].me_Type != k_BTIB_Node)
+							return false;
+						break;
+					default:
+						return false;
+					}
+					if (stateSize > header.mui_TreeStateSize || node.mui_StateOffset > header.mui_TreeStateSize - stateSize || node.mui_StateOffset % align != 0)
+						return false;
+					if (node.me_NodeType == k_BNT_Sequence)
+					{
+						u32 index = reinterpret_cast<const BevSequenceState *>(initialState + node.mui_StateOffset)->mui_CurrentNodeIndex;
+						if (index != k_BLimited_InvalidChildNodeIndex && index >= node.mui_ChildCount)
+							return false;
+					}
+					else if (node.me_NodeType == k_BNT_PrioritySelector || node.me_NodeType == k_BNT_NonePrioritySelector)
+					{
+						const BevSelectorState &s = *reinterpret_cast<const BevSelectorState *>(initialState + node.mui_StateOffset);
+						if ((s.mui_CurrentSelectIndex != k_BLimited_InvalidChildNodeIndex && s.mui_CurrentSelectIndex >= node.mui_ChildCount) ||
+							(s.mui_LastSelectIndex != k_BLimited_InvalidChildNodeIndex && s.mui_LastSelectIndex >= node.mui_ChildCount) ||
+							s.mui_KnownFailCount > node.mui_ChildCount || s.mui_ObserveCount > node.mui_ChildCount)
+							return false;
+					}
+				}
+				return true;
+			}
+
+			bool BevTreeImage::_CreateBindings(const u8 *_p_Data, const BevTypeRegistry &_o_Registry, BevTreeArena *_o_Arena)
+			{
+				const BevTreeImageHeader &header = *_GetSection<BevTreeImageHeader>(_p_Data, 0);
+				const BevTreeImageBinding *bindings = _GetSection<BevTreeImageBinding>(_p_Data, header.mui_BindingOffset);
+				const char *strings = _GetSection<char>(_p_Data, header.mui_StringTableOffset);
+
+				std::vector<const BevNodePrecondition *> preconditions(header.mui_BindingCount, (const BevNodePrecondition *)NULL);
+				mo_Tree.mao_Objects.resize(header.mui_BindingCount, NULL);
+				for (u32 i = 0; i < header.mui_BindingCount; ++i)
+				{
+					const BevTreeImageBinding &binding = bindings[i];
+					const char *name = strings + binding.mui_Name;
+					if (binding.me_Type == k_BTIB_Node)
+					{
+						BevNode &node = _o_Registry.oFindNode(name)->mf_Creator(NULL, strings + binding.mui_DebugName, _o_Arena);
+						mao_Nodes.push_back(&node);
+						node.mui_StateOffset = binding.mui_Arg;
+						node.SetNodeID(binding.mui_NodeID);
+						if (node._GetStateSize() != binding.mui_StateSize)
+						{
+							D_Output("BevTreeImage: state size of %s doesn't match the image\n", name);
+							return false;
+						}
+						mo_Tree.mao_Objects[i] = &node;
+						continue;
+					}
+					BevNodePrecondition *precondition;
+					if (binding.me_Type == k_BTIB_Func)
+						precondition = new (_o_Arena) BevNodePreconditionFUNC(_o_Registry.FindFunc(name));
+					else
+						precondition = _o_Registry.oFindPrecondition(name)->mf_Creator(_o_Arena);
+					mao_Preconditions.push_back(precondition);
+					precondition->mui_CacheSlot = binding.mui_Arg;
+					preconditions[i] = precondition;
+				}
+
+				//单个叶子的条件直接调用，其它的程序指向镜像里的指令
+				const BevTreeImageCondition *conditions = _GetSection<BevTreeImageCondition>(_p_Data, header.mui_ConditionOffset);
+				const BevPreconditionInstr *code = _GetSection<BevPreconditionInstr>(_p_Data, header.mui_InstrOffset);
+				const u32 *leaves = _GetSection<u32>(_p_Data, header.mui_LeafOffset);
+				mo_Tree.mao_Preconditions.resize(header.mui_ConditionCount, NULL);
+				mo_Tree.mao_Programs.resize(header.mui_ConditionCount);
+				std::vector<const BevNodePrecondition *> programLeaves;
+				for (u32 i = 0; i < header.mui_ConditionCount; ++i)
+				{
+					const BevTreeImageCondition &condition = conditions[i];
+					if (condition.mui_InstrCount == 0)
+					{
+						mo_Tree.mao_Preconditions[i] = preconditions[leaves[condition.mui_FirstLeaf]];
+						continue;
+					}
+					programLeaves.clear();
+					for (u32 j = 0; j < condition.mui_LeafCount; ++j)
+						programLeaves.push_back(preconditions[leaves[condition.mui_FirstLeaf + j]]);
+					mo_Tree.mao_Programs[i].Attach(code + condition.mui_FirstInstr, condition.mui_InstrCount, programLeaves.empty() ? NULL : &programLeaves[0], condition.mui_LeafCount, condition.mui_CacheSlot);
+				}
+				return true;
+			}
+
+			bool BevTreeImage::Attach(const void *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, BevTreeArena *_o_Arena)
+			{
+				const u8 *data = static_cast<const u8 *>(_p_Data);
+				u32 arenaSize;
+				Detach();
+				if (!_Validate(data, _ui_Size, _o_Registry, arenaSize))
+				{
+					D_Output("BevTreeImage: invalid image\n");
+					return false;
+				}
+				if (_o_Arena)
+					_o_Arena->Reserve(arenaSize);
+				if (!_CreateBindings(data, _o_Registry, _o_Arena))
+				{
+					Detach();
+					return false;
+				}
+
+				const BevTreeImageHeader &header = *_GetSection<BevTreeImageHeader>(data, 0);
+				mo_Tree.mao_NodeData = _GetSection<BevCompiledNode>(data, header.mui_NodeOffset);
+				mo_Tree.mui_NodeCount = header.mui_NodeCount;
+				for (u32 i = 0; i < header.mui_NodeCount; ++i)
+				{
+					if (mo_Tree.mao_NodeData[i].mui_ChildCount > 0)
+						mo_Tree.mui_GroupStartSize += mo_Tree.mao_NodeData[i].mui_ChildCount + 2;
+				}
+				mo_Tree.mui_TreeStateSize = header.mui_TreeStateSize;
+				mo_Tree.mui_ConditionCacheOffset = header.mui_ConditionCacheOffset;
+				mo_Tree.mui_ConditionCacheCount = header.mui_ConditionCacheCount;
+				mo_Tree.mab_InitialState = data + header.mui_InitialStateOffset;
+				return true;
+			}
+
+			void BevTreeImage::BindBlackboard(BevBlackboardLayout &_o_Layout)
+			{
+				for (u32 i = 0; i < mao_Nodes.size(); ++i)
+					mao_Nodes[i]->BindBlackboard(_o_Layout);
+				for (u32 i = 0; i < mao_Preconditions.size(); ++i)
+					mao_Preconditions[i]->BindBlackboard(_o_Layout);
+			}
+
+			void BevTreeImage::Detach()
+			{
+				mo_Tree.Clear();
+				for (u32 i = 0; i < mao_Nodes.size(); ++i)
+					delete mao_Nodes[i];
+				for (u32 i = 0; i < mao_Preconditions.size(); ++i)
+					delete mao_Preconditions[i];
+				mao_Nodes.clear();
+				mao_Preconditions.clear();
+			}
+		}
+	}
+}
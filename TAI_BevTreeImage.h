@@ -0,0 +1,144 @@
+#ifndef __TAI_BEVTREEIMAGE_H__
+#define __TAI_BEVTREEIMAGE_H__
+
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevCompiledTree.h"
+#include "TAI_BevTreeFile.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+//'BEVI'
+#define k_BLimited_TreeImageMagic 0x49564542
+#define k_BLimited_TreeImageVersion 3
+//各段的起点按这个对齐，映射进来的内存是按页对齐的
+#define k_BLimited_TreeImageAlignment 8
+
+			//镜像格式：文件头后面是各段，位置都用相对镜像开头的偏移表示，不含指针，映射到哪个地址都能直接用
+			//  节点段      BevCompiledNode[]，就是BevCompiledTree的节点数组，mui_ObjectIndex是绑定表的下标
+			//  条件段      BevTreeImageCondition[]，和节点的mui_PreconditionIndex对应
+			//  指令段      BevPreconditionInstr[]，各个条件编译好的程序
+			//  叶子段      u32[]，条件用到的叶子在绑定表里的下标
+			//  绑定表      BevTreeImageBinding[]，行为节点和叶子条件这些要执行代码的部分，加载时在本进程里按类名建出来
+			//  初始状态    agent状态块的初始内容，BevAgentState::Reset直接拷贝
+			//  字符串表
+			struct BevTreeImageHeader
+			{
+				u32 mui_Magic;
+				u32 mui_Version;
+				//整个镜像的字节数
+				u32 mui_Size;
+				u32 mui_TreeStateSize;
+				u32 mui_ConditionCacheOffset;
+				u32 mui_ConditionCacheCount;
+				u32 mui_NodeCount;
+				u32 mui_NodeOffset;
+				u32 mui_ConditionCount;
+				u32 mui_ConditionOffset;
+				u32 mui_InstrCount;
+				u32 mui_InstrOffset;
+				u32 mui_LeafCount;
+				u32 mui_LeafOffset;
+				u32 mui_BindingCount;
+				u32 mui_BindingOffset;
+				u32 mui_InitialStateOffset;
+				u32 mui_StringTableSize;
+				u32 mui_StringTableOffset;
+				u32 mui_Reserved;
+			};
+
+			//一个节点的前提条件：mui_InstrCount为0时是单个叶子条件（叶子段里只有一个），直接调用
+			struct BevTreeImageCondition
+			{
+				u32 mui_FirstInstr;
+				u32 mui_InstrCount;
+				u32 mui_FirstLeaf;
+				u32 mui_LeafCount;
+				//整个条件的缓存槽位
+				u32 mui_CacheSlot;
+			};
+
+			enum E_BevTreeImageBindingType
+			{
+				k_BTIB_Node = 0,
+				k_BTIB_Precondition,
+				k_BTIB_Func,
+			};
+
+			struct BevTreeImageBinding
+			{
+				//E_BevTreeImageBindingType
+				u8 me_Type;
+				u8 mab_Reserved[3];
+				//类名或者函数名，在字符串表里的偏移
+				u32 mui_Name;
+				//节点的名字，条件没有
+				u32 mui_DebugName;
+				//节点是状态块里的偏移，条件是缓存槽位
+				u32 mui_Arg;
+				//节点的状态大小，加载时和本进程建出来的节点对一下，对不上说明代码和镜像的版本不一致
+				u32 mui_StateSize;
+				//节点ID（BevNode::GetNodeID），执行轨迹里用它认节点，条件没有
+				u32 mui_NodeID;
+			};
+
+			//把编译好的树存成上面的镜像，镜像可以放在文件里用MappedFile只读映射，多个进程共享同一份物理页
+			//Attach时不拷贝也不解析节点数组、条件程序和初始状态，直接在镜像上执行；
+			//每个进程只需要按绑定表建出行为节点和叶子条件（BevTypeRegistry里注册的类型），控制节点和组合条件都不用建
+			//用GetTree()得到的BevCompiledTree执行，agent状态用BevAgentState(image.GetTree())创建
+			//自定义控制节点和并发执行的并行节点要靠原来的孩子对象执行，不能存成镜像
+			class BevTreeImage
+			{
+			public:
+				BevTreeImage()
+				{
+				}
+				~BevTreeImage()
+				{
+					Detach();
+				}
+
+				//_o_Tree要是从节点树编译出来的（要用原来的树算初始状态）
+				static bool Build(const BevCompiledTree &_o_Tree, const BevTypeRegistry &_o_Registry, std::vector<u8> &_o_Data);
+
+				//镜像内存要按k_BLimited_TreeImageAlignment对齐，并且比Detach活得久；行为节点和叶子条件从_o_Arena里分配（可以为NULL）
+				//镜像不合法、类型没注册或者和本进程的代码对不上时返回false
+				bool Attach(const void *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, BevTreeArena *_o_Arena = NULL);
+				void Detach();
+
+				bool IsAttached() const
+				{
+					return mo_Tree.GetNodeCount() > 0;
+				}
+				const BevCompiledTree &GetTree() const
+				{
+					return mo_Tree;
+				}
+				//镜像里的行为节点和叶子条件是加载时新建的，要重新绑定黑板key；在Attach之后、用这个布局创建BevBlackboard之前调用
+				void BindBlackboard(BevBlackboardLayout &_o_Layout);
+
+			private:
+				BevTreeImage(const BevTreeImage &);
+				BevTreeImage &operator=(const BevTreeImage &);
+
+				struct BuildContext;
+				static u32 _AddPreconditionBinding(BuildContext &_o_Context, const BevNodePrecondition *_o_Precondition);
+				static bool _Validate(const u8 *_p_Data, u32 _ui_Size, const BevTypeRegistry &_o_Registry, u32 &_ui_ArenaSize);
+				static bool _ValidateCode(const BevPreconditionInstr *_o_Code, u32 _ui_Count, u32 _ui_LeafCount);
+				bool _CreateBindings(const u8 *_p_Data, const BevTypeRegistry &_o_Registry, BevTreeArena *_o_Arena);
+
+			private:
+				BevCompiledTree mo_Tree;
+				//本进程建出来的对象，Detach时删掉
+				std::vector<BevNode *> mao_Nodes;
+				std::vector<BevNodePrecondition *> mao_Preconditions;
+			};
+		}
+	}
+}
+
+#endif
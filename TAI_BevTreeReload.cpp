@@ -0,0 +1,235 @@
+#include "TAI_BevTreeReload.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			BevTreeReloader::BevTreeReloader()
+				: mo_OldRoot(NULL), mo_NewRoot(NULL), mo_State(NULL), mo_Input(NULL), mb_Moving(false),
+				  mo_OldActiveNode(NULL), mo_OldLastActiveNode(NULL), mo_NewActiveNode(NULL), mo_NewLastActiveNode(NULL)
+			{
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+			}
+
+			void BevTreeReloader::Begin(const BevNode &_o_OldRoot, const BevNode &_o_NewRoot)
+			{
+				D_CHECK(_o_OldRoot.GetTreeStateSize() > 0 && _o_NewRoot.GetTreeStateSize() > 0);
+				mo_OldRoot = &_o_OldRoot;
+				mo_NewRoot = &_o_NewRoot;
+				mao_Agents.clear();
+				mab_OldData.resize(_o_OldRoot.GetTreeStateSize());
+				memset(&mo_Stats, 0, sizeof(mo_Stats));
+			}
+
+			void BevTreeReloader::AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input)
+			{
+				D_CHECK(_o_State.IsRoot(mo_OldRoot));
+				mao_Agents.push_back(Agent(&_o_State, _o_Input));
+			}
+
+			bool BevTreeReloader::RemoveAgent(const BevAgentState &_o_State)
+			{
+				for (u32 i = 0; i < mao_Agents.size(); ++i)
+				{
+					if (mao_Agents[i].mo_State == &_o_State)
+					{
+						mao_Agents[i] = mao_Agents.back();
+						mao_Agents.pop_back();
+						return true;
+					}
+				}
+				return false;
+			}
+
+			bool BevTreeReloader::Step(u32 _ui_MaxAgents)
+			{
+				for (u32 i = 0; i < _ui_MaxAgents && !mao_Agents.empty(); ++i)
+				{
+					Agent agent = mao_Agents.back();
+					mao_Agents.pop_back();
+					ReloadAgent(*agent.mo_State, agent.mo_Input);
+				}
+				return mao_Agents.empty();
+			}
+
+			bool BevTreeReloader::ReloadAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input)
+			{
+				if (!mo_OldRoot || !_o_State.IsRoot(mo_OldRoot))
+					return false;
+				mo_State = &_o_State;
+				mo_Input = &_o_Input;
+				mo_OldActiveNode = _o_State.oGetActiveNode();
+				mo_OldLastActiveNode = _o_State.oGetLastActiveNode();
+				mo_NewActiveNode = NULL;
+				mo_NewLastActiveNode = NULL;
+
+				//第一遍：agent还在旧树上，_DoExit拿到的是agent自己的状态
+				mb_Moving = false;
+				_VisitNode(*mo_OldRoot, *mo_NewRoot);
+
+				//第二遍：换到新树上，从旧状态的拷贝里搬
+				memcpy(&mab_OldData[0], _o_State.GetData(), mab_OldData.size());
+				_o_State.Rebind(*mo_NewRoot);
+				mb_Moving = true;
+				_VisitNode(*mo_OldRoot, *mo_NewRoot);
+				_o_State.SetActiveNode(mo_NewLastActiveNode);
+				_o_State.SetActiveNode(mo_NewActiveNode);
+
+				mo_State = NULL;
+				mo_Input = NULL;
+				++mo_Stats.mui_ReloadedCount;
+				return true;
+			}
+
+			bool BevTreeReloader::_IsSameNode(const BevNode &_o_OldNode, const BevNode &_o_NewNode) const
+			{
+				if (_o_OldNode.GetNodeType() != _o_NewNode.GetNodeType())
+					return false;
+				const char *oldType = _o_OldNode.GetTypeName();
+				const char *newType = _o_NewNode.GetTypeName();
+				if ((oldType || newType) && (!oldType || !newType || strcmp(oldType, newType) != 0))
+					return false;
+				//并行节点的状态按孩子逐个搬
+				if (_o_NewNode.GetNodeType() == k_BNT_Parallel)
+					return true;
+				if (_o_OldNode._GetStateSize() != _o_NewNode._GetStateSize())
+					return false;
+				//自定义节点的状态里怎么记孩子不知道，孩子要一个不差才能原样搬
+				if (_o_NewNode.GetNodeType() == k_BNT_Custom)
+				{
+					if (_o_OldNode.mul_ChildNodeCount != _o_NewNode.mul_ChildNodeCount)
+						return false;
+					for (int i = 0; i < _o_NewNode.mul_ChildNodeCount; ++i)
+					{
+						if (_o_OldNode.mao_ChildNodeList[i]->mui_NodeID != _o_NewNode.mao_ChildNodeList[i]->mui_NodeID)
+							return false;
+					}
+				}
+				return true;
+			}
+
+			u32 BevTreeReloader::_FindChild(const BevNode &_o_NewParent, const BevNode &_o_OldChild) const
+			{
+				u32 found = k_BLimited_InvalidChildNodeIndex;
+				for (int i = 0; i < _o_NewParent.mul_ChildNodeCount; ++i)
+				{
+					if (_o_NewParent.mao_ChildNodeList[i]->mui_NodeID != _o_OldChild.mui_NodeID)
+						continue;
+					if (found != k_BLimited_InvalidChildNodeIndex)
+						return k_BLimited_InvalidChildNodeIndex;
+					found = (u32)i;
+				}
+				return found;
+			}
+
+			void BevTreeReloader::_ExitNode(const BevNode &_o_OldNode)
+			{
+				if (mb_Moving)
+					return;
+				_o_OldNode.Transition(*mo_State, *mo_Input);
+				++mo_Stats.mui_ExitedNodeCount;
+			}
+
+			u32 BevTreeReloader::_VisitChild(const BevNode &_o_OldNode, const BevNode &_o_NewNode, u32 _ui_Index)
+			{
+				if (_ui_Index >= (u32)_o_OldNode.mul_ChildNodeCount)
+					return k_BLimited_InvalidChildNodeIndex;
+				const BevNode &oldChild = *_o_OldNode.mao_ChildNodeList[_ui_Index];
+				u32 index = _FindChild(_o_NewNode, oldChild);
+				if (index != k_BLimited_InvalidChildNodeIndex && _IsSameNode(oldChild, *_o_NewNode.mao_ChildNodeList[index]))
+				{
+					_VisitNode(oldChild, *_o_NewNode.mao_ChildNodeList[index]);
+					return index;
+				}
+				_ExitNode(oldChild);
+				return k_BLimited_InvalidChildNodeIndex;
+			}
+
+			void BevTreeReloader::_VisitNode(const BevNode &_o_OldNode, const BevNode &_o_NewNode)
+			{
+				if (&_o_OldNode == mo_OldRoot && !_IsSameNode(_o_OldNode, _o_NewNode))
+				{
+					_ExitNode(_o_OldNode);
+					return;
+				}
+				//第一遍只要顺着同样的路径走下去，第二遍的状态都从旧状态的拷贝里读
+				const u8 *src = &mab_OldData[0] + _o_OldNode.mui_StateOffset;
+				u8 *dst = mo_State->GetData() + _o_NewNode.mui_StateOffset;
+				if (mb_Moving)
+				{
+					++mo_Stats.mui_KeptNodeCount;
+					if (&_o_OldNode == mo_OldActiveNode)
+						mo_NewActiveNode = &_o_NewNode;
+					if (&_o_OldNode == mo_OldLastActiveNode)
+						mo_NewLastActiveNode = &_o_NewNode;
+				}
+				else
+				{
+					src = mo_State->GetData() + _o_OldNode.mui_StateOffset;
+				}
+
+				switch (_o_NewNode.GetNodeType())
+				{
+				case k_BNT_PrioritySelector:
+				case k_BNT_NonePrioritySelector:
+				{
+					//只有正在运行的孩子有状态，评估过的结果不沿用
+					u32 index = _VisitChild(_o_OldNode, _o_NewNode, reinterpret_cast<const BevSelectorState *>(src)->mui_LastSelectIndex);
+					if (mb_Moving)
+					{
+						BevSelectorState &s = *reinterpret_cast<BevSelectorState *>(dst);
+						s.mui_CurrentSelectIndex = (u16)index;
+						s.mui_LastSelectIndex = (u16)index;
+					}
+					break;
+				}
+				case k_BNT_Sequence:
+				{
+					u32 index = _VisitChild(_o_OldNode, _o_NewNode, reinterpret_cast<const BevSequenceState *>(src)->mui_CurrentNodeIndex);
+					if (mb_Moving)
+						reinterpret_cast<BevSequenceState *>(dst)->mui_CurrentNodeIndex = (u16)index;
+					break;
+				}
+				case k_BNT_Loop:
+					_VisitChild(_o_OldNode, _o_NewNode, 0);
+					if (mb_Moving)
+						memcpy(dst, src, sizeof(BevLoopState));
+					break;
+				case k_BNT_Parallel:
+				{
+					//每个孩子都在运行，新加的孩子从头开始
+					const s8 *oldStatus = reinterpret_cast<const s8 *>(src);
+					s8 *newStatus = reinterpret_cast<s8 *>(dst);
+					for (int i = 0; i < _o_OldNode.mul_ChildNodeCount; ++i)
+					{
+						u32 index = _VisitChild(_o_OldNode, _o_NewNode, (u32)i);
+						if (mb_Moving && index != k_BLimited_InvalidChildNodeIndex)
+							newStatus[index] = oldStatus[i];
+					}
+					break;
+				}
+				case k_BNT_Terminal:
+					if (mb_Moving)
+						memcpy(dst, src, _o_NewNode._GetStateSize());
+					break;
+				default:
+					//自定义节点：孩子一一对应（见_IsSameNode），每个孩子分别搬
+					if (mb_Moving)
+						memcpy(dst, src, _o_NewNode._GetStateSize());
+					for (int i = 0; i < _o_NewNode.mul_ChildNodeCount; ++i)
+					{
+						const BevNode &oldChild = *_o_OldNode.mao_ChildNodeList[i];
+						const BevNode &newChild = *_o_NewNode.mao_ChildNodeList[i];
+						if (_IsSameNode(oldChild, newChild))
+							_VisitNode(oldChild, newChild);
+						else
+							_ExitNode(oldChild);
+					}
+					break;
+				}
+			}
+		}
+	}
+}
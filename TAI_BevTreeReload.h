@@ -0,0 +1,99 @@
+#ifndef __TAI_BEVTREERELOAD_H__
+#define __TAI_BEVTREERELOAD_H__
+
+#include <vector>
+#include "TAI_BevTree.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			//热重载：把agent从旧树换到新树上，正在运行的行为不会被打断
+			//  从根节点开始，同一个父节点下ID相同、类型相同的孩子算同一个节点，状态原样搬过去，
+			//  控制节点记的孩子下标换成新树里的下标（节点ID见BevNode::SetNodeID）
+			//  旧树上正在运行、新树里找不到（或者类型、状态大小变了）的节点，在搬之前转移掉，行为节点会收到_DoExit
+			//  新加的节点是初始状态，选择节点下一次评估会重新选一遍
+			//agent很多时分帧做：Begin之后用AddAgent排队，每帧调用Step搬一部分，
+			//还没搬到的agent照常在旧树上tick，所以IsDone之前两棵树都不能删
+			//搬完的agent IsRoot(新根节点)为true；调度器里用编译后的树的agent要RemoveAgent后用新树编译的结果重新AddAgent
+			class BevTreeReloader
+			{
+			public:
+				struct Stats
+				{
+					u32 mui_ReloadedCount;
+					//搬过去的节点状态数
+					u32 mui_KeptNodeCount;
+					//转移掉的节点数
+					u32 mui_ExitedNodeCount;
+				};
+
+				BevTreeReloader();
+
+				//两棵树都要BuildStateLayout过，之前排队的agent会清掉
+				void Begin(const BevNode &_o_OldRoot, const BevNode &_o_NewRoot);
+				//_o_Input在搬这个agent时传给_DoExit；排队的agent在搬完之前不能删，要删先RemoveAgent
+				void AddAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input);
+				bool RemoveAgent(const BevAgentState &_o_State);
+
+				//最多搬_ui_MaxAgents个，全部搬完返回true
+				bool Step(u32 _ui_MaxAgents);
+				bool IsDone() const
+				{
+					return mao_Agents.empty();
+				}
+				u32 GetPendingCount() const
+				{
+					return (u32)mao_Agents.size();
+				}
+				const Stats &GetStats() const
+				{
+					return mo_Stats;
+				}
+
+				//不排队，马上搬一个agent；不在旧树上的返回false
+				bool ReloadAgent(BevAgentState &_o_State, const BevNodeInputParam &_o_Input);
+
+			private:
+				struct Agent
+				{
+					Agent(BevAgentState *_o_State, const BevNodeInputParam &_o_Input)
+						: mo_State(_o_State), mo_Input(_o_Input)
+					{
+					}
+					BevAgentState *mo_State;
+					BevNodeInputParam mo_Input;
+				};
+
+				bool _IsSameNode(const BevNode &_o_OldNode, const BevNode &_o_NewNode) const;
+				//新父节点下和旧节点ID相同的孩子，没有或者不止一个时返回k_BLimited_InvalidChildNodeIndex
+				u32 _FindChild(const BevNode &_o_NewParent, const BevNode &_o_OldChild) const;
+				//两遍用同一套对应关系：第一遍在旧状态上转移掉对不上的节点，第二遍把对得上的状态搬到新状态里
+				void _VisitNode(const BevNode &_o_OldNode, const BevNode &_o_NewNode);
+				u32 _VisitChild(const BevNode &_o_OldNode, const BevNode &_o_NewNode, u32 _ui_Index);
+				void _ExitNode(const BevNode &_o_OldNode);
+
+			private:
+				const BevNode *mo_OldRoot;
+				const BevNode *mo_NewRoot;
+				std::vector<Agent> mao_Agents;
+				Stats mo_Stats;
+
+				//正在搬的agent
+				BevAgentState *mo_State;
+				const BevNodeInputParam *mo_Input;
+				bool mb_Moving;
+				//第二遍时旧状态已经拷到这里，mo_State已经换到新树上
+				std::vector<u8> mab_OldData;
+				const BevNode *mo_OldActiveNode;
+				const BevNode *mo_OldLastActiveNode;
+				const BevNode *mo_NewActiveNode;
+				const BevNode *mo_NewLastActiveNode;
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,325 @@
+#include "TAI_BevUtilitySelector.h"
+#include <math.h>
+#include <algorithm>
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+			namespace
+			{
+				//写成比较加选择，循环里能编译成min/max指令
+				D_Inline f32 _Clamp01(f32 _f_Value)
+				{
+					_f_Value = _f_Value < 0.f ? 0.f : _f_Value;
+					return _f_Value > 1.f ? 1.f : _f_Value;
+				}
+
+				//孩子只在这么多个以内时分数和顺序放在栈上，多了去堆上申请
+				const u32 kInlineChildCount = 16;
+				//批量打分时栈上留给所有孩子分数的空间，孩子多了每段的agent就少一些
+				const u32 kInlineBatchScoreCount = 4096;
+
+				//加上惯性的分数从高到低，一样高的前面的孩子优先
+				struct ScoreOrder
+				{
+					ScoreOrder(const f32 *_af_Scores, u32 _ui_Stride, u32 _ui_Running, f32 _f_Bonus)
+						: maf_Scores(_af_Scores), mui_Stride(_ui_Stride), mui_Running(_ui_Running), mf_Bonus(_f_Bonus)
+					{
+					}
+					f32 GetScore(u32 _ui_ChildIndex) const
+					{
+						f32 score = maf_Scores[_ui_ChildIndex * mui_Stride];
+						return _ui_ChildIndex == mui_Running ? score * mf_Bonus : score;
+					}
+					bool operator()(u32 _ui_A, u32 _ui_B) const
+					{
+						f32 a = GetScore(_ui_A);
+						f32 b = GetScore(_ui_B);
+						return a > b || (a == b && _ui_A < _ui_B);
+					}
+					const f32 *maf_Scores;
+					u32 mui_Stride;
+					u32 mui_Running;
+					f32 mf_Bonus;
+				};
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevResponseCurve
+			//-------------------------------------------------------------------------------------
+			BevResponseCurve::BevResponseCurve(E_BevCurveType _e_Type, f32 _f_Min, f32 _f_Max, f32 _f_Slope, f32 _f_Exponent, f32 _f_ShiftX, f32 _f_ShiftY)
+				: me_Type(_e_Type), mf_Min(_f_Min), mf_InvRange(_f_Max != _f_Min ? 1.f / (_f_Max - _f_Min) : 0.f), mf_Slope(_f_Slope), mf_Exponent(_f_Exponent), mf_ShiftX(_f_ShiftX), mf_ShiftY(_f_ShiftY)
+			{
+			}
+
+			void BevResponseCurve::EvaluateBatch(const f32 *_af_Values, f32 *_af_Outputs, u32 _ui_Count) const
+			{
+				const f32 lo = mf_Min;
+				const f32 scale = mf_InvRange;
+				const f32 m = mf_Slope;
+				const f32 k = mf_Exponent;
+				const f32 c = mf_ShiftX;
+				const f32 b = mf_ShiftY;
+				switch (me_Type)
+				{
+				case k_BCT_Linear:
+					for (u32 i = 0; i < _ui_Count; ++i)
+						_af_Outputs[i] = _Clamp01(m * (_Clamp01((_af_Values[i] - lo) * scale) - c) + b);
+					break;
+				case k_BCT_Polynomial:
+				{
+					//常用的平方、立方不走powf
+					int n = (int)k;
+					if ((f32)n == k && n >= 1 && n <= 3)
+					{
+						for (u32 i = 0; i < _ui_Count; ++i)
+						{
+							f32 x = _Clamp01((_af_Values[i] - lo) * scale) - c;
+							x = x < 0.f ? 0.f : x;
+							f32 y = n == 1 ? x : (n == 2 ? x * x : x * x * x);
+							_af_Outputs[i] = _Clamp01(m * y + b);
+						}
+					}
+					else
+					{
+						for (u32 i = 0; i < _ui_Count; ++i)
+						{
+							f32 x = _Clamp01((_af_Values[i] - lo) * scale) - c;
+							_af_Outputs[i] = _Clamp01(m * powf(x < 0.f ? 0.f : x, k) + b);
+						}
+					}
+					break;
+				}
+				case k_BCT_Logistic:
+					for (u32 i = 0; i < _ui_Count; ++i)
+					{
+						f32 x = _Clamp01((_af_Values[i] - lo) * scale) - c;
+						_af_Outputs[i] = _Clamp01(m / (1.f + expf(-k * x)) + b);
+					}
+					break;
+				default:
+					D_CHECK(0);
+					for (u32 i = 0; i < _ui_Count; ++i)
+						_af_Outputs[i] = 0.f;
+					break;
+				}
+			}
+
+			//-------------------------------------------------------------------------------------
+			// BevNodeUtilitySelector
+			//-------------------------------------------------------------------------------------
+			BevNodeUtilitySelector &BevNodeUtilitySelector::AddConsideration(int _i_ChildIndex, const char *_z_Key, const BevResponseCurve &_o_Curve)
+			{
+				D_CHECK(_i_ChildIndex >= 0 && _i_ChildIndex < k_BLimited_MaxChildNodeCnt);
+				if ((int)mao_Scorers.size() <= _i_ChildIndex)
+					mao_Scorers.resize(_i_ChildIndex + 1);
+				Consideration consideration(_z_Key, _o_Curve);
+				WatchKey(consideration.mo_Key.GetKey());
+				mao_Scorers[_i_ChildIndex].mao_Considerations.push_back(consideration);
+				return (*this);
+			}
+
+			BevNodeUtilitySelector &BevNodeUtilitySelector::SetWeight(int _i_ChildIndex, f32 _f_Weight)
+			{
+				D_CHECK(_i_ChildIndex >= 0 && _i_ChildIndex < k_BLimited_MaxChildNodeCnt);
+				if ((int)mao_Scorers.size() <= _i_ChildIndex)
+					mao_Scorers.resize(_i_ChildIndex + 1);
+				mao_Scorers[_i_ChildIndex].mf_Weight = _f_Weight;
+				return (*this);
+			}
+
+			void BevNodeUtilitySelector::_BindBlackboard(BevBlackboardLayout &_o_Layout) const
+			{
+				//打分项设置给了不存在的孩子
+				D_CHECK(mao_Scorers.size() <= (u32)mul_ChildNodeCount);
+				for (u32 i = 0; i < mao_Scorers.size(); ++i)
+				{
+					const std::vector<Consideration> &considerations = mao_Scorers[i].mao_Considerations;
+					for (u32 j = 0; j < considerations.size(); ++j)
+						considerations[j].mo_Key.Bind(_o_Layout);
+				}
+			}
+
+			f32 BevNodeUtilitySelector::Score(int _i_ChildIndex, const BevAgentState &state) const
+			{
+				D_CHECK(_bCheckIndex(_i_ChildIndex));
+				if (_i_ChildIndex >= (int)mao_Scorers.size())
+					return 1.f;
+				const ChildScorer &scorer = mao_Scorers[_i_ChildIndex];
+				f32 score = scorer.mf_Weight;
+				if (scorer.mao_Considerations.empty())
+					return score;
+				//和ScoreBatch的乘法顺序一样，两边算出来的分数相同
+				const BevBlackboard &blackboard = state.oGetBlackboard();
+				for (u32 j = 0; j < scorer.mao_Considerations.size(); ++j)
+				{
+					const Consideration &consideration = scorer.mao_Considerations[j];
+					score *= consideration.mo_Curve.Evaluate(blackboard.Get(consideration.mo_Key));
+				}
+				return score;
+			}
+
+			void BevNodeUtilitySelector::ScoreBatch(int _i_ChildIndex, BevAgentState *const *_o_Agents, const u32 *_ui_Indices, u32 _ui_Count, f32 *_af_Scores) const
+			{
+				const u8 *data[k_BLimited_UtilityBatchSize];
+				for (u32 begin = 0; begin < _ui_Count; begin += k_BLimited_UtilityBatchSize)
+				{
+					u32 count = _ui_Count - begin < k_BLimited_UtilityBatchSize ? _ui_Count - begin : k_BLimited_UtilityBatchSize;
+					for (u32 i = 0; i < count; ++i)
+						data[i] = _o_Agents[_ui_Indices[begin + i]]->oGetBlackboard().GetData();
+					_ScoreChunk(_i_ChildIndex, data, count, _af_Scores + begin);
+				}
+			}
+
+			void BevNodeUtilitySelector::_ScoreChunk(int _i_ChildIndex, const u8 *const *_ab_Data, u32 _ui_Count, f32 *_af_Scores) const
+			{
+				D_CHECK(_bCheckIndex(_i_ChildIndex) && _ui_Count <= k_BLimited_UtilityBatchSize);
+				const ChildScorer *scorer = _i_ChildIndex < (int)mao_Scorers.size() ? &mao_Scorers[_i_ChildIndex] : NULL;
+				f32 weight = scorer ? scorer->mf_Weight : 1.f;
+				for (u32 i = 0; i < _ui_Count; ++i)
+					_af_Scores[i] = weight;
+				if (!scorer)
+					return;
+
+				//每一项先把所有agent的值按偏移收集到连续数组里，再整段过曲线、乘到分数上
+				f32 values[k_BLimited_UtilityBatchSize];
+				for (u32 j = 0; j < scorer->mao_Considerations.size(); ++j)
+				{
+					const Consideration &consideration = scorer->mao_Considerations[j];
+					D_CHECK(consideration.mo_Key.IsBound());
+					u32 offset = consideration.mo_Key.GetOffset();
+					for (u32 i = 0; i < _ui_Count; ++i)
+						values[i] = *reinterpret_cast<const f32 *>(_ab_Data[i] + offset);
+					consideration.mo_Curve.EvaluateBatch(values, values, _ui_Count);
+					for (u32 i = 0; i < _ui_Count; ++i)
+						_af_Scores[i] *= values[i];
+				}
+			}
+
+			bool BevNodeUtilitySelector::_DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const
+			{
+				f32 afInlineScores[kInlineChildCount];
+				std::vector<f32> afHeapScores;
+				f32 *afScores = afInlineScores;
+				if ((u32)mul_ChildNodeCount > kInlineChildCount)
+				{
+					afHeapScores.resize(mul_ChildNodeCount);
+					afScores = &afHeapScores[0];
+				}
+				//分数比0高的才算，一样高的保留前面的；存下来的分数不带惯性
+				u32 running = _GetState<State>(state).mui_LastSelectIndex;
+				u32 best = k_BLimited_InvalidChildNodeIndex;
+				f32 bestScore = 0.f;
+				for (int i = 0; i < mul_ChildNodeCount; ++i)
+				{
+					afScores[i] = Score(i, state);
+					f32 score = (u32)i == running ? afScores[i] * (1.f + mf_Momentum) : afScores[i];
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = i;
+					}
+				}
+				return _SelectFrom(state, input, afScores, 1, best);
+			}
+
+			bool BevNodeUtilitySelector::_SelectFrom(BevAgentState &state, const BevNodeInputParam &input, const f32 *_af_Scores, u32 _ui_Stride, u32 _ui_Best) const
+			{
+				State &s = _GetState<State>(state);
+				s.mui_CurrentSelectIndex = k_BLimited_InvalidChildNodeIndex;
+				if (_ui_Best == k_BLimited_InvalidChildNodeIndex)
+					return false;
+				if (mao_ChildNodeList[_ui_Best]->Evaluate(state, input))
+				{
+					s.mui_CurrentSelectIndex = (u16)_ui_Best;
+					return true;
+				}
+
+				//分数最高的没通过，很少发生；剩下分数比0高的孩子按算好的分数排序，依次往下试
+				u32 auiInlineOrder[kInlineChildCount];
+				std::vector<u32> auiHeapOrder;
+				u32 *auiOrder = auiInlineOrder;
+				if ((u32)mul_ChildNodeCount > kInlineChildCount)
+				{
+					auiHeapOrder.resize(mul_ChildNodeCount);
+					auiOrder = &auiHeapOrder[0];
+				}
+				ScoreOrder order(_af_Scores, _ui_Stride, s.mui_LastSelectIndex, 1.f + mf_Momentum);
+				u32 count = 0;
+				for (u32 i = 0; i < (u32)mul_ChildNodeCount; ++i)
+				{
+					if (i != _ui_Best && order.GetScore(i) > 0.f)
+						auiOrder[count++] = i;
+				}
+				std::sort(auiOrder, auiOrder + count, order);
+				for (u32 i = 0; i < count; ++i)
+				{
+					if (mao_ChildNodeList[auiOrder[i]]->Evaluate(state, input))
+					{
+						s.mui_CurrentSelectIndex = (u16)auiOrder[i];
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void BevNodeUtilitySelector::_DoEvaluateBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+			{
+				const u8 *data[k_BLimited_UtilityBatchSize];
+				u32 running[k_BLimited_UtilityBatchSize];
+				f32 bestScores[k_BLimited_UtilityBatchSize];
+				u32 bests[k_BLimited_UtilityBatchSize];
+				//一段agent所有孩子的分数都留着，第i个孩子的在第i行，最高的没通过时不用重新打分
+				//孩子多的时候缩短每段的长度，让分数放得进栈上的空间，一段一个agent都放不下才去堆上申请
+				u32 childCount = mul_ChildNodeCount > 0 ? (u32)mul_ChildNodeCount : 1;
+				u32 chunkSize = kInlineBatchScoreCount / childCount;
+				chunkSize = chunkSize > k_BLimited_UtilityBatchSize ? k_BLimited_UtilityBatchSize : (chunkSize > 0 ? chunkSize : 1);
+				f32 afInlineScores[kInlineBatchScoreCount];
+				std::vector<f32> afHeapScores;
+				f32 *afScores = afInlineScores;
+				if (childCount * chunkSize > kInlineBatchScoreCount)
+				{
+					afHeapScores.resize(childCount * chunkSize);
+					afScores = &afHeapScores[0];
+				}
+				f32 bonus = 1.f + mf_Momentum;
+				for (u32 begin = 0; begin < _ui_Count; begin += chunkSize)
+				{
+					u32 count = _ui_Count - begin < chunkSize ? _ui_Count - begin : chunkSize;
+					const u32 *ids = _ui_Indices + begin;
+					//黑板和正在运行的孩子每个agent只取一次
+					for (u32 k = 0; k < count; ++k)
+					{
+						BevAgentState &agent = *_o_Agents[ids[k]];
+						data[k] = agent.oGetBlackboard().GetData();
+						running[k] = _GetState<State>(agent).mui_LastSelectIndex;
+						bestScores[k] = 0.f;
+						bests[k] = k_BLimited_InvalidChildNodeIndex;
+					}
+					//一个孩子一个孩子地给整段agent打分，和_DoEvaluate一样只留严格更高的
+					for (int i = 0; i < mul_ChildNodeCount; ++i)
+					{
+						f32 *scores = afScores + i * chunkSize;
+						_ScoreChunk(i, data, count, scores);
+						for (u32 k = 0; k < count; ++k)
+						{
+							f32 score = running[k] == (u32)i ? scores[k] * bonus : scores[k];
+							bool bTake = score > bestScores[k];
+							bestScores[k] = bTake ? score : bestScores[k];
+							bests[k] = bTake ? (u32)i : bests[k];
+						}
+					}
+					//孩子的评估还是逐个agent走原来的树
+					for (u32 k = 0; k < count; ++k)
+					{
+						u32 id = ids[k];
+						_ab_Results[begin + k] = _SelectFrom(*_o_Agents[id], _o_Inputs[id], afScores + k, chunkSize, bests[k]) ? 1 : 0;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#ifndef __TAI_BEVUTILITYSELECTOR_H__
+#define __TAI_BEVUTILITYSELECTOR_H__
+
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevBlackboard.h"
+
+namespace TsiU
+{
+	namespace AI
+	{
+		namespace BehaviorTree
+		{
+//批量打分时一次处理的agent数量，中间结果放在栈上
+#ifndef k_BLimited_UtilityBatchSize
+#define k_BLimited_UtilityBatchSize 64
+#endif
+
+			//响应曲线的形状，x是按[min, max]归一化到[0, 1]的输入
+			enum E_BevCurveType
+			{
+				//y = m * (x - c) + b
+				k_BCT_Linear = 0,
+				//y = m * (x - c)^k + b，x - c小于0时按0算
+				k_BCT_Polynomial,
+				//y = m / (1 + e^(-k * (x - c))) + b
+				k_BCT_Logistic,
+			};
+
+			//把黑板上的一个值映射成[0, 1]之间的分数
+			class BevResponseCurve
+			{
+			public:
+				BevResponseCurve(E_BevCurveType _e_Type, f32 _f_Min, f32 _f_Max, f32 _f_Slope = 1.f, f32 _f_Exponent = 1.f, f32 _f_ShiftX = 0.f, f32 _f_ShiftY = 0.f);
+
+				f32 Evaluate(f32 _f_Value) const
+				{
+					f32 result;
+					EvaluateBatch(&_f_Value, &result, 1);
+					return result;
+				}
+				//_af_Outputs[i] = Evaluate(_af_Values[i])，两个数组可以是同一个
+				//类型的分支在循环外面，线性和多项式（k是整数时）的循环编译器可以展开成SIMD指令
+				void EvaluateBatch(const f32 *_af_Values, f32 *_af_Outputs, u32 _ui_Count) const;
+
+				E_BevCurveType GetType() const
+				{
+					return me_Type;
+				}
+
+			private:
+				E_BevCurveType me_Type;
+				f32 mf_Min;
+				//1 / (max - min)，max和min相等时是0
+				f32 mf_InvRange;
+				f32 mf_Slope;
+				f32 mf_Exponent;
+				f32 mf_ShiftX;
+				f32 mf_ShiftY;
+			};
+
+			//按分数选孩子的选择节点：每个孩子的分数 = 权重 × 各打分项的乘积，打分项是黑板上的f32值经过响应曲线
+			//评估时按分数从高到低找第一个评估通过的孩子，分数一样的前面的孩子优先，分数不大于0的孩子不选
+			//打分只读黑板，订阅了用到的key；agent要挂着黑板。孩子的中断标记不起作用
+			//BevCompiledTree::TickBatch里一段agent一起打分，同一项打分对所有agent在一个连续数组上算完
+			//  BevNodeUtilitySelector &sel = static_cast<BevNodeUtilitySelector &>(BevNodeFactory::oCreateCustomNode<BevNodeUtilitySelector>(parent, "utility"));
+			//打分项不存进BevTreeFile，要存文件就派生一个在构造函数里设置好打分项的类另外声明、注册
+			class BevNodeUtilitySelector : public BevNodePrioritySelector
+			{
+				D_BevDeclareType(BevNodeUtilitySelector)
+
+			public:
+				BevNodeUtilitySelector(BevNode *_o_ParentNode, BevNodePrecondition *_o_NodePrecondition = NULL)
+					: BevNodePrioritySelector(_o_ParentNode, _o_NodePrecondition), mf_Momentum(0.f)
+				{
+				}
+
+				//给第_i_ChildIndex个孩子加一项打分，要在BindBlackboard和BuildStateLayout之前
+				//key的名字要比节点活得久（一般是字符串常量）
+				BevNodeUtilitySelector &AddConsideration(int _i_ChildIndex, const char *_z_Key, const BevResponseCurve &_o_Curve);
+				//孩子的权重，默认是1；没有打分项的孩子分数就是权重，可以拿来兜底
+				BevNodeUtilitySelector &SetWeight(int _i_ChildIndex, f32 _f_Weight);
+				//正在运行的孩子分数乘上(1 + _f_Momentum)，免得分数接近时来回切换
+				BevNodeUtilitySelector &SetMomentum(f32 _f_Momentum)
+				{
+					mf_Momentum = _f_Momentum;
+					return (*this);
+				}
+				f32 GetMomentum() const
+				{
+					return mf_Momentum;
+				}
+
+				//孩子在这个agent上的分数，不算惯性
+				f32 Score(int _i_ChildIndex, const BevAgentState &state) const;
+				//一段agent的分数，_af_Scores[i]对应_o_Agents[_ui_Indices[i]]
+				void ScoreBatch(int _i_ChildIndex, BevAgentState *const *_o_Agents, const u32 *_ui_Indices, u32 _ui_Count, f32 *_af_Scores) const;
+
+				virtual bool _DoEvaluate(BevAgentState &state, const BevNodeInputParam &input) const;
+
+				//不是内置的选择节点，BevCompiledTree交回给节点执行
+				virtual E_BevNodeType GetNodeType() const
+				{
+					return k_BNT_Custom;
+				}
+
+			protected:
+				virtual void _DoEvaluateBatch(BevAgentState *const *_o_Agents, const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const;
+				//评估通过与否只取决于孩子和订阅过的key，惯性只改变顺序
+				virtual bool _IsEvaluateWatchable() const
+				{
+					return true;
+				}
+				virtual void _BindBlackboard(BevBlackboardLayout &_o_Layout) const;
+
+			private:
+				//_ab_Data是每个agent黑板的数据，最多k_BLimited_UtilityBatchSize个
+				void _ScoreChunk(int _i_ChildIndex, const u8 *const *_ab_Data, u32 _ui_Count, f32 *_af_Scores) const;
+				//先试分数最高的_ui_Best，没通过再把算好的分数排个序接着往下试，设置选中的孩子
+				//第i个孩子的分数（不带惯性）是_af_Scores[i * _ui_Stride]
+				bool _SelectFrom(BevAgentState &state, const BevNodeInputParam &input, const f32 *_af_Scores, u32 _ui_Stride, u32 _ui_Best) const;
+
+			private:
+				struct Consideration
+				{
+					Consideration(const char *_z_Key, const BevResponseCurve &_o_Curve)
+						: mo_Key(_z_Key), mo_Curve(_o_Curve)
+					{
+					}
+					BevBlackboardKey<f32> mo_Key;
+					BevResponseCurve mo_Curve;
+				};
+				struct ChildScorer
+				{
+					ChildScorer()
+						: mf_Weight(1.f)
+					{
+					}
+					f32 mf_Weight;
+					std::vector<Consideration> mao_Considerations;
+				};
+				//按孩子的下标，没设置过的孩子可以不在里面（权重1，没有打分项）
+				std::vector<ChildScorer> mao_Scorers;
+				f32 mf_Momentum;
+			};
+		}
+	}
+}
+
+#endif
@@ -2,6 +2,18 @@
 #define __TAI_HEADER__
 
 #include "TAI_RefValue.h"
+#include "TAI_BevTreeArena.h"
 #include "TAI_BevTree.h"
+#include "TAI_BevBlackboard.h"
+#include "TAI_BevPreconditionProgram.h"
+#include "TAI_BevCompiledTree.h"
+#include "TAI_BevScheduler.h"
+#include "TAI_BevAsyncQuery.h"
+#include "TAI_BevTreeFile.h"
+#include "TAI_BevTreeImage.h"
+#include "TAI_BevTreeReload.h"
+#include "TAI_BevProfiler.h"
+#include "TAI_BevTrace.h"
+#include "TAI_BevTraceReplay.h"
 
 #endif
\ No newline at end of file
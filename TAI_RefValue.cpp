@@ -7,17 +7,22 @@ namespace TsiU
 		RefValueManager::RefValueManager()
 			: m_SharedMemory(0)
 		{
-#if PLATFORM_TYPE == PLATFORM_WIN32
 			int size = sizeof(HeadInfo) * kMaxHeadCount + kMaxDataCount;
+#if PLATFORM_TYPE == PLATFORM_WIN32
 			m_SharedMemory = (char*)m_ProccessSM.Malloc(size, "AIRefValue Memory");
+#else
+			//no shared memory, values are only shared inside this process
+			m_SharedMemory = new char[size];
+			memset(m_SharedMemory, 0, size);
 #endif
 		}
 
 		void RefValueManager::Flush()
 		{
-#if PLATFORM_TYPE == PLATFORM_WIN32
 			//update writeable value
+#if PLATFORM_TYPE == PLATFORM_WIN32
 			m_ProccessSM.Lock();
+#endif
 			std::map<std::string, RefValueBase*>::iterator itWritable = m_WritableRefValues.begin();
 			while(itWritable != m_WritableRefValues.end())
 			{
@@ -34,7 +39,9 @@ namespace TsiU
 				}
 				++itWritable;
 			}
+#if PLATFORM_TYPE == PLATFORM_WIN32
 			m_ProccessSM.UnLock();
+#endif
 			//update readonly 
 			std::map<std::string, RefValueBase*>::iterator itReadOnly = m_ReadOnlyRefValues.begin();
 			while(itReadOnly != m_ReadOnlyRefValues.end())
@@ -63,7 +70,6 @@ namespace TsiU
 				}
 				++itReadOnly;
 			}
-#endif
 		}
 
 		bool RefValueManager::AddRefValue(RefValueBase* val, unsigned int attr)
@@ -80,7 +86,6 @@ namespace TsiU
 			}
 			else
 			{
-#if PLATFORM_TYPE == PLATFORM_WIN32
 				HeadInfo* sameNameHeadInfo = _FindRefValueHeadInfo(val->GetName(), EHeadFlag_InUse);
 				if(sameNameHeadInfo)
 				{
@@ -96,7 +101,9 @@ namespace TsiU
 					if(!dataSegment)
 						return false;
 
+#if PLATFORM_TYPE == PLATFORM_WIN32
 					m_ProccessSM.Lock();
+#endif
 
 					val->SetOffsetInMemory(_GetHeadInfoIndex((const char*)headInfoSegment));
 
@@ -107,7 +114,9 @@ namespace TsiU
 					headInfoSegment->m_Offset = _GetDataSegmentOffset(dataSegment);
 					memcpy(dataSegment, val->GetData(), val->GetSize());
 
+#if PLATFORM_TYPE == PLATFORM_WIN32
 					m_ProccessSM.UnLock();
+#endif
 				}
 				std::map<std::string, RefValueBase*>::iterator it = m_WritableRefValues.find(val->GetName());
 				if(it != m_WritableRefValues.end())
@@ -117,9 +126,7 @@ namespace TsiU
 				m_WritableRefValues.insert(std::pair<std::string, RefValueBase*>(val->GetName(), val));
 
 				return true;
-#endif
 			}
-			return false;
 		}
 		bool RefValueManager::RemoveRefValue(RefValueBase* val, unsigned int attr)
 		{
@@ -139,12 +146,16 @@ namespace TsiU
 				{
 					m_WritableRefValues.erase(it);
 				}
+#if PLATFORM_TYPE == PLATFORM_WIN32
 				m_ProccessSM.Lock();
+#endif
 				D_CHECK(val->GetOffsetInMemory() != 0xffffffff);
 				HeadInfo* hi = _GetHeadInfo(val->GetOffsetInMemory());
 				//todo
 				hi->m_Flags = EHeadFlag_Available;
+#if PLATFORM_TYPE == PLATFORM_WIN32
 				m_ProccessSM.UnLock();
+#endif
 
 				return true;
 			}
@@ -62,6 +62,56 @@ namespace TsiU
 			char		 m_VName[kMaxNameSize];
 		};
 
+		//defined before RefValue, which calls RefValueManager::Get() in its members
+		class IRefValueUpdater
+		{
+		public:
+			virtual void Flush() = 0;
+		};
+
+		class RefValueManager : public Singleton<RefValueManager>, IRefValueUpdater
+		{
+			static const unsigned int kMaxNameSize = 64;
+			static const unsigned int kMaxHeadCount = 256;
+			static const unsigned int kMaxDataCount = 1024 * 1024;
+
+			enum{
+				EHeadFlag_Available,
+				EHeadFlag_InUse,
+				EHeadFlag_CanDelete,
+			};
+
+			struct HeadInfo{
+				char			m_VName[kMaxNameSize];
+				unsigned char	m_Flags;
+				unsigned int	m_VSize;
+				unsigned int	m_Offset;
+			};
+		public:
+			RefValueManager();
+
+			void Flush();
+			bool AddRefValue(RefValueBase* val, unsigned int attr);
+			bool RemoveRefValue(RefValueBase* val, unsigned int attr);
+
+		private:
+			HeadInfo*		_FindRefValueHeadInfo(const char* name, unsigned char expectedFlag) const;
+			char*			_GetDataSegment(unsigned int offset) const;
+			char*			_GetAvailableDataSegment(const HeadInfo* hi, unsigned int size) const;
+			unsigned int	_GetDataSegmentOffset(const char* addr) const;
+			HeadInfo*		_GetHeadInfo(unsigned int i) const;
+			unsigned int	_GetHeadInfoIndex(const char* addr) const;
+
+		private:
+#if PLATFORM_TYPE == PLATFORM_WIN32
+			ProccessSharedMemory m_ProccessSM;
+#endif
+			char*			m_SharedMemory;
+
+			std::map<std::string, RefValueBase*> m_ReadOnlyRefValues;
+			std::map<std::string, RefValueBase*> m_WritableRefValues;
+		};
+
 		enum
 		{
 			ERefValuFlag_ReadOnly,
@@ -174,55 +224,6 @@ namespace TsiU
 		typedef RefValue<float, ERefValuFlag_ReadOnly> RFCFloat;
 		typedef RefValue<bool,	ERefValuFlag_Writable> RFBool;
 		typedef RefValue<bool,	ERefValuFlag_ReadOnly> RFCBool;
-
-		class IRefValueUpdater
-		{
-		public:
-			virtual void Flush() = 0;
-		};
-
-		class RefValueManager : public Singleton<RefValueManager>, IRefValueUpdater
-		{
-			static const unsigned int kMaxNameSize = 64;
-			static const unsigned int kMaxHeadCount = 256;
-			static const unsigned int kMaxDataCount = 1024 * 1024;
-
-			enum{
-				EHeadFlag_Available,
-				EHeadFlag_InUse,
-				EHeadFlag_CanDelete,
-			};
-
-			struct HeadInfo{
-				char			m_VName[kMaxNameSize];
-				unsigned char	m_Flags;
-				unsigned int	m_VSize;
-				unsigned int	m_Offset;
-			};
-		public:
-			RefValueManager();
-
-			void Flush();
-			bool AddRefValue(RefValueBase* val, unsigned int attr);
-			bool RemoveRefValue(RefValueBase* val, unsigned int attr);
-
-		private:
-			HeadInfo*		_FindRefValueHeadInfo(const char* name, unsigned char expectedFlag) const;
-			char*			_GetDataSegment(unsigned int offset) const;
-			char*			_GetAvailableDataSegment(const HeadInfo* hi, unsigned int size) const;
-			unsigned int	_GetDataSegmentOffset(const char* addr) const;
-			HeadInfo*		_GetHeadInfo(unsigned int i) const;
-			unsigned int	_GetHeadInfoIndex(const char* addr) const;
-
-		private:
-#if PLATFORM_TYPE == PLATFORM_WIN32
-			ProccessSharedMemory m_ProccessSM;
-#endif
-			char*			m_SharedMemory;
-
-			std::map<std::string, RefValueBase*> m_ReadOnlyRefValues;
-			std::map<std::string, RefValueBase*> m_WritableRefValues;
-		};
 	}
 }
 
@@ -0,0 +1,44 @@
+#ifndef __TCORE_ATOMIC__
+#define __TCORE_ATOMIC__
+
+namespace TsiU
+{
+	//return the new value
+	D_Inline s32 AtomicIncrement(volatile s32* _pValue)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		return ::InterlockedIncrement(reinterpret_cast<volatile LONG*>(_pValue));
+#else
+		return ++(*_pValue);
+#endif
+	}
+	D_Inline s32 AtomicDecrement(volatile s32* _pValue)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		return ::InterlockedDecrement(reinterpret_cast<volatile LONG*>(_pValue));
+#else
+		return --(*_pValue);
+#endif
+	}
+	D_Inline s32 AtomicAdd(volatile s32* _pValue, s32 _iAdd)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		return ::InterlockedExchangeAdd(reinterpret_cast<volatile LONG*>(_pValue), _iAdd) + _iAdd;
+#else
+		return (*_pValue) += _iAdd;
+#endif
+	}
+	//return the old value
+	D_Inline s32 AtomicExchange(volatile s32* _pValue, s32 _iValue)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		return ::InterlockedExchange(reinterpret_cast<volatile LONG*>(_pValue), _iValue);
+#else
+		s32 iOld = *_pValue;
+		*_pValue = _iValue;
+		return iOld;
+#endif
+	}
+}
+
+#endif
\ No newline at end of file
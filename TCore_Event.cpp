@@ -0,0 +1,35 @@
+#include "TCore_Event.h"
+
+namespace TsiU
+{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+	Event::Event(Bool _bManualReset)
+	{
+		m_pEvent = ::CreateEvent(NULL, _bManualReset ? TRUE : FALSE, FALSE, NULL);
+		D_CHECK(m_pEvent);
+	}
+	Event::~Event()
+	{
+		if(m_pEvent)
+		{
+			::CloseHandle(m_pEvent);
+			m_pEvent = NULL;
+		}
+	}
+	void Event::Set()
+	{
+		::SetEvent(m_pEvent);
+	}
+	void Event::Reset()
+	{
+		::ResetEvent(m_pEvent);
+	}
+	Bool Event::Wait(s32 _timeOutInMilliSeconds)
+	{
+		DWORD timeOut = INFINITE;
+		if(_timeOutInMilliSeconds >= 0)
+			timeOut = _timeOutInMilliSeconds;
+		return ::WaitForSingleObject(m_pEvent, timeOut) == WAIT_OBJECT_0;
+	}
+#endif
+}
\ No newline at end of file
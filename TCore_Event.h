@@ -0,0 +1,28 @@
+#ifndef __TCORE_EVENT__
+#define __TCORE_EVENT__
+
+namespace TsiU
+{
+	class Event
+	{
+	public:
+		Event(Bool _bManualReset = false);
+		~Event();
+
+		void Set();
+		void Reset();
+		//return false when time out
+		Bool Wait(s32 _timeOutInMilliSeconds = -1);
+
+	private:
+		Event(const Event&);
+		Event& operator=(const Event&);
+
+	private:
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		HANDLE	m_pEvent;
+#endif
+	};
+}
+
+#endif
\ No newline at end of file
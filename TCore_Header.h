@@ -8,6 +8,10 @@
 #include "TCore_Exception.h"
 #include "TCore_Thread.h"
 #include "TCore_Mutex.h"
+#include "TCore_Event.h"
+#include "TCore_Atomic.h"
+#include "TCore_JobPool.h"
+#include "TCore_MappedFile.h"
 #include "TCore_Assert.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "TCore_JobPool.h"
+
+namespace TsiU
+{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+	class JobPool::Worker : public IThreadRunner
+	{
+	public:
+		Worker(JobPool* _pOwner)
+			: m_pOwner(_pOwner)
+			, m_bQuit(false)
+		{
+		}
+		virtual u32 Run()
+		{
+			while(!m_bQuit)
+			{
+				if(!m_pOwner->_ExecuteOne())
+					m_pOwner->m_WorkEvent.Wait();
+			}
+			//pass the wake up to the next worker
+			m_pOwner->m_WorkEvent.Set();
+			return 0;
+		}
+		virtual void NotifyQuit()
+		{
+			m_bQuit = true;
+			m_pOwner->m_WorkEvent.Set();
+		}
+
+	private:
+		JobPool*		m_pOwner;
+		volatile Bool	m_bQuit;
+	};
+#endif
+
+	JobPool::JobPool(u32 _uWorkerCount)
+		: m_uWorkerCount(_uWorkerCount)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		for(u32 i = 0; i < m_uWorkerCount; ++i)
+		{
+			Worker* pWorker = new Worker(this);
+			Thread* pThread = new Thread(pWorker, Thread::EThreadPriority_Normal, "JobPoolWorker");
+			m_Workers.push_back(pWorker);
+			m_Threads.push_back(pThread);
+			pThread->Start();
+		}
+#else
+		m_uWorkerCount = 0;
+#endif
+	}
+
+	JobPool::~JobPool()
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		//the workers share one wake up event, so let all of them know before waiting for any
+		for(u32 i = 0; i < m_Workers.size(); ++i)
+			m_Workers[i]->NotifyQuit();
+		for(u32 i = 0; i < m_Threads.size(); ++i)
+		{
+			m_Threads[i]->Stop();
+			delete m_Threads[i];
+			delete m_Workers[i];
+		}
+#endif
+	}
+
+	u32 JobPool::GetWorkerCount() const
+	{
+		return m_uWorkerCount;
+	}
+
+	void JobPool::Run(IJob** _pJobs, u32 _uCount)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		if(m_uWorkerCount > 0 && _uCount > 1)
+		{
+			Batch batch;
+			batch.m_iPending = _uCount;
+			m_QueueLock.Lock();
+			for(u32 i = 0; i < _uCount; ++i)
+			{
+				Entry entry = { _pJobs[i], &batch };
+				m_Queue.push_back(entry);
+			}
+			m_QueueLock.UnLock();
+			m_WorkEvent.Set();
+
+			while(batch.m_iPending > 0 && _ExecuteOne())
+			{
+			}
+			//always wait, the one finishing the last job still touches the batch when setting the event
+			batch.m_DoneEvent.Wait();
+			return;
+		}
+#endif
+		for(u32 i = 0; i < _uCount; ++i)
+			_pJobs[i]->Execute();
+	}
+
+	void JobPool::Submit(IJob* _pJob)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		if(m_uWorkerCount > 0)
+		{
+			Entry entry = { _pJob, NULL };
+			m_QueueLock.Lock();
+			m_Queue.push_back(entry);
+			m_QueueLock.UnLock();
+			m_WorkEvent.Set();
+			return;
+		}
+#endif
+		_pJob->Execute();
+	}
+
+	Bool JobPool::Cancel(IJob* _pJob)
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		Bool bFound = false;
+		m_QueueLock.Lock();
+		for(std::deque<Entry>::iterator it = m_Queue.begin(); it != m_Queue.end(); ++it)
+		{
+			if(it->m_pJob == _pJob && !it->m_pBatch)
+			{
+				m_Queue.erase(it);
+				bFound = true;
+				break;
+			}
+		}
+		m_QueueLock.UnLock();
+		return bFound;
+#else
+		D_Unused(_pJob);
+		return false;
+#endif
+	}
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+	Bool JobPool::_ExecuteOne()
+	{
+		m_QueueLock.Lock();
+		if(m_Queue.empty())
+		{
+			m_QueueLock.UnLock();
+			return false;
+		}
+		Entry entry = m_Queue.front();
+		m_Queue.pop_front();
+		Bool bMore = !m_Queue.empty();
+		m_QueueLock.UnLock();
+
+		//wake up one more worker for the rest
+		if(bMore)
+			m_WorkEvent.Set();
+
+		entry.m_pJob->Execute();
+		if(entry.m_pBatch && AtomicDecrement(&entry.m_pBatch->m_iPending) == 0)
+			entry.m_pBatch->m_DoneEvent.Set();
+		return true;
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef __TCORE_JOBPOOL__
+#define __TCORE_JOBPOOL__
+
+#include <vector>
+#include <deque>
+#include "TCore_Atomic.h"
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#include "TCore_Thread.h"
+#include "TCore_Mutex.h"
+#include "TCore_Event.h"
+#endif
+
+namespace TsiU
+{
+	class IJob
+	{
+	public:
+		virtual void Execute() = 0;
+	};
+
+	//worker threads sharing one job queue
+	//Run() returns when all jobs passed to it are done, the calling thread helps executing,
+	//so it can be called from several threads at the same time, or from inside a job
+	//without thread support the jobs run one by one on the calling thread, in order
+	//Submit() queues a job without waiting for it, the job has to tell its owner when it is done
+	class JobPool
+	{
+	public:
+		JobPool(u32 _uWorkerCount);
+		~JobPool();
+
+		void Run(IJob** _pJobs, u32 _uCount);
+		//without worker threads the job is executed before returning
+		//submitted jobs have to be done or cancelled before the pool is destroyed
+		void Submit(IJob* _pJob);
+		//remove a submitted job that has not started yet, return false if it is running or done
+		Bool Cancel(IJob* _pJob);
+		u32 GetWorkerCount() const;
+
+	private:
+		JobPool(const JobPool&);
+		JobPool& operator=(const JobPool&);
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		struct Batch
+		{
+			volatile s32	m_iPending;
+			Event			m_DoneEvent;
+		};
+		struct Entry
+		{
+			IJob*	m_pJob;
+			//NULL for submitted jobs
+			Batch*	m_pBatch;
+		};
+		class Worker;
+
+		//return false if the queue is empty
+		Bool _ExecuteOne();
+#endif
+
+	private:
+		u32						m_uWorkerCount;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		Mutex					m_QueueLock;
+		std::deque<Entry>		m_Queue;
+		Event					m_WorkEvent;
+		std::vector<Worker*>	m_Workers;
+		std::vector<Thread*>	m_Threads;
+#endif
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "TCore_MappedFile.h"
+
+#if PLATFORM_TYPE != PLATFORM_WIN32 && (defined(__unix__) || defined(__APPLE__))
+#define TCORE_MAPPEDFILE_POSIX 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace TsiU
+{
+	MappedFile::MappedFile()
+		: m_pData(NULL)
+		, m_uiSize(0)
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		, m_pFile(INVALID_HANDLE_VALUE)
+		, m_pMapping(NULL)
+#endif
+	{
+	}
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#if PLATFORM_TYPE == PLATFORM_WIN32
+	Bool MappedFile::Open(StringPtr _zFilePath)
+	{
+		Close();
+		m_pFile = ::CreateFileA(_zFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(m_pFile == INVALID_HANDLE_VALUE)
+			return false;
+		DWORD sizeHigh = 0;
+		DWORD size = ::GetFileSize(m_pFile, &sizeHigh);
+		if(size == 0 || sizeHigh != 0)
+		{
+			Close();
+			return false;
+		}
+		m_pMapping = ::CreateFileMappingA(m_pFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(m_pMapping)
+			m_pData = ::MapViewOfFile(m_pMapping, FILE_MAP_READ, 0, 0, 0);
+		if(!m_pData)
+		{
+			Close();
+			return false;
+		}
+		m_uiSize = size;
+		return true;
+	}
+	void MappedFile::Close()
+	{
+		if(m_pData)
+			::UnmapViewOfFile(m_pData);
+		if(m_pMapping)
+			::CloseHandle(m_pMapping);
+		if(m_pFile != INVALID_HANDLE_VALUE)
+			::CloseHandle(m_pFile);
+		m_pData = NULL;
+		m_uiSize = 0;
+		m_pMapping = NULL;
+		m_pFile = INVALID_HANDLE_VALUE;
+	}
+#elif defined(TCORE_MAPPEDFILE_POSIX)
+	Bool MappedFile::Open(StringPtr _zFilePath)
+	{
+		Close();
+		int fd = ::open(_zFilePath, O_RDONLY);
+		if(fd < 0)
+			return false;
+		struct stat st;
+		if(::fstat(fd, &st) != 0 || st.st_size <= 0 || (u64)st.st_size > 0xffffffff)
+		{
+			::close(fd);
+			return false;
+		}
+		void* pData = ::mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		//the mapping keeps its own reference to the file
+		::close(fd);
+		if(pData == MAP_FAILED)
+			return false;
+		m_pData = pData;
+		m_uiSize = (u32)st.st_size;
+		return true;
+	}
+	void MappedFile::Close()
+	{
+		if(m_pData)
+			::munmap(const_cast<void*>(m_pData), m_uiSize);
+		m_pData = NULL;
+		m_uiSize = 0;
+	}
+#else
+	Bool MappedFile::Open(StringPtr _zFilePath)
+	{
+		Close();
+		FILE* fp = fopen(_zFilePath, "rb");
+		if(!fp)
+			return false;
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		if(size <= 0)
+		{
+			fclose(fp);
+			return false;
+		}
+		//u64 keeps the buffer aligned for the structs read out of it
+		u64* pData = new u64[(size + sizeof(u64) - 1) / sizeof(u64)];
+		Bool bOk = fread(pData, 1, size, fp) == (size_t)size;
+		fclose(fp);
+		if(!bOk)
+		{
+			delete[] pData;
+			return false;
+		}
+		m_pData = pData;
+		m_uiSize = (u32)size;
+		return true;
+	}
+	void MappedFile::Close()
+	{
+		delete[] static_cast<const u64*>(m_pData);
+		m_pData = NULL;
+		m_uiSize = 0;
+	}
+#endif
+}
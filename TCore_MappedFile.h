@@ -0,0 +1,44 @@
+#ifndef __TCORE_MAPPEDFILE__
+#define __TCORE_MAPPEDFILE__
+
+namespace TsiU
+{
+	//read-only file mapping, processes mapping the same file share its pages
+	//falls back to reading the whole file into memory when the platform has no mapping
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		Bool Open(StringPtr _zFilePath);
+		void Close();
+
+		const void* GetData() const
+		{
+			return m_pData;
+		}
+		u32 GetSize() const
+		{
+			return m_uiSize;
+		}
+		Bool IsValid() const
+		{
+			return m_pData != NULL;
+		}
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+	private:
+		const void*	m_pData;
+		u32			m_uiSize;
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		HANDLE		m_pFile;
+		HANDLE		m_pMapping;
+#endif
+	};
+}
+
+#endif
@@ -3,7 +3,7 @@
 
 static TsiU::DefaultAllocator defAlloc;
 
-void* operator new(size_t _uiSize)
+void* operator new(size_t _uiSize) D_NewThrow
 {
 	if(TsiU::HasInited())
 		return TsiU::GetLibSettings()->GetAllocator()->Alloc(_uiSize);
@@ -11,7 +11,7 @@ void* operator new(size_t _uiSize)
 		return defAlloc.Alloc(_uiSize);
 }													
 
-void operator delete(void* _poMem)
+void operator delete(void* _poMem) D_DeleteThrow
 {	
 	if(TsiU::HasInited())
 		TsiU::GetLibSettings()->GetAllocator()->Free(_poMem);
@@ -19,7 +19,7 @@ void operator delete(void* _poMem)
 		defAlloc.Free(_poMem);
 }			
 
-void* operator new[](size_t _uiSize)				
+void* operator new[](size_t _uiSize) D_NewThrow
 {
 	if(TsiU::HasInited())
 		return TsiU::GetLibSettings()->GetAllocator()->Alloc(_uiSize);
@@ -27,7 +27,7 @@ void* operator new[](size_t _uiSize)
 		return defAlloc.Alloc(_uiSize);					
 }													
 
-void operator delete[](void* _poMem)			
+void operator delete[](void* _poMem) D_DeleteThrow
 {							                        
 	if(TsiU::HasInited())
 		TsiU::GetLibSettings()->GetAllocator()->Free(_poMem);
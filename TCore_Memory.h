@@ -1,9 +1,19 @@
 #ifndef __TCORE_MEMORY__ 
 #define __TCORE_MEMORY__
 
-void*	operator new(size_t _uiSize);													
-void	operator delete(void* _poMem);			
-void*	operator new[](size_t _uiSize);																
-void	operator delete[](void* _poMem);
+//gcc has to see the same exception specifications as <new>
+#if PLATFORM_TYPE == PLATFORM_WIN32
+#define D_NewThrow
+#define D_DeleteThrow
+#else
+#include <new>
+#define D_NewThrow		throw (std::bad_alloc)
+#define D_DeleteThrow	throw ()
+#endif
+
+void*	operator new(size_t _uiSize) D_NewThrow;
+void	operator delete(void* _poMem) D_DeleteThrow;
+void*	operator new[](size_t _uiSize) D_NewThrow;
+void	operator delete[](void* _poMem) D_DeleteThrow;
 
 #endif
\ No newline at end of file
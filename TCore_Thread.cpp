@@ -57,6 +57,8 @@ namespace TsiU
 				return false;
 			}
 			::SetThreadPriority(m_pThreadID, sThreadPriorities[m_ePriority]);
+			//set here too, so Stop() right after Start() still waits for the thread
+			m_bStarted = true;
 #endif
 		}
 		return true;
@@ -16,12 +16,20 @@
 typedef unsigned char		u8;
 typedef unsigned short		u16;
 typedef unsigned int		u32;
+#if _MSC_VER
 typedef unsigned __int64	u64;
+#else
+typedef unsigned long long	u64;
+#endif
 
 typedef	signed char			s8;
 typedef signed short		s16;
 typedef signed int  		s32;
+#if _MSC_VER
 typedef signed __int64		s64;
+#else
+typedef signed long long	s64;
+#endif
 
 typedef char				Char;
 typedef const char*			StringPtr;
@@ -67,6 +75,14 @@ typedef void*				Udef;
 
 #define D_Inline inline
 
+//normally defined by the project settings
+#ifndef PLATFORM_WIN32
+#define PLATFORM_WIN32	1
+#endif
+#ifndef PLATFORM_NONE
+#define PLATFORM_NONE	0
+#endif
+
 #if _MSC_VER
 #define PLATFORM_TYPE	PLATFORM_WIN32
 #else
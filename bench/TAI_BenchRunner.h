@@ -0,0 +1,375 @@
+#ifndef __TAI_BENCHRUNNER_H__
+#define __TAI_BENCHRUNNER_H__
+
+//基准程序用的小框架，用法和命令行参数照着google benchmark：
+//  void _BenchXXX(BenchState &state) { 准备; while (state.KeepRunning()) { 要测的代码; } }
+//  runner.Run("名字", _BenchXXX, 参数);
+//迭代次数自动增加到跑满--benchmark_min_time秒为止，准备的部分不计时
+//--benchmark_format=json输出和google benchmark一样的JSON，可以直接用它的compare.py比较两次的结果
+#include <time.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#if PLATFORM_TYPE != PLATFORM_WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using namespace TsiU;
+
+	//墙上时间，纳秒
+	f64 _GetWallNanoseconds()
+	{
+#if PLATFORM_TYPE == PLATFORM_WIN32
+		LARGE_INTEGER counter, frequency;
+		::QueryPerformanceCounter(&counter);
+		::QueryPerformanceFrequency(&frequency);
+		return (f64)counter.QuadPart * 1e9 / (f64)frequency.QuadPart;
+#else
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (f64)ts.tv_sec * 1e9 + (f64)ts.tv_nsec;
+#endif
+	}
+	//进程的CPU时间，纳秒；Win32下clock()是墙上时间
+	f64 _GetCpuNanoseconds()
+	{
+		return (f64)clock() * 1e9 / CLOCKS_PER_SEC;
+	}
+
+	//结果写到这里，免得被编译器优化掉
+	volatile u32 g_BenchSink = 0;
+
+	class BenchState
+	{
+	public:
+		BenchState(u64 _ui_Iterations, s32 _i_Arg)
+			: mui_Iterations(_ui_Iterations), mui_Remaining(_ui_Iterations), mi_Arg(_i_Arg), mb_Started(false),
+			  mf_WallStart(0), mf_CpuStart(0), mf_WallTime(0), mf_CpuTime(0), mui_ItemsProcessed(0)
+		{
+		}
+
+		//第一次调用时开始计时，跑够次数后停止计时并返回false
+		bool KeepRunning()
+		{
+			if (!mb_Started)
+			{
+				mb_Started = true;
+				mf_CpuStart = _GetCpuNanoseconds();
+				mf_WallStart = _GetWallNanoseconds();
+			}
+			if (mui_Remaining > 0)
+			{
+				--mui_Remaining;
+				return true;
+			}
+			mf_WallTime = _GetWallNanoseconds() - mf_WallStart;
+			mf_CpuTime = _GetCpuNanoseconds() - mf_CpuStart;
+			return false;
+		}
+		u64 GetIterations() const
+		{
+			return mui_Iterations;
+		}
+		//当前迭代的下标，从0开始
+		u64 GetIndex() const
+		{
+			return mui_Iterations - mui_Remaining - 1;
+		}
+		s32 GetArg() const
+		{
+			return mi_Arg;
+		}
+		//一次迭代处理了不止一项时设置，会多输出items_per_second
+		void SetItemsProcessed(u64 _ui_Items)
+		{
+			mui_ItemsProcessed = _ui_Items;
+		}
+		f64 GetWallTime() const
+		{
+			return mf_WallTime;
+		}
+		f64 GetCpuTime() const
+		{
+			return mf_CpuTime;
+		}
+		u64 GetItemsProcessed() const
+		{
+			return mui_ItemsProcessed;
+		}
+
+	private:
+		u64 mui_Iterations;
+		u64 mui_Remaining;
+		s32 mi_Arg;
+		bool mb_Started;
+		f64 mf_WallStart;
+		f64 mf_CpuStart;
+		f64 mf_WallTime;
+		f64 mf_CpuTime;
+		u64 mui_ItemsProcessed;
+	};
+
+	typedef void (*BenchFunc)(BenchState &state);
+
+	class BenchRunner
+	{
+	public:
+		BenchRunner(int argc, char **argv)
+			: mf_MinTime(0.5), mi_Repetitions(1), mb_Json(false), mz_Executable(argc > 0 ? argv[0] : "")
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const char *arg = argv[i];
+				if (_Match(arg, "--benchmark_filter="))
+					mz_Filter = arg + strlen("--benchmark_filter=");
+				else if (_Match(arg, "--benchmark_min_time="))
+					mf_MinTime = atof(arg + strlen("--benchmark_min_time="));
+				else if (_Match(arg, "--benchmark_repetitions="))
+					mi_Repetitions = atoi(arg + strlen("--benchmark_repetitions="));
+				else if (_Match(arg, "--benchmark_format="))
+					mb_Json = strcmp(arg + strlen("--benchmark_format="), "json") == 0;
+				else if (_Match(arg, "--benchmark_out="))
+					mz_OutFile = arg + strlen("--benchmark_out=");
+				else
+					D_Output("unknown argument %s\n", arg);
+			}
+			if (mi_Repetitions < 1)
+				mi_Repetitions = 1;
+			if (!mb_Json)
+				D_Output("%-48s %14s %14s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+		}
+
+		//_i_Arg小于0时名字里不带参数
+		void Run(const char *_z_Name, BenchFunc _f_Func, s32 _i_Arg = -1)
+		{
+			std::string name = _z_Name;
+			if (_i_Arg >= 0)
+			{
+				char buffer[16];
+				sprintf(buffer, "/%d", _i_Arg);
+				name += buffer;
+			}
+			if (!mz_Filter.empty() && name.find(mz_Filter) == std::string::npos)
+				return;
+
+			std::vector<Result> runs;
+			for (s32 r = 0; r < mi_Repetitions; ++r)
+			{
+				Result result = _RunOnce(_f_Func, _i_Arg);
+				result.mz_Name = name;
+				result.mz_RunName = name;
+				result.mz_Aggregate = "";
+				_Report(result);
+				runs.push_back(result);
+			}
+			if (runs.size() > 1)
+			{
+				_Report(_Aggregate(runs, "mean"));
+				_Report(_Aggregate(runs, "median"));
+			}
+		}
+
+		//把JSON写到--benchmark_out指定的文件，没指定时写到标准输出
+		void Finish()
+		{
+			if (mz_OutFile.empty() && !mb_Json)
+				return;
+			std::string json = _ToJson();
+			if (!mz_OutFile.empty())
+			{
+				FILE *fp = fopen(mz_OutFile.c_str(), "w");
+				if (!fp)
+				{
+					D_Output("can't open %s\n", mz_OutFile.c_str());
+					return;
+				}
+				fputs(json.c_str(), fp);
+				fclose(fp);
+			}
+			if (mb_Json)
+				fputs(json.c_str(), stdout);
+		}
+
+	private:
+		struct Result
+		{
+			std::string mz_Name;
+			std::string mz_RunName;
+			std::string mz_Aggregate;
+			u64 mui_Iterations;
+			//每次迭代的纳秒数
+			f64 mf_RealTime;
+			f64 mf_CpuTime;
+			//每秒处理的项数，没有设置时为0
+			f64 mf_ItemsPerSecond;
+		};
+
+		static bool _Match(const char *_z_Arg, const char *_z_Prefix)
+		{
+			return strncmp(_z_Arg, _z_Prefix, strlen(_z_Prefix)) == 0;
+		}
+
+		Result _RunOnce(BenchFunc _f_Func, s32 _i_Arg)
+		{
+			//从1次开始，按上一次的耗时估计还要多少次，每次最多放大10倍
+			u64 iterations = 1;
+			f64 minTime = mf_MinTime * 1e9;
+			for (;;)
+			{
+				BenchState state(iterations, _i_Arg);
+				_f_Func(state);
+				f64 elapsed = state.GetCpuTime() > state.GetWallTime() ? state.GetCpuTime() : state.GetWallTime();
+				if (elapsed >= minTime || iterations >= 1000000000)
+				{
+					Result result;
+					result.mui_Iterations = iterations;
+					result.mf_RealTime = state.GetWallTime() / iterations;
+					result.mf_CpuTime = state.GetCpuTime() / iterations;
+					result.mf_ItemsPerSecond = state.GetItemsProcessed() > 0 && state.GetCpuTime() > 0 ? state.GetItemsProcessed() * 1e9 / state.GetCpuTime() : 0;
+					return result;
+				}
+				f64 multiplier = elapsed > 0 ? minTime * 1.4 / elapsed : 10;
+				if (multiplier > 10)
+					multiplier = 10;
+				u64 next = (u64)(iterations * multiplier);
+				iterations = next > iterations ? next : iterations + 1;
+			}
+		}
+
+		Result _Aggregate(const std::vector<Result> &_o_Runs, const char *_z_Aggregate)
+		{
+			Result result = _o_Runs[0];
+			result.mz_Name = result.mz_RunName + "_" + _z_Aggregate;
+			result.mz_Aggregate = _z_Aggregate;
+			u32 count = (u32)_o_Runs.size();
+			std::vector<f64> real(count), cpu(count), items(count);
+			for (u32 i = 0; i < count; ++i)
+			{
+				real[i] = _o_Runs[i].mf_RealTime;
+				cpu[i] = _o_Runs[i].mf_CpuTime;
+				items[i] = _o_Runs[i].mf_ItemsPerSecond;
+			}
+			if (strcmp(_z_Aggregate, "median") == 0)
+			{
+				result.mf_RealTime = _Median(real);
+				result.mf_CpuTime = _Median(cpu);
+				result.mf_ItemsPerSecond = _Median(items);
+			}
+			else
+			{
+				result.mf_RealTime = _Mean(real);
+				result.mf_CpuTime = _Mean(cpu);
+				result.mf_ItemsPerSecond = _Mean(items);
+			}
+			return result;
+		}
+		static f64 _Mean(const std::vector<f64> &_o_Values)
+		{
+			f64 sum = 0;
+			for (u32 i = 0; i < _o_Values.size(); ++i)
+				sum += _o_Values[i];
+			return sum / _o_Values.size();
+		}
+		static f64 _Median(std::vector<f64> _o_Values)
+		{
+			std::sort(_o_Values.begin(), _o_Values.end());
+			u32 count = (u32)_o_Values.size();
+			return count % 2 ? _o_Values[count / 2] : (_o_Values[count / 2 - 1] + _o_Values[count / 2]) / 2;
+		}
+
+		void _Report(const Result &_o_Result)
+		{
+			mao_Results.push_back(_o_Result);
+			if (mb_Json)
+				return;
+			if (_o_Result.mf_ItemsPerSecond > 0)
+				D_Output("%-48s %11.1f ns %11.1f ns %12llu items/s=%.4g\n", _o_Result.mz_Name.c_str(), _o_Result.mf_RealTime, _o_Result.mf_CpuTime,
+						 (unsigned long long)_o_Result.mui_Iterations, _o_Result.mf_ItemsPerSecond);
+			else
+				D_Output("%-48s %11.1f ns %11.1f ns %12llu\n", _o_Result.mz_Name.c_str(), _o_Result.mf_RealTime, _o_Result.mf_CpuTime,
+						 (unsigned long long)_o_Result.mui_Iterations);
+		}
+
+		std::string _ToJson() const
+		{
+			std::string json;
+			char buffer[512];
+			char date[64];
+			time_t now = time(NULL);
+			strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+			json += "{\n  \"context\": {\n";
+			sprintf(buffer, "    \"date\": \"%s\",\n", date);
+			json += buffer;
+			json += "    \"executable\": \"" + _Escape(mz_Executable) + "\",\n";
+#if PLATFORM_TYPE == PLATFORM_WIN32
+			SYSTEM_INFO info;
+			::GetSystemInfo(&info);
+			sprintf(buffer, "    \"num_cpus\": %u,\n", (u32)info.dwNumberOfProcessors);
+#else
+			sprintf(buffer, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+			json += buffer;
+#if defined(NDEBUG)
+			json += "    \"library_build_type\": \"release\"\n";
+#else
+			json += "    \"library_build_type\": \"debug\"\n";
+#endif
+			json += "  },\n  \"benchmarks\": [";
+			for (u32 i = 0; i < mao_Results.size(); ++i)
+			{
+				const Result &result = mao_Results[i];
+				json += i > 0 ? ",\n    {\n" : "\n    {\n";
+				json += "      \"name\": \"" + _Escape(result.mz_Name) + "\",\n";
+				json += "      \"run_name\": \"" + _Escape(result.mz_RunName) + "\",\n";
+				if (result.mz_Aggregate.empty())
+				{
+					json += "      \"run_type\": \"iteration\",\n";
+				}
+				else
+				{
+					json += "      \"run_type\": \"aggregate\",\n";
+					json += "      \"aggregate_name\": \"" + result.mz_Aggregate + "\",\n";
+				}
+				sprintf(buffer, "      \"iterations\": %llu,\n      \"real_time\": %.6e,\n      \"cpu_time\": %.6e,\n      \"time_unit\": \"ns\"",
+						(unsigned long long)result.mui_Iterations, result.mf_RealTime, result.mf_CpuTime);
+				json += buffer;
+				if (result.mf_ItemsPerSecond > 0)
+				{
+					sprintf(buffer, ",\n      \"items_per_second\": %.6e", result.mf_ItemsPerSecond);
+					json += buffer;
+				}
+				json += "\n    }";
+			}
+			json += "\n  ]\n}\n";
+			return json;
+		}
+		static std::string _Escape(const std::string &_z_Text)
+		{
+			std::string out;
+			for (u32 i = 0; i < _z_Text.size(); ++i)
+			{
+				char c = _z_Text[i];
+				if (c == '"' || c == '\\')
+					out += '\\';
+				out += c;
+			}
+			return out;
+		}
+
+	private:
+		f64 mf_MinTime;
+		s32 mi_Repetitions;
+		bool mb_Json;
+		std::string mz_Filter;
+		std::string mz_OutFile;
+		std::string mz_Executable;
+		std::vector<Result> mao_Results;
+	};
+}
+
+#endif
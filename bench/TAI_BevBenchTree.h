@@ -0,0 +1,98 @@
+#ifndef __TAI_BEVBENCHTREE_H__
+#define __TAI_BEVBENCHTREE_H__
+
+//基准程序共用的测试树：优先级选择下挂kBranchCount个分支，每个分支带前提条件
+#include "TAI_BevTree.h"
+
+namespace
+{
+	using namespace TsiU;
+	using namespace TsiU::AI::BehaviorTree;
+
+	const int kBranchCount = 8;
+
+	struct BenchInput
+	{
+		int mi_Frame;
+		int mi_Seed;
+	};
+	struct BenchOutput
+	{
+		int mi_Work;
+	};
+
+	class BenchCondition : public BevNodePrecondition
+	{
+	public:
+		BenchCondition(int _i_Branch)
+			: mi_Branch(_i_Branch)
+		{
+		}
+		virtual bool ExternalCondition(const BevNodeInputParam &input) const
+		{
+			const BenchInput &in = input.GetRealDataType<BenchInput>();
+			return ((in.mi_Frame / 32 + in.mi_Seed) % kBranchCount) <= mi_Branch;
+		}
+		//批量版本：一整段agent在一个循环里算完，省掉每个agent一次虚函数调用
+		virtual void ExternalConditionBatch(const BevNodeInputParam *_o_Inputs, const u32 *_ui_Indices, u32 _ui_Count, u8 *_ab_Results) const
+		{
+			for (u32 i = 0; i < _ui_Count; ++i)
+			{
+				const BenchInput &in = _o_Inputs[_ui_Indices[i]].GetRealDataType<BenchInput>();
+				_ab_Results[i] = ((in.mi_Frame / 32 + in.mi_Seed) % kBranchCount) <= mi_Branch;
+			}
+		}
+
+	private:
+		int mi_Branch;
+	};
+
+	class BenchAction : public BevNodeTerminal
+	{
+	public:
+		BenchAction(BevNode *_o_ParentNode)
+			: BevNodeTerminal(_o_ParentNode)
+		{
+		}
+
+	protected:
+		struct UserState
+		{
+			int mi_Frames;
+		};
+		virtual u32 _GetUserStateSize() const
+		{
+			return sizeof(UserState);
+		}
+		virtual void _DoEnter(BevAgentState &state, const BevNodeInputParam &input) const
+		{
+			_GetUserState<UserState>(state).mi_Frames = 0;
+		}
+		virtual BevRunningStatus _DoExecute(BevAgentState &state, const BevNodeInputParam &input, BevNodeOutputParam &output) const
+		{
+			output.GetRealDataType<BenchOutput>().mi_Work++;
+			return ++_GetUserState<UserState>(state).mi_Frames >= 3 ? k_BRS_Finish : k_BRS_Executing;
+		}
+	};
+
+	//root: 优先级选择 -> 每个分支是 序列(循环(动作), 并行(动作, 动作), 动作)
+	inline BevNode *_CreateTree()
+	{
+		BevNode &root = BevNodeFactory::oCreatePrioritySelectorNode(NULL, "root");
+		for (int i = 0; i < kBranchCount; ++i)
+		{
+			BevNode &seq = BevNodeFactory::oCreateSequenceNode(&root, "branch");
+			seq.SetNodePrecondition(new BenchCondition(i));
+			BevNode &loop = BevNodeFactory::oCreateLoopNode(&seq, "loop", 2);
+			BevNodeFactory::oCreateTeminalNode<BenchAction>(&loop, "loop_action");
+			BevNode &par = BevNodeFactory::oCreateParallelNode(&seq, k_PFC_AND, "parallel");
+			BevNodeFactory::oCreateTeminalNode<BenchAction>(&par, "par_action0");
+			BevNodeFactory::oCreateTeminalNode<BenchAction>(&par, "par_action1");
+			BevNodeFactory::oCreateTeminalNode<BenchAction>(&seq, "action");
+		}
+		root.BuildStateLayout();
+		return &root;
+	}
+}
+
+#endif
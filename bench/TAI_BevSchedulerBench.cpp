@@ -0,0 +1,78 @@
+//BevTickScheduler扩展性基准：同样的agent用1到N个线程tick，看每秒tick次数和加速比
+#include "TsiU_PCH.h"
+#include <time.h>
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevScheduler.h"
+#include "TAI_BevBenchTree.h"
+
+namespace
+{
+	const int kAgentCount = 16384;
+	const int kFrameCount = 200;
+	const int kRepeatCount = 3;
+
+	double _Run(BevNode &_o_Root, u32 _ui_WorkerCount)
+	{
+		//按约定，input只读可以共享，output每个agent一份
+		std::vector<BenchInput> ins(kAgentCount);
+		std::vector<BenchOutput> outs(kAgentCount);
+		std::vector<BevAgentState *> agents;
+		BevTickScheduler scheduler(_ui_WorkerCount);
+		for (int i = 0; i < kAgentCount; ++i)
+		{
+			ins[i].mi_Frame = 0;
+			ins[i].mi_Seed = i;
+			outs[i].mi_Work = 0;
+			agents.push_back(new BevAgentState(_o_Root));
+			scheduler.AddAgent(*agents[i], BevNodeInputParam(&ins[i]), BevNodeOutputParam(&outs[i]));
+		}
+
+		double seconds = 0;
+		for (int r = 0; r < kRepeatCount; ++r)
+		{
+			//Win32下clock()是墙上时间
+			clock_t start = clock();
+			for (int f = 0; f < kFrameCount; ++f)
+			{
+				for (int i = 0; i < kAgentCount; ++i)
+					ins[i].mi_Frame = f;
+				scheduler.TickAll();
+			}
+			double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+			if (r == 0 || elapsed < seconds)
+				seconds = elapsed;
+		}
+
+		int work = 0;
+		for (int i = 0; i < kAgentCount; ++i)
+		{
+			work += outs[i].mi_Work;
+			delete agents[i];
+		}
+		double ticksPerSec = seconds > 0 ? (double)kAgentCount * kFrameCount / seconds : 0;
+		printf("workers=%-3u %10.0f ticks/sec (work=%d)\n", scheduler.GetWorkerCount(), ticksPerSec, work);
+		return ticksPerSec;
+	}
+}
+
+int main()
+{
+	BevNode *root = _CreateTree();
+	u32 maxWorkerCount = BevTickScheduler::GetDefaultWorkerCount();
+	double single = 0;
+	for (u32 workers = 1;; workers *= 2)
+	{
+		if (workers > maxWorkerCount)
+			workers = maxWorkerCount;
+		double ticksPerSec = _Run(*root, workers);
+		if (workers == 1)
+			single = ticksPerSec;
+		else if (single > 0)
+			printf("workers=%-3u speedup %.2fx, efficiency %.0f%%\n", workers, ticksPerSec / single, ticksPerSec / single / workers * 100);
+		if (workers == maxWorkerCount)
+			break;
+	}
+	delete root;
+	return 0;
+}
@@ -0,0 +1,229 @@
+//BevTree基准：同一棵树分别用指针树、BevCompiledTree和BevCompiledTree::TickBatch驱动，比较每秒tick次数
+#include "TsiU_PCH.h"
+#include <time.h>
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevCompiledTree.h"
+#include "TAI_BevBenchTree.h"
+
+using namespace TsiU;
+using namespace TsiU::AI::BehaviorTree;
+
+namespace
+{
+	const int kAgentCount = 4096;
+	const int kFrameCount = 500;
+	//不同原型的树的数量，原型多时指针树的节点散落在堆上，能看出连续数组的差别
+	const int kMaxTreeCount = 256;
+	//每项重复几次取最好的结果，减少机器抖动的影响
+	const int kRepeatCount = 5;
+
+	template <typename TreeType>
+	double _Run(const std::vector<const TreeType *> &trees, const std::vector<BevNode *> &roots, const char *_name)
+	{
+		int treeCount = (int)trees.size();
+		std::vector<BevAgentState *> agents;
+		for (int i = 0; i < kAgentCount; ++i)
+			agents.push_back(new BevAgentState(*roots[i % treeCount]));
+
+		BenchInput in = {0, 0};
+		BenchOutput out = {0};
+		BevNodeInputParam input(&in);
+		BevNodeOutputParam output(&out);
+
+		double seconds = 0;
+		for (int r = 0; r < kRepeatCount; ++r)
+		{
+			clock_t start = clock();
+			for (int f = 0; f < kFrameCount; ++f)
+			{
+				in.mi_Frame = f;
+				for (int i = 0; i < kAgentCount; ++i)
+				{
+					in.mi_Seed = i;
+					const TreeType &tree = *trees[i % treeCount];
+					if (tree.Evaluate(*agents[i], input))
+						tree.Tick(*agents[i], input, output);
+				}
+			}
+			double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+			if (r == 0 || elapsed < seconds)
+				seconds = elapsed;
+		}
+		double ticksPerSec = seconds > 0 ? (double)kAgentCount * kFrameCount / seconds : 0;
+		printf("trees=%-4d %-10s %10.0f ticks/sec (work=%d)\n", treeCount, _name, ticksPerSec, out.mi_Work);
+
+		for (int i = 0; i < kAgentCount; ++i)
+			delete agents[i];
+		return ticksPerSec;
+	}
+
+	//检查用的树：非优先级选择下的孩子带组合条件，先评估当前孩子会让一部分agent的条件进缓存，
+	//之后整段评估时同一段里既有命中缓存的，也有要执行的
+	BevNode *_CreateCheckTree()
+	{
+		BevNode &root = BevNodeFactory::oCreatePrioritySelectorNode(NULL, "root");
+		BevNode &sel = BevNodeFactory::oCreateNonePrioritySelectorNode(&root, "none_priority");
+		for (int i = 0; i < kBranchCount; ++i)
+		{
+			BevNode &action = BevNodeFactory::oCreateTeminalNode<BenchAction>(&sel, "action");
+			action.SetNodePrecondition(new BevNodePreconditionOR(
+				new BevNodePreconditionAND(new BenchCondition(i), new BevNodePreconditionNOT(new BenchCondition((i + 3) % kBranchCount))),
+				new BevNodePreconditionAND(new BenchCondition(i / 2), new BenchCondition((i + 5) % kBranchCount))));
+		}
+		BevNodeFactory::oCreateTeminalNode<BenchAction>(&root, "idle");
+		root.BuildStateLayout();
+		return &root;
+	}
+
+	//同一批agent分别用指针树逐个Evaluate+Tick和TickBatch驱动，每帧比较节点状态和输出，返回对不上的agent数
+	int _CheckBatch(BevNode *root)
+	{
+		const int kCheckAgentCount = 70;
+		const int kCheckFrameCount = 400;
+		BevCompiledTree compiled;
+		compiled.Compile(*root);
+		std::vector<BenchInput> ins(kCheckAgentCount);
+		std::vector<BenchOutput> outs(kCheckAgentCount * 2);
+		std::vector<BevAgentState *> serialAgents;
+		std::vector<BevAgentState *> batchAgents;
+		std::vector<BevNodeInputParam> inputs;
+		std::vector<BevNodeOutputParam> outputs;
+		for (int i = 0; i < kCheckAgentCount; ++i)
+		{
+			ins[i].mi_Frame = 0;
+			ins[i].mi_Seed = i * 7;
+			outs[i].mi_Work = 0;
+			outs[kCheckAgentCount + i].mi_Work = 0;
+			serialAgents.push_back(new BevAgentState(*root));
+			batchAgents.push_back(new BevAgentState(*root));
+			inputs.push_back(BevNodeInputParam(&ins[i]));
+			outputs.push_back(BevNodeOutputParam(&outs[kCheckAgentCount + i]));
+		}
+		BevBatchScratch scratch;
+		//条件缓存在节点状态的后面，两边的代数不一定一样，不比较
+		u32 stateSize = root->GetConditionCacheOffset();
+		int mismatches = 0;
+		for (int f = 0; f < kCheckFrameCount; ++f)
+		{
+			for (int i = 0; i < kCheckAgentCount; ++i)
+			{
+				//每个agent的输入变化节奏不同，同一帧里各agent走不同的分支
+				ins[i].mi_Frame = f * (1 + i % 5);
+				BevNodeOutputParam output(&outs[i]);
+				if (root->Evaluate(*serialAgents[i], inputs[i]))
+					root->Tick(*serialAgents[i], inputs[i], output);
+			}
+			compiled.TickBatch(&batchAgents[0], &inputs[0], &outputs[0], kCheckAgentCount, scratch);
+			for (int i = 0; i < kCheckAgentCount; ++i)
+			{
+				if (outs[i].mi_Work != outs[kCheckAgentCount + i].mi_Work || memcmp(serialAgents[i]->GetData(), batchAgents[i]->GetData(), stateSize) != 0)
+				{
+					if (mismatches == 0)
+						printf("batch check: agent %d differs at frame %d\n", i, f);
+					++mismatches;
+					//对不上以后两边就分开了，从下一帧开始重新对齐
+					outs[kCheckAgentCount + i].mi_Work = outs[i].mi_Work;
+					memcpy(batchAgents[i]->GetData(), serialAgents[i]->GetData(), stateSize);
+				}
+			}
+		}
+		for (int i = 0; i < kCheckAgentCount; ++i)
+		{
+			delete serialAgents[i];
+			delete batchAgents[i];
+		}
+		return mismatches;
+	}
+
+	//同样的agent分配，按树分批调用TickBatch
+	double _RunBatch(const std::vector<const BevCompiledTree *> &trees, const std::vector<BevNode *> &roots)
+	{
+		int treeCount = (int)trees.size();
+		std::vector<BenchInput> ins(kAgentCount);
+		BenchOutput out = {0};
+		std::vector<std::vector<BevAgentState *> > agents(treeCount);
+		std::vector<std::vector<BevNodeInputParam> > inputs(treeCount);
+		std::vector<std::vector<BevNodeOutputParam> > outputs(treeCount);
+		for (int i = 0; i < kAgentCount; ++i)
+		{
+			int tree = i % treeCount;
+			ins[i].mi_Frame = 0;
+			ins[i].mi_Seed = i;
+			agents[tree].push_back(new BevAgentState(*roots[tree]));
+			inputs[tree].push_back(BevNodeInputParam(&ins[i]));
+			outputs[tree].push_back(BevNodeOutputParam(&out));
+		}
+		BevBatchScratch scratch;
+
+		double seconds = 0;
+		for (int r = 0; r < kRepeatCount; ++r)
+		{
+			clock_t start = clock();
+			for (int f = 0; f < kFrameCount; ++f)
+			{
+				for (int i = 0; i < kAgentCount; ++i)
+					ins[i].mi_Frame = f;
+				for (int t = 0; t < treeCount; ++t)
+					trees[t]->TickBatch(&agents[t][0], &inputs[t][0], &outputs[t][0], (u32)agents[t].size(), scratch);
+			}
+			double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+			if (r == 0 || elapsed < seconds)
+				seconds = elapsed;
+		}
+		double ticksPerSec = seconds > 0 ? (double)kAgentCount * kFrameCount / seconds : 0;
+		printf("trees=%-4d %-10s %10.0f ticks/sec (work=%d)\n", treeCount, "batch", ticksPerSec, out.mi_Work);
+
+		for (int t = 0; t < treeCount; ++t)
+		{
+			for (u32 i = 0; i < agents[t].size(); ++i)
+				delete agents[t][i];
+		}
+		return ticksPerSec;
+	}
+}
+
+int main()
+{
+	//先确认批量评估和逐个评估的结果一样，不一样时跑出来的数字没有意义
+	BevNode *checkTree = _CreateCheckTree();
+	int mismatches = _CheckBatch(checkTree);
+	delete checkTree;
+	printf("batch check: %d mismatches\n", mismatches);
+	if (mismatches > 0)
+		return 1;
+
+	for (int treeCount = 1; treeCount <= kMaxTreeCount; treeCount *= 16)
+	{
+		std::vector<BevNode *> roots;
+		std::vector<const BevNode *> pointerTrees;
+		std::vector<const BevCompiledTree *> compiledTrees;
+		for (int i = 0; i < treeCount; ++i)
+		{
+			BevNode *root = _CreateTree();
+			BevCompiledTree *compiled = new BevCompiledTree();
+			compiled->Compile(*root);
+			roots.push_back(root);
+			pointerTrees.push_back(root);
+			compiledTrees.push_back(compiled);
+		}
+		if (treeCount == 1)
+			printf("nodes=%u state=%u bytes/agent\n", compiledTrees[0]->GetNodeCount(), roots[0]->GetTreeStateSize());
+
+		double pointerTree = _Run(pointerTrees, roots, "pointer");
+		double compiledTree = _Run(compiledTrees, roots, "compiled");
+		double batchTree = _RunBatch(compiledTrees, roots);
+		if (pointerTree > 0)
+		{
+			printf("trees=%-4d speedup    %10.2fx\n", treeCount, compiledTree / pointerTree);
+			printf("trees=%-4d batch      %10.2fx\n", treeCount, batchTree / pointerTree);
+		}
+
+		for (int i = 0; i < treeCount; ++i)
+		{
+			delete compiledTrees[i];
+			delete roots[i];
+		}
+	}
+	return 0;
+}
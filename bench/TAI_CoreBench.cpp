@@ -0,0 +1,426 @@
+//AI核心的微基准：BevNode的Evaluate/Tick（深、宽、并行多的树）、不同深度的前提条件、黑板读取、效用选择和优先级选择的批量评估、
+//StringID::Hash、RefValue读写和RefValueManager::Flush
+//发布之间用--benchmark_format=json --benchmark_out=xxx.json存下结果，比较两次的JSON就能看出退步
+//Linux下：g++ -O2 -DNDEBUG -std=c++98 -I. -include TsiU_PCH.h bench/TAI_CoreBench.cpp TAI_BevTree.cpp TAI_BevBlackboard.cpp TAI_BevCompiledTree.cpp TAI_BevPreconditionProgram.cpp TAI_BevUtilitySelector.cpp TAI_BevTreeArena.cpp TAI_StringID.cpp TAI_RefValue.cpp TCore_JobPool.cpp -o TAI_CoreBench
+#include "TsiU_PCH.h"
+#include <vector>
+#include "TAI_BevTree.h"
+#include "TAI_BevBlackboard.h"
+#include "TAI_BevCompiledTree.h"
+#include "TAI_BevUtilitySelector.h"
+#include "TAI_StringID.h"
+#include "TAI_RefValue.h"
+#include "TAI_BevBenchTree.h"
+#include "TAI_BenchRunner.h"
+
+using namespace TsiU;
+using namespace TsiU::AI;
+using namespace TsiU::AI::BehaviorTree;
+
+namespace
+{
+	//轮流tick这么多个agent，状态块不会一直在同一条缓存行里
+	const int kBenchAgentCount = 64;
+
+	//(帧/32 + 种子) % _i_Count == _i_Index，宽的树里每一帧只有一个分支通过
+	class BenchSlotCondition : public BevNodePrecondition
+	{
+	public:
+		BenchSlotCondition(int _i_Index, int _i_Count)
+			: mi_Index(_i_Index), mi_Count(_i_Count)
+		{
+		}
+		virtual bool ExternalCondition(const BevNodeInputParam &input) const
+		{
+			const BenchInput &in = input.GetRealDataType<BenchInput>();
+			return (in.mi_Frame / 32 + in.mi_Seed) % mi_Count == mi_Index;
+		}
+
+	private:
+		int mi_Index;
+		int mi_Count;
+	};
+
+	//深：_i_Depth层序列节点套在一起，每层都有前提条件，最底下是一个行为
+	BevNode *_CreateDeepTree(int _i_Depth)
+	{
+		BevNode &root = BevNodeFactory::oCreatePrioritySelectorNode(NULL, "root");
+		BevNode *parent = &root;
+		for (int i = 0; i < _i_Depth; ++i)
+		{
+			BevNode &seq = BevNodeFactory::oCreateSequenceNode(parent, "level");
+			seq.SetNodePrecondition(new BenchCondition(kBranchCount - 1 - i % 2));
+			parent = &seq;
+		}
+		BevNodeFactory::oCreateTeminalNode<BenchAction>(parent, "action");
+		root.BuildStateLayout();
+		return &root;
+	}
+
+	//宽：优先级选择下挂_i_Width个带前提条件的行为，平均要评估一半的孩子
+	BevNode *_CreateWideTree(int _i_Width)
+	{
+		BevNode &root = BevNodeFactory::oCreatePrioritySelectorNode(NULL, "root");
+		root.ReserveChildNodes(_i_Width);
+		for (int i = 0; i < _i_Width; ++i)
+		{
+			BevNode &action = BevNodeFactory::oCreateTeminalNode<BenchAction>(&root, "action");
+			action.SetNodePrecondition(new BenchSlotCondition(i, _i_Width));
+		}
+		root.BuildStateLayout();
+		return &root;
+	}
+
+	//并行：_i_Width个并行节点并在一起，每个下面_i_Width个行为
+	BevNode *_CreateParallelTree(int _i_Width)
+	{
+		BevNode &root = BevNodeFactory::oCreateParallelNode(NULL, k_PFC_AND, "root");
+		for (int i = 0; i < _i_Width; ++i)
+		{
+			BevNode &par = BevNodeFactory::oCreateParallelNode(&root, k_PFC_AND, "parallel");
+			for (int j = 0; j < _i_Width; ++j)
+				BevNodeFactory::oCreateTeminalNode<BenchAction>(&par, "action");
+		}
+		root.BuildStateLayout();
+		return &root;
+	}
+
+	//_i_Depth层AND/OR交替的满二叉树，叶子是BenchCondition
+	BevNodePrecondition *_CreatePrecondition(int _i_Depth, int &_i_Leaf)
+	{
+		if (_i_Depth == 0)
+			return new BenchCondition(_i_Leaf++ % kBranchCount);
+		BevNodePrecondition *lhs = _CreatePrecondition(_i_Depth - 1, _i_Leaf);
+		BevNodePrecondition *rhs = _CreatePrecondition(_i_Depth - 1, _i_Leaf);
+		if (_i_Depth % 2)
+			return new BevNodePreconditionOR(lhs, rhs);
+		return new BevNodePreconditionAND(lhs, rhs);
+	}
+
+	typedef BevNode *(*TreeCreator)(int _i_Size);
+
+	void _BenchTree(BenchState &state, TreeCreator _f_Creator, bool _b_Tick)
+	{
+		BevNode *root = _f_Creator(state.GetArg());
+		std::vector<BevAgentState *> agents;
+		for (int i = 0; i < kBenchAgentCount; ++i)
+			agents.push_back(new BevAgentState(*root));
+		BenchInput in = {0, 0};
+		BenchOutput out = {0};
+		BevNodeInputParam input(&in);
+		BevNodeOutputParam output(&out);
+
+		while (state.KeepRunning())
+		{
+			u32 index = (u32)state.GetIndex();
+			in.mi_Seed = index % kBenchAgentCount;
+			in.mi_Frame = index / kBenchAgentCount;
+			BevAgentState &agent = *agents[in.mi_Seed];
+			if (root->Evaluate(agent, input) && _b_Tick)
+				root->Tick(agent, input, output);
+		}
+		g_BenchSink += out.mi_Work;
+
+		for (int i = 0; i < kBenchAgentCount; ++i)
+			delete agents[i];
+		delete root;
+	}
+
+	void _BenchEvaluateDeep(BenchState &state)
+	{
+		_BenchTree(state, _CreateDeepTree, false);
+	}
+	void _BenchEvaluateWide(BenchState &state)
+	{
+		_BenchTree(state, _CreateWideTree, false);
+	}
+	void _BenchEvaluateParallel(BenchState &state)
+	{
+		_BenchTree(state, _CreateParallelTree, false);
+	}
+	void _BenchTickDeep(BenchState &state)
+	{
+		_BenchTree(state, _CreateDeepTree, true);
+	}
+	void _BenchTickWide(BenchState &state)
+	{
+		_BenchTree(state, _CreateWideTree, true);
+	}
+	void _BenchTickParallel(BenchState &state)
+	{
+		_BenchTree(state, _CreateParallelTree, true);
+	}
+
+	//一个行为节点带着一整棵条件树，每次根节点评估都会把条件重新算一遍
+	void _BenchPrecondition(BenchState &state)
+	{
+		BevNode &root = BevNodeFactory::oCreateTeminalNode<BenchAction>(NULL, "action");
+		int leaf = 0;
+		root.SetNodePrecondition(_CreatePrecondition(state.GetArg(), leaf));
+		root.BuildStateLayout();
+		BevAgentState agent(root);
+		BenchInput in = {0, 0};
+		BevNodeInputParam input(&in);
+
+		u32 passed = 0;
+		while (state.KeepRunning())
+		{
+			u32 index = (u32)state.GetIndex();
+			in.mi_Seed = index;
+			in.mi_Frame = index / kBenchAgentCount;
+			passed += root.Evaluate(agent, input);
+		}
+		g_BenchSink += passed;
+		delete &root;
+	}
+
+	//一个行为节点带着黑板上的比较条件，每次评估是一次按偏移的读
+	void _BenchBlackboardCheck(BenchState &state)
+	{
+		BevNode &root = BevNodeFactory::oCreateTeminalNode<BenchAction>(NULL, "action");
+		root.SetNodePrecondition(new BevBlackboardCompare<s32>("bench_health", k_BCO_Less, 30));
+		BevBlackboardLayout layout;
+		root.BindBlackboard(layout);
+		root.BuildStateLayout();
+		BevBlackboard blackboard(layout);
+		BevAgentState agent(root);
+		agent.SetBlackboard(&blackboard);
+		BevBlackboardKey<s32> health("bench_health");
+		health.Bind(layout);
+		BenchInput in = {0, 0};
+		BevNodeInputParam input(&in);
+
+		u32 passed = 0;
+		while (state.KeepRunning())
+		{
+			blackboard.Set(health, (s32)(state.GetIndex() % 64));
+			passed += root.Evaluate(agent, input);
+		}
+		g_BenchSink += passed;
+		delete &root;
+	}
+
+	//效用选择和优先级选择共用的黑板key，每个孩子看一个
+	const char *const kBenchUtilityKeys[] = {"bench_u0", "bench_u1", "bench_u2", "bench_u3", "bench_u4", "bench_u5", "bench_u6", "bench_u7"};
+	const int kBenchUtilityKeyCount = sizeof(kBenchUtilityKeys) / sizeof(kBenchUtilityKeys[0]);
+
+	//效用选择：_i_Width个孩子各按两个黑板值打分，选分数最高的
+	//_b_Guarded时每个孩子另有一个常常不满足的黑板条件，分数最高的孩子没通过时要按分数往下找
+	BevNode *_CreateUtilityTree(int _i_Width, bool _b_Guarded)
+	{
+		BevNodeUtilitySelector &root = static_cast<BevNodeUtilitySelector &>(BevNodeFactory::oCreateCustomNode<BevNodeUtilitySelector>(NULL, "root"));
+		root.ReserveChildNodes(_i_Width);
+		for (int i = 0; i < _i_Width; ++i)
+		{
+			BevNode &action = BevNodeFactory::oCreateTeminalNode<BenchAction>(&root, "action");
+			if (_b_Guarded)
+				action.SetNodePrecondition(new BevBlackboardCompare<f32>(kBenchUtilityKeys[(i + 2) % kBenchUtilityKeyCount], k_BCO_Less, 8.f + (f32)(i % 8)));
+			root.AddConsideration(i, kBenchUtilityKeys[i % kBenchUtilityKeyCount], BevResponseCurve(k_BCT_Linear, 0.f, 64.f));
+			root.AddConsideration(i, kBenchUtilityKeys[(i + 1) % kBenchUtilityKeyCount], BevResponseCurve(k_BCT_Polynomial, 0.f, 64.f, -1.f, 2.f, 0.f, 1.f));
+		}
+		root.SetMomentum(0.1f);
+		return &root;
+	}
+	BevNode *_CreateUtilityTree(int _i_Width)
+	{
+		return _CreateUtilityTree(_i_Width, false);
+	}
+	BevNode *_CreateGuardedUtilityTree(int _i_Width)
+	{
+		return _CreateUtilityTree(_i_Width, true);
+	}
+
+	//同样的选择用优先级选择和手写的黑板条件表达：每个孩子要求自己的两个值一高一低
+	BevNode *_CreateUtilityPriorityTree(int _i_Width)
+	{
+		BevNode &root = BevNodeFactory::oCreatePrioritySelectorNode(NULL, "root");
+		root.ReserveChildNodes(_i_Width);
+		for (int i = 0; i < _i_Width; ++i)
+		{
+			BevNode &action = BevNodeFactory::oCreateTeminalNode<BenchAction>(&root, "action");
+			action.SetNodePrecondition(new BevNodePreconditionAND(
+				new BevBlackboardCompare<f32>(kBenchUtilityKeys[i % kBenchUtilityKeyCount], k_BCO_Greater, 32.f + (f32)(i % 16)),
+				new BevBlackboardCompare<f32>(kBenchUtilityKeys[(i + 1) % kBenchUtilityKeyCount], k_BCO_Less, 32.f - (f32)(i % 16))));
+		}
+		BevNodeFactory::oCreateTeminalNode<BenchAction>(&root, "idle");
+		return &root;
+	}
+
+	//每次迭代改一个值，再用BevCompiledTree::TickBatch把kBenchAgentCount个agent一起评估、tick一遍
+	void _BenchSelectorBatch(BenchState &state, TreeCreator _f_Creator)
+	{
+		BevNode *root = _f_Creator(state.GetArg());
+		BevBlackboardLayout layout;
+		for (int i = 0; i < kBenchUtilityKeyCount; ++i)
+			layout.AddKey<f32>(kBenchUtilityKeys[i], 32.f);
+		root->BindBlackboard(layout);
+		root->BuildStateLayout();
+		BevCompiledTree tree;
+		tree.Compile(*root);
+
+		std::vector<BevBlackboard *> blackboards;
+		std::vector<BevAgentState *> agents;
+		std::vector<BenchInput> ins(kBenchAgentCount);
+		std::vector<BenchOutput> outs(kBenchAgentCount);
+		std::vector<BevNodeInputParam> inputs;
+		std::vector<BevNodeOutputParam> outputs;
+		for (int i = 0; i < kBenchAgentCount; ++i)
+		{
+			blackboards.push_back(new BevBlackboard(layout));
+			agents.push_back(new BevAgentState(tree));
+			agents[i]->SetBlackboard(blackboards[i]);
+			ins[i].mi_Frame = 0;
+			ins[i].mi_Seed = i;
+			outs[i].mi_Work = 0;
+			inputs.push_back(BevNodeInputParam(&ins[i]));
+			outputs.push_back(BevNodeOutputParam(&outs[i]));
+		}
+		std::vector<BevBlackboardKey<f32> > keys;
+		for (int i = 0; i < kBenchUtilityKeyCount; ++i)
+		{
+			keys.push_back(BevBlackboardKey<f32>(kBenchUtilityKeys[i]));
+			keys.back().Bind(layout);
+		}
+		BevBatchScratch scratch;
+		scratch.Reserve(kBenchAgentCount);
+
+		while (state.KeepRunning())
+		{
+			u32 index = (u32)state.GetIndex();
+			for (int i = 0; i < kBenchAgentCount; ++i)
+				blackboards[i]->Set(keys[(index + i) % kBenchUtilityKeyCount], (f32)((index * 7 + i * 13) % 64));
+			tree.TickBatch(&agents[0], &inputs[0], &outputs[0], kBenchAgentCount, scratch);
+		}
+		for (int i = 0; i < kBenchAgentCount; ++i)
+			g_BenchSink += outs[i].mi_Work;
+		state.SetItemsProcessed(state.GetIterations() * kBenchAgentCount);
+
+		for (int i = 0; i < kBenchAgentCount; ++i)
+		{
+			delete agents[i];
+			delete blackboards[i];
+		}
+		delete root;
+	}
+
+	void _BenchUtilitySelectorBatch(BenchState &state)
+	{
+		_BenchSelectorBatch(state, _CreateUtilityTree);
+	}
+	void _BenchGuardedUtilitySelectorBatch(BenchState &state)
+	{
+		_BenchSelectorBatch(state, _CreateGuardedUtilityTree);
+	}
+	void _BenchPrioritySelectorBatch(BenchState &state)
+	{
+		_BenchSelectorBatch(state, _CreateUtilityPriorityTree);
+	}
+
+	void _BenchStringIDHash(BenchState &state)
+	{
+		std::string text(state.GetArg(), 'a');
+		for (int i = 0; i < state.GetArg(); ++i)
+			text[i] = (char)('a' + i * 7 % 26);
+		u32 hash = 0;
+		while (state.KeepRunning())
+			hash += StringID::Hash(text.c_str());
+		g_BenchSink += hash;
+		state.SetItemsProcessed(state.GetIterations() * state.GetArg());
+	}
+
+	void _BenchRefValueRead(BenchState &state)
+	{
+		RFInt value("bench_read", 1);
+		int sum = 0;
+		while (state.KeepRunning())
+			sum += value;
+		g_BenchSink += sum;
+	}
+
+	void _BenchRefValueWrite(BenchState &state)
+	{
+		RFInt value("bench_write", 0);
+		while (state.KeepRunning())
+			value = (int)state.GetIndex();
+		g_BenchSink += value;
+	}
+
+	//_i_Count个可写的值每次都改过，另有同名的只读值从共享内存里读回来
+	void _BenchRefValueFlush(BenchState &state)
+	{
+		int count = state.GetArg();
+		std::vector<RFInt *> writables;
+		std::vector<RFCInt *> readOnlys;
+		char name[32];
+		for (int i = 0; i < count; ++i)
+		{
+			sprintf(name, "bench_flush_%d", i);
+			writables.push_back(new RFInt(name, i));
+			readOnlys.push_back(new RFCInt(name, 0));
+		}
+		RefValueManager &manager = RefValueManager::Get();
+		//只读值第一次找到共享内存里的位置要经过几次Flush，不算在里面
+		for (int i = 0; i <= count; ++i)
+			manager.Flush();
+
+		while (state.KeepRunning())
+		{
+			for (int i = 0; i < count; ++i)
+				*writables[i] = (int)state.GetIndex();
+			manager.Flush();
+		}
+		g_BenchSink += *readOnlys[count - 1];
+		state.SetItemsProcessed(state.GetIterations() * count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			delete writables[i];
+			delete readOnlys[i];
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	BenchRunner runner(argc, argv);
+
+	const int kDepths[] = {4, 16, 64};
+	const int kWidths[] = {8, 64, 512};
+	const int kParallelWidths[] = {2, 4, 16};
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNode_Evaluate/deep", _BenchEvaluateDeep, kDepths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNode_Evaluate/wide", _BenchEvaluateWide, kWidths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNode_Evaluate/parallel", _BenchEvaluateParallel, kParallelWidths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNode_EvaluateTick/deep", _BenchTickDeep, kDepths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNode_EvaluateTick/wide", _BenchTickWide, kWidths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNode_EvaluateTick/parallel", _BenchTickParallel, kParallelWidths[i]);
+
+	for (int depth = 0; depth <= 8; depth += 2)
+		runner.Run("BevNodePrecondition_Check/depth", _BenchPrecondition, depth);
+
+	runner.Run("BevBlackboardCompare_Check", _BenchBlackboardCheck);
+
+	const int kUtilityWidths[] = {4, 16, 64};
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNodeUtilitySelector_TickBatch/children", _BenchUtilitySelectorBatch, kUtilityWidths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNodeUtilitySelector_TickBatchGuarded/children", _BenchGuardedUtilitySelectorBatch, kUtilityWidths[i]);
+	for (int i = 0; i < 3; ++i)
+		runner.Run("BevNodePrioritySelector_TickBatch/children", _BenchPrioritySelectorBatch, kUtilityWidths[i]);
+
+	for (int length = 8; length <= 512; length *= 4)
+		runner.Run("StringID_Hash/length", _BenchStringIDHash, length);
+
+	runner.Run("RefValue_Read", _BenchRefValueRead);
+	runner.Run("RefValue_Write", _BenchRefValueWrite);
+	for (int count = 16; count <= 256; count *= 4)
+		runner.Run("RefValueManager_Flush/values", _BenchRefValueFlush, count);
+
+	runner.Finish();
+	return 0;
+}